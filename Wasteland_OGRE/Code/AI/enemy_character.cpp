@@ -12,6 +12,8 @@ EnemyCharacter::EnemyCharacter(const std::string& name,const std::string& script
 	_name = name;
 	_scriptName = script;
 
+	setFilter(DetourInterface::DT_FILTER_ENEMY);
+
 	Ogre::Entity* ent = static_cast<Ogre::Entity*>(getMovableObject());
 
 	//this will probably have to change
@@ -62,139 +64,38 @@ void EnemyCharacter::addWeapons(GraphicsManager* graphics,SoundManager* sound)
 void EnemyCharacter::update(float deltaTimeInMilliSecs)
 {
 	updatePosition(deltaTimeInMilliSecs/1000.0f);
+	LuaManager::getSingleton().updateEntityPosition(_handle,getPosition());
 
 	double dmg = _damageInterface->getEnemyDamage(this->_name);
 	//subtract from health, kill off if below zero.
 
-	lua_State* lua = LuaManager::getSingleton().getLuaState();
-
-	lua_pushstring(lua,_name.c_str());
-	lua_setglobal(lua,"callingEntity");
-
-	lua_getglobal(lua,this->_scriptName.c_str());
-	lua_pushnumber(lua,deltaTimeInMilliSecs);
-	lua_pushinteger(lua,_prevBhv);
-	lua_pushinteger(lua,_prevAct);
-	lua_pushinteger(lua,static_cast<int>(_isBhvFinished));
-	lua_pushinteger(lua,static_cast<int>(_isActFinished));
-	int err = lua_pcall(lua,5,1,0);
-	if(err == 2)
-	{
-		std::cout << "Lua error!" << std::endl;
-		if(lua_isstring(lua,1))
-		{
-			std::cout << lua_tostring(lua,1) << std::endl;
-		}
-	}
-
-	int behavior = 0,action = 0;
-	std::string bhvTarget,actTarget,changeWep;
-	Ogre::Vector3 moveTarget,min,max,target;
-
-	int bhvChange = 0,actChange = 0;
+	think(deltaTimeInMilliSecs);
+}
 
-	if(lua_istable(LuaManager::getSingleton().getLuaState(),1))
+void EnemyCharacter::_applyAction(int action,const Decision& decision)
+{
+	switch(action)
 	{
-
-		bhvChange = LuaManager::getIntegerFromLuaTable(lua,"bhvchange");
-		_bhvChange = (bhvChange == 1) ? true : false;
-
-		if(_bhvChange)
+	case AI::ACT_CHANGEWEP:
+		_actionChangeWeapon(decision.weapon);
+		break;
+	case AI::ACT_RELOAD:
+		if(_currentWeapon.weapon->isReloadNeeded())
 		{
-			behavior = LuaManager::getIntegerFromLuaTable(lua,"behavior");
+			_actionReload();
 		}
 		else
 		{
-			behavior = _prevBhv;
-		}
-
-		actChange = LuaManager::getIntegerFromLuaTable(lua,"actchange");
-		_actChange = (actChange == 1) ? true : false;
-
-		if(_actChange)
-		{
-			action = LuaManager::getIntegerFromLuaTable(lua,"action");
-		}
-		else
-		{
-			action = _prevAct;
-		}
-
-		switch(behavior)
-		{
-		case AI::BHV_IDLE:
-			_behaviorIdle();
-			break;
-		case AI::BHV_MOVE:
-			moveTarget = LuaManager::getVectorFromLuaTable(lua,"bhvtarget");
-			if(moveTarget == Ogre::Vector3(-1000,-1000,-1000))
-			{
-				moveTarget = _destination;
-			}
-
-			_behaviorMove(moveTarget);
-			break;
-		case AI::BHV_WANDER:
-			min = LuaManager::getVectorFromLuaTable(lua,"bhvmin");
-			max = LuaManager::getVectorFromLuaTable(lua,"bhvmax");
-			if(min == Ogre::Vector3::ZERO || max == Ogre::Vector3::ZERO)
-			{
-				min = _destination;
-				max = _destination;
-			}
-			_behaviorWander(min,max);
-			break;
-		case AI::BHV_FOLLOW:
-			bhvTarget = LuaManager::getStringFromLuaTable(lua,"bhvtarget");
-			_behaviorFollow(bhvTarget);
-			break;
-		case AI::BHV_TALK:
-			bhvTarget = LuaManager::getStringFromLuaTable(lua,"bhvtarget");
-			_behaviorTalk(bhvTarget);
-			break;
-		default:
-			_behaviorIdle();
-		}
-
-		switch(action)
-		{
-		case AI::ACT_IDLE:
 			_actionIdle();
-			break;
-		case AI::ACT_LOOKAT:
-			target = LuaManager::getVectorFromLuaTable(lua,"lookat");
-			if(target == Ogre::Vector3::ZERO || target == Ogre::Vector3(-1000,-1000,-1000))
-			{
-				_actionIdle();
-			}
-			else
-			{
-				_actionLook(target);
-			}
-			break;
-		case AI::ACT_CHANGEWEP:
-			changeWep = LuaManager::getStringFromLuaTable(lua,"weapon");
-			_actionChangeWeapon(changeWep);
-			break;
-		case AI::ACT_RELOAD:
-			if(_currentWeapon.weapon->isReloadNeeded())
-			{
-				_actionReload();
-			}
-			else
-			{
-				_actionIdle();
-			}
-			break;
-		case AI::ACT_SHOOT:
-			actTarget = LuaManager::getStringFromLuaTable(lua,"acttarget");
-			_actionShoot(actTarget);
-			break;
-		default:
-			_actionIdle();
-			break;
-		};
-	}
+		}
+		break;
+	case AI::ACT_SHOOT:
+		_actionShoot(decision.actTarget);
+		break;
+	default:
+		NPCCharacter::_applyAction(action,decision);
+		break;
+	};
 }
 
 void EnemyCharacter::_actionReload()
@@ -18,6 +18,8 @@ class EnemyCharacter : public NPCCharacter
 	void update(float deltaTimeInMilliSecs);
 
 	void addWeapons(GraphicsManager* graphics,SoundManager* sound);
+protected:
+	void _applyAction(int action,const Decision& decision);
 private:
 	//Methods to implement actions specifically for Enemies
 	void _actionReload();
@@ -0,0 +1,155 @@
+#include "StdAfx.h"
+
+#include "look_at_controller.h"
+
+LookAtController::LookAtController()
+	: _entity(nullptr),
+	  _bone(nullptr),
+	  _bindDerived(Ogre::Quaternion::IDENTITY),
+	  _target(Ogre::Vector3::ZERO),
+	  _hasTarget(false),
+	  _weight(0.0f),
+	  _active(false),
+	  _maxYaw(Ogre::Degree(100)),
+	  _maxPitch(Ogre::Degree(60)),
+	  _turnSpeed(3.0f),
+	  _blendSpeed(4.0f)
+{
+}
+
+bool LookAtController::setup(Ogre::Entity* entity,const std::string& boneName)
+{
+	_entity = nullptr;
+	_bone = nullptr;
+	if(entity == nullptr || !entity->hasSkeleton())
+	{
+		return false;
+	}
+
+	Ogre::SkeletonInstance* skel = entity->getSkeleton();
+	if(!skel->hasBone(boneName))
+	{
+		std::cout << "Error! LookAtController - no bone named " << boneName << std::endl;
+		return false;
+	}
+
+	_entity = entity;
+	_bone = skel->getBone(boneName);
+
+	//the bind pose, before any animation moves it.
+	skel->reset(true);
+	_bindDerived = _bone->_getDerivedOrientation();
+
+	Ogre::AnimationStateSet* states = entity->getAllAnimationStates();
+	if(states != nullptr)
+	{
+		Ogre::AnimationStateIterator itr = states->getAnimationStateIterator();
+		while(itr.hasMoreElements())
+		{
+			Ogre::AnimationState* state = itr.getNext();
+			if(!state->hasBlendMask())
+			{
+				state->createBlendMask(skel->getNumBones(),1.0f);
+			}
+		}
+	}
+
+	return true;
+}
+
+Ogre::Vector3 LookAtController::getWorldPosition()
+{
+	if(_bone == nullptr)
+	{
+		return Ogre::Vector3::ZERO;
+	}
+
+	return _entity->getParentNode()->_getFullTransform() * _bone->_getDerivedPosition();
+}
+
+void LookAtController::setTarget(const Ogre::Vector3& target)
+{
+	_target = target;
+	_hasTarget = true;
+}
+
+void LookAtController::clearTarget()
+{
+	_hasTarget = false;
+}
+
+void LookAtController::update(float deltaTime)
+{
+	if(_bone == nullptr || (!_active && !_hasTarget))
+	{
+		return;
+	}
+
+	Ogre::Node* node = _entity->getParentNode();
+
+	//direction to the target relative to the body, in yaw/pitch.
+	Ogre::Euler desired;
+	if(_hasTarget)
+	{
+		Ogre::Vector3 local = node->_getDerivedOrientation().Inverse() * (_target - getWorldPosition());
+		if(local.squaredLength() > 0.0f)
+		{
+			desired.setDirection(local);
+		}
+		desired.limitYaw(_maxYaw);
+		desired.limitPitch(_maxPitch);
+	}
+
+	//ease towards it, no faster than the turn speed.
+	Ogre::Radian maxTurn(_turnSpeed * deltaTime);
+	Ogre::Radian yaw = desired.getYaw() - _current.getYaw();
+	Ogre::Radian pitch = desired.getPitch() - _current.getPitch();
+	_current.yaw(std::max(-maxTurn,std::min(yaw,maxTurn)));
+	_current.pitch(std::max(-maxTurn,std::min(pitch,maxTurn)));
+
+	float step = _blendSpeed * deltaTime;
+	_weight = (_hasTarget) ? std::min(_weight + step,1.0f) : std::max(_weight - step,0.0f);
+
+	if(_weight <= 0.0f && !_hasTarget)
+	{
+		//all the way back, the animation has the bone to itself again.
+		_bone->setManuallyControlled(false);
+		_setAnimationWeight(1.0f);
+		_current = Ogre::Euler();
+		_active = false;
+		return;
+	}
+
+	if(!_active)
+	{
+		_bone->setManuallyControlled(true);
+		_active = true;
+	}
+
+	//the look rotation is applied to the bind pose in model space, then brought into the parent bone's space.
+	Ogre::Quaternion parentDerived = (_bone->getParent() != nullptr) ? _bone->getParent()->_getDerivedOrientation() : Ogre::Quaternion::IDENTITY;
+	Ogre::Quaternion look = parentDerived.Inverse() * _current.toQuaternion() * _bindDerived;
+
+	//manually controlled bones aren't reset, the (faded) tracks are added on top of this every time the skeleton updates.
+	_bone->setOrientation(Ogre::Quaternion::Slerp(_weight,_bone->getInitialOrientation(),look,true));
+	_setAnimationWeight(1.0f - _weight);
+}
+
+void LookAtController::_setAnimationWeight(float weight)
+{
+	Ogre::AnimationStateSet* states = _entity->getAllAnimationStates();
+	if(states == nullptr)
+	{
+		return;
+	}
+
+	Ogre::AnimationStateIterator itr = states->getAnimationStateIterator();
+	while(itr.hasMoreElements())
+	{
+		Ogre::AnimationState* state = itr.getNext();
+		if(state->hasBlendMask())
+		{
+			state->setBlendMaskEntry(_bone->getHandle(),weight);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#include "StdAfx.h"
+
+#ifndef _LOOK_AT_CONTROLLER_H_
+#define _LOOK_AT_CONTROLLER_H_
+
+#include "../Utility.h"
+
+/*
+	Turns a bone(the head) towards a point, on top of whatever the skeleton is animating.
+
+	The bone is looked up once, and its tracks are faded out through the entity's own animation
+	blend masks instead of being removed from the skeleton, which is shared by every entity using the mesh.
+	While there's a target the bone is blended from the animation to the look rotation, without one it
+	blends back and is handed to the animation again. Nothing is allocated after setup().
+*/
+class LookAtController
+{
+public:
+	LookAtController();
+
+	//Finds the bone and gives every animation state a blend mask. False if the entity has no such bone,
+	//the controller then does nothing.
+	bool setup(Ogre::Entity* entity,const std::string& boneName);
+
+	Ogre::Bone* getBone() { return _bone; }
+	//Where the bone currently is in the world.
+	Ogre::Vector3 getWorldPosition();
+
+	void setTarget(const Ogre::Vector3& target);
+	void clearTarget();
+	bool hasTarget() { return _hasTarget; }
+
+	//How far the bone may turn away from the body's facing.
+	void setLimits(const Ogre::Radian& maxYaw,const Ogre::Radian& maxPitch) { _maxYaw = maxYaw; _maxPitch = maxPitch; }
+	//turnSpeed in radians/second, blendSpeed in weight/second(4 blends fully in a quarter second).
+	void setSpeeds(float turnSpeed,float blendSpeed) { _turnSpeed = turnSpeed; _blendSpeed = blendSpeed; }
+
+	//deltaTime in seconds.
+	void update(float deltaTime);
+
+private:
+	void _setAnimationWeight(float weight);
+
+	Ogre::Entity* _entity;
+	Ogre::Bone* _bone;
+	//bind pose of the bone, in model space.
+	Ogre::Quaternion _bindDerived;
+
+	Ogre::Vector3 _target;
+	bool _hasTarget;
+
+	//current yaw/pitch relative to the body, eased towards the target.
+	Ogre::Euler _current;
+	//0 is all animation, 1 is all look-at.
+	float _weight;
+	bool _active;
+
+	Ogre::Radian _maxYaw,_maxPitch;
+	float _turnSpeed,_blendSpeed;
+};
+
+#endif
@@ -14,6 +14,8 @@ NPCCharacter::NPCCharacter(const std::string& name,const std::string& script,Ogr
 	_name = name;
 	_scriptName = script;
 
+	setFilter(DetourInterface::DT_FILTER_CIVILIAN);
+
 	//check for animations
 	Ogre::Entity* ent = static_cast<Ogre::Entity*>(getMovableObject());
 	
@@ -42,6 +44,19 @@ NPCCharacter::NPCCharacter(const std::string& name,const std::string& script,Ogr
 
 	_bhvChange = false;
 	_actChange = false;
+
+	_animationTime = 0.0f;
+
+	//bone and query are kept for the NPC's lifetime, looking at something happens a lot.
+	_lookAt.setup(ent,"Bip01_Head");
+	_lookQuery = node->getCreator()->createRayQuery(Ogre::Ray());
+	_lookQuery->setSortByDistance(true);
+	_lookQuery->setQueryMask(CHARACTER_MASK | SCENERY_MASK);
+}
+
+NPCCharacter::~NPCCharacter()
+{
+	_node->getCreator()->destroyQuery(_lookQuery);
 }
 
 /*! \brief Updates the NPCCharacter
@@ -51,9 +66,29 @@ Internally updates the inherited LevelData::BaseEntity and the inherited Charact
 */
 void NPCCharacter::update(float deltaTimeInMilliSecs)
 {
-	//before anything else, update the position
+	animate(deltaTimeInMilliSecs);
+	think(deltaTimeInMilliSecs);
+}
+
+void NPCCharacter::animate(float deltaTimeInMilliSecs)
+{
 	updatePosition(deltaTimeInMilliSecs/1000.0f);
+	LuaManager::getSingleton().updateEntityPosition(_handle,getPosition());
 
+	//something is funky with FPSC character models.
+	//Will probably have to get custom ones somewhere.
+	//Distant NPCs collect the time and advance in bigger steps.
+	_animationTime += deltaTimeInMilliSecs;
+	if(_animationTime >= _lod.animationInterval)
+	{
+		_animHandler.addTime(_animationTime / 1000.0f);
+		_lookAt.update(_animationTime / 1000.0f);
+		_animationTime = 0.0f;
+	}
+}
+
+void NPCCharacter::think(float elapsedMilliSecs)
+{
 	lua_State* lua = LuaManager::getSingleton().getLuaState();
 
 	LuaManager::getSingleton().clearLuaStack();
@@ -61,130 +96,153 @@ void NPCCharacter::update(float deltaTimeInMilliSecs)
 	lua_pushstring(lua,_name.c_str());
 	lua_setglobal(lua,"callingEntity");
 
-	lua_getglobal(lua,this->_scriptName.c_str());
-	lua_pushnumber(lua,16.666);
-	lua_pushinteger(lua,_prevBhv);
-	lua_pushinteger(lua,_prevAct);
-	lua_pushinteger(lua,static_cast<int>(_isBhvFinished));
-	lua_pushinteger(lua,static_cast<int>(_isActFinished));
-	int err = lua_pcall(lua,5,1,0);
-	if(err == 2)
+	//no function, no table below, so the NPC simply keeps doing what it was doing.
+	if(pushScriptFunction())
 	{
-		std::cout << "Lua error!" << std::endl;
-		if(lua_isstring(lua,1))
+		lua_pushnumber(lua,elapsedMilliSecs);
+		lua_pushinteger(lua,_prevBhv);
+		lua_pushinteger(lua,_prevAct);
+		lua_pushinteger(lua,static_cast<int>(_isBhvFinished));
+		lua_pushinteger(lua,static_cast<int>(_isActFinished));
+		int err = lua_pcall(lua,5,1,0);
+		if(err == 2)
 		{
-			std::cout << lua_tostring(lua,1) << std::endl;
+			std::cout << "Lua error!" << std::endl;
+			if(lua_isstring(lua,1))
+			{
+				std::cout << lua_tostring(lua,1) << std::endl;
+			}
 		}
 	}
 
-	int behavior = 0,action = 0;
-	std::string bhvTarget,actTarget,changeWep;
-	Ogre::Vector3 moveTarget,shootTarget,target;
+	if(lua_istable(lua,1))
+	{
+		Decision decision;
+		_readDecision(lua,decision);
+		applyDecision(decision);
+	}
 
-	int bhvChange = 0,actChange = 0;
+	//Just in case I missed something up there(missing lua_pop,etc)
+	lua_settop(lua,0);
+}
 
-	if(lua_istable(LuaManager::getSingleton().getLuaState(),1))
-	{
-		bhvChange = LuaManager::getIntegerFromLuaTable(lua,"bhvchange");
-		_bhvChange = (bhvChange) ? true : false;
+//the behavior/action that's kept when the script doesn't ask for a change.
+void NPCCharacter::applyDecision(const Decision& decision)
+{
+	int behavior = (decision.bhvChange) ? decision.behavior : _prevBhv;
+	int action = (decision.actChange) ? decision.action : _prevAct;
+	_bhvChange = decision.bhvChange;
+	_actChange = decision.actChange;
+
+	Ogre::Vector3 min = decision.bhvMin,max = decision.bhvMax;
+	Ogre::Vector3 moveTarget;
 
-		//get behavior
-		if(_bhvChange)
+	switch(behavior)
+	{
+	case AI::BHV_IDLE:
+		_behaviorIdle();
+		break;
+	case AI::BHV_WANDER:
+		if(min == Ogre::Vector3::ZERO || max == Ogre::Vector3::ZERO ||
+		   min == Ogre::Vector3(-1000,-1000,-1000) || max == Ogre::Vector3(-1000,-1000,-1000))
 		{
-			behavior = LuaManager::getIntegerFromLuaTable(lua,"behavior");
+			min = _destination;
+			max = _destination;
 		}
-		else
+		_behaviorWander(min,max);
+		break;
+	case AI::BHV_TALK:
+		_behaviorTalk(decision.bhvTarget);
+		break;
+	case AI::BHV_MOVE:
+		moveTarget = decision.moveTarget;
+		if(moveTarget == Ogre::Vector3(-1000,-1000,-1000))
 		{
-			behavior = _prevBhv;
+			moveTarget = _destination;
 		}
 
-		actChange = LuaManager::getIntegerFromLuaTable(lua,"actchange");
-		_actChange = (actChange) ? true : false;
+		_behaviorMove(moveTarget);
+		break;
+	case AI::BHV_FOLLOW:
+		_behaviorFollow(decision.bhvTarget);
+		break;
+	default:
+		_behaviorIdle();
+		break;
+	}
 
-		if(_actChange)
-		{
-			action = LuaManager::getIntegerFromLuaTable(lua,"action");
-		}
-		else
-		{
-			action = _prevAct;
-		}
-		
-		Ogre::Vector3 min,max;
+	_applyAction(action,decision);
 
-		switch(behavior)
-		{
-		case AI::BHV_IDLE:
-			_behaviorIdle();
-			break;
-		case AI::BHV_WANDER:
-			min = LuaManager::getVectorFromLuaTable(lua,"bhvmin");
-			max = LuaManager::getVectorFromLuaTable(lua,"bhvmax");
-			if(min == Ogre::Vector3::ZERO || max == Ogre::Vector3::ZERO)
-			{
-				min = _destination;
-				max = _destination;
-			}
-			_behaviorWander(min,max);
-			break;
-		case AI::BHV_TALK:
-			bhvTarget = LuaManager::getStringFromLuaTable(lua,"bhvtarget");
-			_behaviorTalk(bhvTarget);
-			break;
-		case AI::BHV_MOVE:
-			moveTarget = LuaManager::getVectorFromLuaTable(lua,"bhvtarget");
-
-			if(moveTarget == Ogre::Vector3(-1000,-1000,-1000))
-			{
-				moveTarget = _destination;
-			}
+	//std::cout << behavior << "," << action << std::endl;
 
-			_behaviorMove(moveTarget);
-			break;
-		case AI::BHV_FOLLOW:
-			bhvTarget = LuaManager::getStringFromLuaTable(lua,"bhvtarget");
-			_behaviorFollow(bhvTarget);
-			break;
-		default:
-			_behaviorIdle();
-			break;
-		}
+	_prevBhv = behavior;
+	_prevAct = action;
+}
 
-		switch(action)
+void NPCCharacter::_applyAction(int action,const Decision& decision)
+{
+	switch(action)
+	{
+	case AI::ACT_IDLE:
+		_actionIdle();
+		break;
+	case AI::ACT_LOOKAT:
+		if(decision.lookAt == Ogre::Vector3::ZERO || decision.lookAt == Ogre::Vector3(-1000,-1000,-1000))
 		{
-		case AI::ACT_IDLE:
 			_actionIdle();
-			break;
-		case AI::ACT_LOOKAT:
-			target = LuaManager::getVectorFromLuaTable(lua,"lookat");
-			if(target == Ogre::Vector3::ZERO || target == Ogre::Vector3(-1000,-1000,-1000))
-			{
-				_actionIdle();
-			}
-			else
-			{
-				_actionLook(target);
-			}
-			break;
-		default:
-			_actionIdle();
-			break;
 		}
-		
+		else if(!_lod.headLook)
+		{
+			//too far away for anyone to notice.
+			_lookAt.clearTarget();
+			_isActFinished = true;
+		}
+		else
+		{
+			_actionLook(decision.lookAt);
+		}
+		break;
+	default:
+		_actionIdle();
+		break;
 	}
+}
 
-	//Just in case I missed something up there(missing lua_pop,etc)
-	lua_settop(lua,0);
-
-	//std::cout << behavior << "," << action << std::endl;
+//Only the fields the chosen behavior/action use are read, every one of them is a trip into Lua.
+void NPCCharacter::_readDecision(lua_State* lua,Decision& decision)
+{
+	decision.bhvChange = (LuaManager::getIntegerFromLuaTable(lua,"bhvchange") != 0);
+	decision.behavior = (decision.bhvChange) ? LuaManager::getIntegerFromLuaTable(lua,"behavior") : _prevBhv;
+	decision.actChange = (LuaManager::getIntegerFromLuaTable(lua,"actchange") != 0);
+	decision.action = (decision.actChange) ? LuaManager::getIntegerFromLuaTable(lua,"action") : _prevAct;
 
-	_prevBhv = behavior;
-	_prevAct = action;
+	switch(decision.behavior)
+	{
+	case AI::BHV_WANDER:
+		decision.bhvMin = LuaManager::getVectorFromLuaTable(lua,"bhvmin");
+		decision.bhvMax = LuaManager::getVectorFromLuaTable(lua,"bhvmax");
+		break;
+	case AI::BHV_MOVE:
+		decision.moveTarget = LuaManager::getVectorFromLuaTable(lua,"bhvtarget");
+		break;
+	case AI::BHV_TALK:
+	case AI::BHV_FOLLOW:
+		decision.bhvTarget = LuaManager::getStringFromLuaTable(lua,"bhvtarget");
+		break;
+	}
 
-	//lastly, update the animations
-	//something is funky with FPSC character models.
-	//Will probably have to get custom ones somewhere.
-	_animHandler.addTime(deltaTimeInMilliSecs / 1000.0f);
+	switch(decision.action)
+	{
+	case AI::ACT_LOOKAT:
+		decision.lookAt = LuaManager::getVectorFromLuaTable(lua,"lookat");
+		break;
+	case AI::ACT_CHANGEWEP:
+		decision.weapon = LuaManager::getStringFromLuaTable(lua,"weapon");
+		break;
+	case AI::ACT_SHOOT:
+		decision.actTarget = LuaManager::getStringFromLuaTable(lua,"acttarget");
+		break;
+	}
 }
 
 void NPCCharacter::_behaviorIdle()
@@ -203,7 +261,7 @@ void NPCCharacter::_behaviorIdle()
 	_isBhvFinished = true;
 
 	//transition to idle animation
-	_animHandler.blend("Idle",AnimationBlender::BlendWhileAnimating,.2f,true);
+	_changeAnimation("Idle");
 }
 
 void NPCCharacter::_behaviorMove(const Ogre::Vector3& target)
@@ -212,7 +270,8 @@ void NPCCharacter::_behaviorMove(const Ogre::Vector3& target)
 	//std::cout << target << std::endl;
 	if(_destination.squaredDistance(target) >= 5)
 	{
-		updateDestination(target,false);
+		//queued and cached by Detour, the agent keeps going until the path is found.
+		requestPath(target);
 		_destination = target;
 	}
 
@@ -248,15 +307,10 @@ void NPCCharacter::_behaviorMove(const Ogre::Vector3& target)
 			if((target == nullptr && _animHandler.getSource()->getAnimationName() != "Walk") || 
 				(target != nullptr && target->getAnimationName() != "Walk"))
 			{
-				_animHandler.blend("Walk",AnimationBlender::BlendWhileAnimating,.2f,true);
+				_changeAnimation("Walk");
 			}
 		}
 	}
-	//also have to reset the head, since I'm manually controlling it.
-	Ogre::Skeleton* skel = static_cast<Ogre::Entity*>(_movableObject)->getSkeleton();
-	Ogre::Bone* headBone = skel->getBone("Bip01_Head");
-	//not sure how to do this.
-
 }
 
 void NPCCharacter::_behaviorWander(Ogre::Vector3& min,Ogre::Vector3& max)
@@ -406,60 +460,38 @@ void NPCCharacter::_behaviorFollow(const std::string& targetName)
 
 }
 
+void NPCCharacter::_changeAnimation(const std::string& name)
+{
+	_animHandler.blend(name,(_lod.blendAnimations) ? AnimationBlender::BlendWhileAnimating : AnimationBlender::BlendSwitch,.2f,true);
+}
+
 //This is basically just a time-waster
 void NPCCharacter::_actionIdle()
 {
-	//want the head to point straight ahead when it's idling
-	Ogre::Bone* headBone;
-	Ogre::Skeleton* skel = static_cast<Ogre::Entity*>(_movableObject)->getSkeleton();
-	headBone = skel->getBone("Bip01_Head");
-	if(headBone->isManuallyControlled())
-	{
-		//rotate it to be aligned with the body.
-
-	}
+	//want the head to point straight ahead when it's idling, it blends back to the animation.
+	_lookAt.clearTarget();
 
 	_isActFinished = true;
 }
 
 void NPCCharacter::_actionLook(const Ogre::Vector3& target)
 {
-	Ogre::Bone* headBone;
-	std::string n = _node->getName();
-	Ogre::Skeleton* skel = static_cast<Ogre::Entity*>(_movableObject)->getSkeleton();
-	headBone = skel->getBone("Bip01_Head");
-
-	headBone->setManuallyControlled(true);
-	headBone->setInheritOrientation(true);
-	int nAnim = skel->getNumAnimations();
-
-	//have to do this to allow the head to turn properly.
-	for(int i = 0; i < nAnim; ++i)
+	if(_lookAt.getBone() == nullptr)
 	{
-		skel->getAnimation(i)->destroyNodeTrack(headBone->getHandle());
+		_isActFinished = true;
+		return;
 	}
 
-	Ogre::Vector3 test = headBone->_getDerivedPosition() * CHARACTER_SCALE_FACTOR + _node->getPosition();
-	Ogre::Vector3 dir = target - test;
-	Ogre::Quaternion nodeRot,boneRot;
-	Ogre::Euler boneEuler; boneEuler.setDirection(dir,true,false);
-	/*boneRot = _node->convertLocalToWorldOrientation(_node->getOrientation()) * headBone->_getDerivedOrientation();
-	Ogre::Vector3 boneTest = boneRot * Ogre::Vector3::UNIT_Z;*/
-	//Ogre::Vector3 boneTest = headBone->getOrientation() * Ogre::Vector3::UNIT_Z;
+	Ogre::Vector3 head = _lookAt.getWorldPosition();
+	Ogre::Vector3 dir = target - head;
 
 	//turns the direction vector into a 2D normalized vector on the X/Z axis.
 	dir.y = 0;
 	dir.normalise();
 
 	//All of this ray query stuff is to make sure that the AI can "see" the target before attempting to look at it.
-	Ogre::SceneManager* scene = _node->getCreator();
-	Ogre::Ray ray(headBone->_getDerivedPosition() * CHARACTER_SCALE_FACTOR + _node->getPosition(),dir);
-
-	Ogre::RaySceneQuery* query = scene->createRayQuery(ray);
-	query->setSortByDistance(true);
-	query->setQueryMask(CHARACTER_MASK | SCENERY_MASK);
-
-	Ogre::RaySceneQueryResult results = query->execute();
+	_lookQuery->setRay(Ogre::Ray(head,dir));
+	const Ogre::RaySceneQueryResult& results = _lookQuery->execute();
 
 	bool withinView = false;
 	if(results.size() == 0)
@@ -476,32 +508,16 @@ void NPCCharacter::_actionLook(const Ogre::Vector3& target)
 			}
 		}
 		
-		if(!withinView && results.size() > 1 && std::next(results.begin())->distance > test.distance(target))
+		if(!withinView && results.size() > 1 && std::next(results.begin())->distance > head.distance(target))
 		{
 			withinView = true;
 		}
 	}
 
-	scene->destroyQuery(query);
-
+	//out of sight, the head keeps looking where it was.
 	if(withinView)
 	{
-		Ogre::Euler node;
-		Ogre::Euler t = headOrientation.getRotationTo(dir);
-		t.limitYaw(Ogre::Radian(3.0));
-		t.limitPitch(Ogre::Radian(0.0));
-
-		headOrientation = headOrientation + t;
-		headOrientation.limitYaw(Ogre::Degree(100));
-		headOrientation.limitPitch(Ogre::Degree(60));
-
-		headBone->setOrientation(headOrientation);
-
-		/*headBone->rotate(boneTest.getRotationTo(dir),Ogre::Node::TS_WORLD);
-
-		Ogre::Quaternion boneRotation = _node->convertLocalToWorldOrientation(_node->getOrientation()) * headBone->_getDerivedOrientation() * (Ogre::Quaternion(Ogre::Degree(180),Ogre::Vector3::UNIT_Y));
-		Ogre::Quaternion nodeRotation = _node->_getDerivedOrientation();
-		Ogre::Quaternion diff = nodeRotation.Inverse() * boneRotation;*/
+		_lookAt.setTarget(target);
 	}
 
 	_isActFinished = true;
@@ -6,18 +6,81 @@
 #include "../LevelData.h"
 #include "../Character.h"
 #include "../AnimationBlender.h"
+#include "look_at_controller.h"
 //#include "../AI_include.h"
 
+#include <lua.hpp>
+
 #define CHARACTER_SCALE_FACTOR .0275f
 
 class NPCCharacter : public LevelData::BaseEntity,public Character
 {
 public:
 	NPCCharacter(const std::string& name,const std::string& script,Ogre::SceneNode* node,CrowdManager* crowdMgr);
+	~NPCCharacter();
 
+	//animate() and think() back to back.
 	void update(float deltaTimeInMilliSecs);
 
+	//Moves the character and advances its animations, cheap enough for every frame.
+	void animate(float deltaTimeInMilliSecs);
+	//Runs the NPC's script and acts on the behavior/action it picks.
+	/*
+		elapsedMilliSecs is the time since the last think, may cover several frames.
+	*/
+	void think(float elapsedMilliSecs);
+
+	//What a script picked for the NPC to do, see AI::BehaviorCodes/AI::ActionCodes.
+	//Only the fields the behavior/action use are filled in.
+	struct Decision
+	{
+		Decision()
+			: behavior(0),action(0),bhvChange(false),actChange(false),
+			  moveTarget(-1000,-1000,-1000),bhvMin(Ogre::Vector3::ZERO),bhvMax(Ogre::Vector3::ZERO),lookAt(Ogre::Vector3::ZERO)
+		{}
+
+		int behavior;
+		int action;
+		bool bhvChange;
+		bool actChange;
+
+		Ogre::Vector3 moveTarget;
+		Ogre::Vector3 bhvMin,bhvMax;
+		Ogre::Vector3 lookAt;
+		std::string bhvTarget;
+		std::string actTarget;
+		std::string weapon;
+	};
+
+	//Acts on a decision, wherever it came from.
+	void applyDecision(const Decision& decision);
+
+	//The parts of the NPC's level of detail(see AIManager) it handles itself.
+	struct LODSettings
+	{
+		LODSettings(float animInterval = 0.0f,bool blend = true,bool look = true)
+			: animationInterval(animInterval),blendAnimations(blend),headLook(look)
+		{}
+
+		//milliseconds between animation updates, 0 for every frame.
+		float animationInterval;
+		//cross fade between animations, otherwise they're just switched.
+		bool blendAnimations;
+		//whether ACT_LOOKAT turns the head(with its ray query).
+		bool headLook;
+	};
+	void setLOD(const LODSettings& lod) { _lod = lod; }
+	//Null if the mesh has no head bone.
+	Ogre::Bone* getHeadBone() { return _lookAt.getBone(); }
+	Ogre::Vector3 getHeadPosition() { return _lookAt.getWorldPosition(); }
+	const LODSettings& getLOD() { return _lod; }
+
 protected:
+	//Reads the result table returned by the NPC's own script(at stack index 1).
+	void _readDecision(lua_State* lua,Decision& decision);
+	//Actions are where enemies differ, behaviors are shared.
+	virtual void _applyAction(int action,const Decision& decision);
+
 	//Methods to implement behaviors specific to NPCs.
 	void _behaviorMove(const Ogre::Vector3& target);
 	void _behaviorIdle();
@@ -29,6 +92,9 @@ protected:
 	void _actionIdle();
 	void _actionLook(const Ogre::Vector3& target);
 
+	//Blends(or switches, depending on the LOD) to a looping animation.
+	void _changeAnimation(const std::string& name);
+
 	int _prevBhv;
 	int _prevAct;
 	bool _isBhvFinished;
@@ -38,7 +104,12 @@ protected:
 
 	AnimationBlender _animHandler;
 
-	Ogre::Euler headOrientation;
+	LODSettings _lod;
+	//animation time not handed to the blender yet.
+	float _animationTime;
+
+	LookAtController _lookAt;
+	Ogre::RaySceneQuery* _lookQuery;
 };
 
 #endif
\ No newline at end of file
@@ -2,18 +2,39 @@
 
 #include "AIManager.h"
 
+//Distance(in units) within which NPCs are treated as if they were right at the focus point.
+#define THINK_NEAR_DISTANCE 5.0f
+
+AIManager::AIManager()
+	: _thinkBudget(DEFAULT_THINK_BUDGET_US),
+	  _focusPoint(Ogre::Vector3::ZERO),
+	  _camera(nullptr),
+	  _crowd(nullptr)
+{
+	//distance,think interval,steering,(animation interval,blend animations,head look)
+	LODTier nearTier = { 15.0f,0.0f,CrowdManager::AGENT_QUALITY_HIGH,NPCCharacter::LODSettings(0.0f,true,true) };
+	LODTier mediumTier = { 40.0f,250.0f,CrowdManager::AGENT_QUALITY_MEDIUM,NPCCharacter::LODSettings(33.0f,true,false) };
+	LODTier farTier = { std::numeric_limits<float>::max(),500.0f,CrowdManager::AGENT_QUALITY_LOW,NPCCharacter::LODSettings(100.0f,false,false) };
+	LODTier hiddenTier = { 0.0f,1000.0f,CrowdManager::AGENT_QUALITY_LOW,NPCCharacter::LODSettings(250.0f,false,false) };
+	_lodTiers[LOD_NEAR] = nearTier;
+	_lodTiers[LOD_MEDIUM] = mediumTier;
+	_lodTiers[LOD_FAR] = farTier;
+	_lodTiers[LOD_HIDDEN] = hiddenTier;
+}
+
 //Destructor
 AIManager::~AIManager()
 {
-	std::for_each(_npcs.begin(),_npcs.end(),[](NPCCharacter* npc) {
-		delete npc;
-		npc = nullptr;
+	std::for_each(_npcs.begin(),_npcs.end(),[](ScheduledNPC& entry) {
+		delete entry.npc;
+		entry.npc = nullptr;
 	});
 	_npcs.clear();
 }
 
 void AIManager::loadNPCs(std::string fileName,CrowdManager* Crowd, Ogre::SceneManager* Scene,float maxSpeed)
 {
+	_crowd = Crowd;
 	auto npcList = list(fileName.c_str());
 	for(auto itr = npcList->file().begin(); itr != npcList->file().end(); ++itr)
 	{
@@ -22,17 +43,114 @@ void AIManager::loadNPCs(std::string fileName,CrowdManager* Crowd, Ogre::SceneMa
 
 		NPCCharacter* npc = new NPCCharacter(obj->name(),obj->scriptName(),node,Crowd);
 		npc->setMaxSpeed(maxSpeed);
-		_npcs.push_back(npc);
+
+		ScheduledNPC entry;
+		entry.npc = npc;
+		entry.sinceThink = 0.0f;
+		entry.priority = 0.0f;
+		entry.lod = LOD_NEAR;
+		_npcs.push_back(entry);
 		LuaManager::getSingleton().addEntity(npc->getName(),npc);
 
 		delete obj;
 	}
+
+	//spread evenly over their think interval, so they don't all think on the same frame.
+	size_t count = _npcs.size();
+	for(size_t i = 0; i < count; ++i)
+	{
+		ScheduledNPC& entry = _npcs[i];
+		_setLODTier(entry,_pickLODTier(entry.npc,entry.npc->getPosition().distance(_focusPoint)));
+		entry.sinceThink = i * _lodTiers[entry.lod].thinkInterval / count;
+	}
 }
 
 void AIManager::update(float deltaTimeInMs)
 {
+	//cheap part, every frame for everyone.
+	size_t ready = 0;
 	for(auto itr = _npcs.begin(); itr != _npcs.end(); ++itr)
 	{
-		(*itr)->update(deltaTimeInMs);
+		float distance = itr->npc->getPosition().distance(_focusPoint);
+		LOD_TIER tier = _pickLODTier(itr->npc,distance);
+		if(tier != itr->lod)
+		{
+			_setLODTier(*itr,tier);
+		}
+
+		itr->npc->animate(deltaTimeInMs);
+		itr->sinceThink += deltaTimeInMs;
+
+		//the longer it's waited and the closer it is, the sooner it thinks.
+		//NPCs whose tier doesn't let them think yet go to the back and are left out.
+		if(itr->sinceThink >= _lodTiers[itr->lod].thinkInterval)
+		{
+			itr->priority = itr->sinceThink / std::max(distance,THINK_NEAR_DISTANCE);
+			++ready;
+		}
+		else
+		{
+			itr->priority = -1.0f;
+		}
+	}
+
+	std::sort(_npcs.begin(),_npcs.end(),[] (const ScheduledNPC& a,const ScheduledNPC& b) {
+		return a.priority > b.priority;
+	});
+
+	if(ready == 0)
+	{
+		return;
+	}
+
+	//expensive part, as many as fit into the budget.
+	unsigned long start = _timer.getMicroseconds();
+	for(auto itr = _npcs.begin(); itr != _npcs.begin() + ready; ++itr)
+	{
+		if(itr != _npcs.begin() && _timer.getMicroseconds() - start >= _thinkBudget)
+		{
+			break;
+		}
+
+		itr->npc->think(itr->sinceThink);
+		itr->sinceThink = 0.0f;
+	}
+}
+
+AIManager::LOD_TIER AIManager::_pickLODTier(NPCCharacter* npc,float distance)
+{
+	if(distance <= _lodTiers[LOD_NEAR].distance)
+	{
+		//close enough to be heard, or seen as soon as the player turns.
+		return (_isVisible(npc)) ? LOD_NEAR : LOD_MEDIUM;
+	}
+
+	if(!_isVisible(npc))
+	{
+		return LOD_HIDDEN;
+	}
+
+	return (distance <= _lodTiers[LOD_MEDIUM].distance) ? LOD_MEDIUM : LOD_FAR;
+}
+
+bool AIManager::_isVisible(NPCCharacter* npc)
+{
+	if(_camera == nullptr || npc->getMovableObject() == nullptr)
+	{
+		return true;
+	}
+
+	return _camera->isVisible(npc->getMovableObject()->getWorldBoundingBox(true));
+}
+
+void AIManager::_setLODTier(ScheduledNPC& entry,LOD_TIER tier)
+{
+	const LODTier& settings = _lodTiers[tier];
+	if(_crowd != nullptr && settings.steering != _lodTiers[entry.lod].steering)
+	{
+		_crowd->setAgentQuality(entry.npc->getAgentID(),settings.steering);
 	}
+
+	entry.npc->setLOD(settings.character);
+	entry.lod = tier;
 }
\ No newline at end of file
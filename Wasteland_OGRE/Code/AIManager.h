@@ -9,15 +9,74 @@
 
 #include "interfaces\characterobject.hxx"
 
+#define DEFAULT_THINK_BUDGET_US 2000
+
+//Owns the NPCs and decides which of them get to think(run their script) each frame.
+//Movement and animation are updated for every NPC every frame, thinking is spread out under a time budget.
+//NPCs are also put into level of detail tiers by distance and visibility, far and unseen ones do less work.
 class AIManager
 {
 public:
+	enum LOD_TIER
+	{
+		LOD_NEAR = 0,
+		LOD_MEDIUM,
+		LOD_FAR,
+		//Out of view, however far away(except within the near distance, those are LOD_MEDIUM).
+		LOD_HIDDEN,
+		LOD_TIER_COUNT
+	};
+
+	struct LODTier
+	{
+		//NPCs up to this distance from the focus point are in the tier, unused for LOD_HIDDEN.
+		float distance;
+		//Milliseconds an NPC waits between thinks at least.
+		float thinkInterval;
+		CrowdManager::AGENT_QUALITY steering;
+		NPCCharacter::LODSettings character;
+	};
+
+	AIManager();
 	~AIManager();
 	void loadNPCs(std::string fileName,CrowdManager* Crowd,Ogre::SceneManager* Scene,float maxSpeed = .9f);
 
 	void update(float deltaTime);
+
+	//Microseconds per frame the NPC scripts may use. At least one NPC thinks every frame, even over budget.
+	void setThinkBudget(unsigned long microseconds) { _thinkBudget = microseconds; }
+	unsigned long getThinkBudget() { return _thinkBudget; }
+
+	//NPCs close to this point(usually the player or camera) think more often.
+	void setFocusPoint(const Ogre::Vector3& point) { _focusPoint = point; }
+	//NPCs outside this camera's view are LOD_HIDDEN, without a camera everyone counts as visible.
+	void setCamera(Ogre::Camera* camera) { _camera = camera; }
+
+	void setLODTier(LOD_TIER tier,const LODTier& settings) { _lodTiers[tier] = settings; }
+	const LODTier& getLODTier(LOD_TIER tier) { return _lodTiers[tier]; }
+
 private:
-	std::vector<NPCCharacter*> _npcs;
+	struct ScheduledNPC
+	{
+		NPCCharacter* npc;
+		//time since the NPC last thought, in milliseconds.
+		float sinceThink;
+		float priority;
+		LOD_TIER lod;
+	};
+
+	LOD_TIER _pickLODTier(NPCCharacter* npc,float distance);
+	bool _isVisible(NPCCharacter* npc);
+	void _setLODTier(ScheduledNPC& entry,LOD_TIER tier);
+
+	std::vector<ScheduledNPC> _npcs;
+
+	unsigned long _thinkBudget;
+	Ogre::Vector3 _focusPoint;
+	Ogre::Camera* _camera;
+	CrowdManager* _crowd;
+	LODTier _lodTiers[LOD_TIER_COUNT];
+	Ogre::Timer _timer;
 };
 
 #endif
\ No newline at end of file
@@ -58,6 +58,7 @@ void ArenaLocker::Setup(InputManager* Input,GraphicsManager* Graphics,GUIManager
 
 	_AIManager.reset(new AIManager());
 	_AIManager->loadNPCs("resource\\xml\\lists\\arenalocker_npc_list.xml",_crowd.get(),_scene,.9f);
+	_AIManager->setCamera(_camera);
 	std::cout << "NPCs loaded" << std::endl;
 
 	_loadSounds("resource\\xml\\arena_locker\\locker_soundlist.xml",Sound);
@@ -122,6 +123,7 @@ int ArenaLocker::Run(InputManager* Input,GraphicsManager* Graphics,GUIManager* G
 		//Update the crowd manager
 		_crowd->updateTick(_deltaTime / 1000.0f);
 
+		_AIManager->setFocusPoint(_camera->getDerivedPosition());
 		_AIManager->update(_deltaTime);
 
 		if(!GameManager::UpdateManagers(Graphics,_physics.get(),_deltaTime))
@@ -163,15 +165,6 @@ int ArenaLocker::Run(InputManager* Input,GraphicsManager* Graphics,GUIManager* G
 
 void ArenaLocker::Shutdown(InputManager* Input,GraphicsManager* Graphics,GUIManager* Gui,SoundManager* Sound)
 {
-	std::for_each(_pairs.begin(),_pairs.end(),[] (OgreBulletPair ipair) {
-		if(ipair.btBody->getCollisionShape()->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
-		{
-			btBvhTriangleMeshShape* mesh = static_cast<btBvhTriangleMeshShape*>(ipair.btBody->getCollisionShape());
-			btTriangleMesh* trimesh = static_cast<btTriangleMesh*>(mesh->getUserPointer());
-			delete trimesh;
-		}
-	});
-
 	std::for_each(_sounds.begin(),_sounds.end(),[Sound] (sSound snd) {
 		Sound->destroySound(snd);
 	});
@@ -180,6 +173,9 @@ void ArenaLocker::Shutdown(InputManager* Input,GraphicsManager* Graphics,GUIMana
 
 	Graphics->getRenderWindow()->removeAllViewports();
 
+	//the NPCs free their scene queries and nodes, so they go before the scene manager does.
+	_AIManager.reset();
+
 	Graphics->cleanAndDestroySceneManager(_scene);
 
 	LuaManager::getSingletonPtr()->deepClean();
@@ -207,12 +203,12 @@ void ArenaLocker::_handleScript()
 	//assume it's a vector that's being returned. Otherwise some seriously fucked up shit is going on.
 	Ogre::Vector3 targetVector = Ogre::Vector3::UNIT_X;
 	Ogre::Vector3 lookVector = Ogre::Vector3::UNIT_X;
-	if(lua_istable(luaS,1))
+	if(LuaVector::isVector(luaS,1))
 	{
 		targetVector = LuaManager::getVectorFromLua(luaS,1);
 	}
 
-	if(lua_istable(luaS,2))
+	if(LuaVector::isVector(luaS,2))
 	{
 		lookVector = LuaManager::getVectorFromLua(luaS,2);
 	}
@@ -269,7 +265,7 @@ void ArenaLocker::_handleScript()
 	//get the vector from it.
 	Ogre::Vector2 tmp = Ogre::Vector2::ZERO;
 	lua_State* l = LuaManager::getSingleton().getLuaState();
-	if(lua_istable(l,1))
+	if(LuaVector::isVector(l,1))
 	{
 		for(int i = 1; i < 3; ++i)
 		{
@@ -394,17 +390,33 @@ void ArenaLocker::_navigationMeshSetup(Ogre::Entity* levelEntity)
 	InputGeometry levelGeometry(levelEntity);
 
 	RecastConfiguration params(.2f,2.5f);
+	params.setTileSize(128);
 
 	_recast.reset(new RecastInterface(_scene,params));
 	_recast->getRecastConfig().walkableRadius = static_cast<int>(.2f); // zero?
-	_recast->buildNavMesh(&levelGeometry);
-	_recast->exportPolygonMeshToObj("ARENALOCKER_RECAST_MESH.obj");
 
 	rcdtConfig config;
 	config.recastConfig = &_recast->getRecastConfig();
 	config.userConfig = &_recast->getRecastBuildConfiguration();
 
-	_detour.reset(new DetourInterface(_recast->getPolyMesh(),_recast->getDetailMesh(),config));
+	//only rebuild the navmesh if the level or the settings changed since it was cached.
+	Ogre::uint64 navMeshKey = _recast->getCacheKey(&levelGeometry);
+	_detour.reset(new DetourInterface());
+	if(!_detour->loadNavMesh("ARENALOCKER_NAVMESH.bin",navMeshKey))
+	{
+		if(params.getTileSize() > 0)
+		{
+			_recast->buildTiledNavMesh(&levelGeometry,_detour.get());
+		}
+		else
+		{
+			_recast->buildNavMesh(&levelGeometry);
+			_recast->exportPolygonMeshToObj("ARENALOCKER_RECAST_MESH.obj");
+
+			_detour.reset(new DetourInterface(_recast->getPolyMesh(),_recast->getDetailMesh(),config));
+		}
+		_detour->saveNavMesh("ARENALOCKER_NAVMESH.bin",navMeshKey);
+	}
 
 	_crowd.reset(new CrowdManager(_detour.get(),&config));
 }
\ No newline at end of file
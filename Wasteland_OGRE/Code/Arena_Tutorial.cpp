@@ -112,6 +112,7 @@ void ArenaTutorial::Setup(InputManager* Input,GraphicsManager* Graphics,GUIManag
 
 	//let's try out the character controller
 	_controller.reset(new CharacterController(_camera,Ogre::Vector3(1.0f,1.9f,5.0f),Ogre::Vector3(0.0,0.0,-5.0f),_physics->getWorld(),Graphics ) );
+	_physics->addInterpolatedObject(_controller->getGhostObject(),_controller->getNode());
 	//since we're using the character controller, should also lock the mouse.
 	Input->setMouseLock(true);
 
@@ -122,11 +123,14 @@ void ArenaTutorial::Setup(InputManager* Input,GraphicsManager* Graphics,GUIManag
 	//let's setup the EWS system
 	_ews.reset(new EWSManager(_scene));
 
-	LevelData::LevelParser parser;
-	parser.setFile("resource\\models\\mapscapeTEST\\zonedoor_scriptTest.ent");
-	parser.parseDoors(&_doors);
-	parser.parseLights(&_lights);
-	parser.parseTriggers(&_triggers,_scene->getRootSceneNode());
+	//uses the compiled level if it's up to date, otherwise parses the .ent file and compiles it.
+	LevelData::loadLevel("resource\\models\\mapscapeTEST\\zonedoor_scriptTest.ent",&_triggers,&_lights,&_doors,nullptr,_scene->getRootSceneNode());
+
+	//player/entity triggers are driven by the physics broadphase from here on.
+	for(auto itr = _triggers.begin(); itr != _triggers.end(); ++itr)
+	{
+		(*itr)->createVolume(_physics.get());
+	}
 
 	std::cout << "Parser finished" << std::endl;
 
@@ -150,18 +154,39 @@ void ArenaTutorial::Setup(InputManager* Input,GraphicsManager* Graphics,GUIManag
 	params.setAgentHeight(2.5f);
 	params.setAgentRadius(.2f);
 	params.setCellSize(.3f);
+	params.setTileSize(64);
 
 	_recast.reset(new RecastInterface(_scene,params));
 	_recast->getRecastConfig().walkableRadius = static_cast<int>(.2f);
-	_recast->buildNavMesh(&levelGeometry);
-	_recast->exportPolygonMeshToObj("ARENATUTORIAL_RECAST_MESH.obj");
 
 	rcdtConfig config = _recast->getConfigurations();
 	//rcdtConfig config(&_recast->getRecastConfig(),&_recast->getRecastBuildConfiguration());
 	//config.recastConfig = &_recast->getRecastConfig();
 	//config.userConfig = &_recast->getRecastBuildConfiguration();
 
-	_detour.reset(new DetourInterface(_recast->getPolyMesh(),_recast->getDetailMesh(),config));
+	//only rebuild the navmesh if the level or the settings changed since it was cached.
+	Ogre::uint64 navMeshKey = _recast->getCacheKey(&levelGeometry);
+	_detour.reset(new DetourInterface());
+	if(params.getTileSize() > 0)
+	{
+		//the doors are navmesh obstacles, so tiled levels keep the tile cache layers instead of the navmesh.
+		if(!_detour->loadTileCache("ARENATUTORIAL_TILECACHE.bin",navMeshKey))
+		{
+			_recast->buildTileCache(&levelGeometry,_detour.get());
+			_detour->saveTileCache("ARENATUTORIAL_TILECACHE.bin",navMeshKey);
+		}
+	}
+	else
+	{
+		if(!_detour->loadNavMesh("ARENATUTORIAL_NAVMESH.bin",navMeshKey))
+		{
+			_recast->buildNavMesh(&levelGeometry);
+			_recast->exportPolygonMeshToObj("ARENATUTORIAL_RECAST_MESH.obj");
+
+			_detour.reset(new DetourInterface(_recast->getPolyMesh(),_recast->getDetailMesh(),config));
+			_detour->saveNavMesh("ARENATUTORIAL_NAVMESH.bin",navMeshKey);
+		}
+	}
 
 	_crowd.reset(new CrowdManager(_detour.get(),&config));
 
@@ -312,20 +337,12 @@ int ArenaTutorial::Run(InputManager* Input,GraphicsManager* Graphics,GUIManager*
 void ArenaTutorial::Shutdown(InputManager* Input,GraphicsManager* Graphics,GUIManager* Gui,SoundManager* Sound)
 {
 	
+	_physics->removeInterpolatedObject(_controller->getGhostObject());
 	_controller->shutdown();
 
 	//undo what I set in OIS
 	Input->setMouseLock(false);
 
-	std::for_each(_pairs.begin(),_pairs.end(),[] (OgreBulletPair ipair) {
-		if(ipair.btBody->getCollisionShape()->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
-		{
-			btBvhTriangleMeshShape* mesh = static_cast<btBvhTriangleMeshShape*>(ipair.btBody->getCollisionShape());
-			btTriangleMesh* trimesh = static_cast<btTriangleMesh*>(mesh->getUserPointer());
-			delete trimesh;
-		}
-	});
-
 	std::for_each(_npcs.begin(),_npcs.end(),[] (NPCCharacter* npc) {
 		delete npc;
 	});
@@ -422,7 +439,9 @@ void ArenaTutorial::_setupDoors(OgreBulletPair& mainLevel,Ogre::SceneManager* sc
 	for(auto itr = _doors.begin(); itr != _doors.end(); ++itr)
 	{
 		(*itr)->createDoor(scene,g,p,&mainLevel);
-		LuaManager::getSingleton().addEntity((*itr)->getName(),(*itr).get());
+		LevelData::EntityHandle handle = LuaManager::getSingleton().addEntity((*itr)->getName(),(*itr).get());
+		//in the spatial index right away, DoorData::update keeps it there as the door swings.
+		LuaManager::getSingleton().updateEntityPosition(handle,(*itr)->getPosition());
 	}
 }
 
@@ -431,5 +450,7 @@ void ArenaTutorial::_updateDoors()
 	for(std::vector<std::unique_ptr<LevelData::DoorData>>::iterator itr = _doors.begin(); itr != _doors.end(); ++itr)
 	{
 		(*itr)->update();
+		//the tiles are rebuilt on the next crowd tick.
+		(*itr)->updateNavObstacle(_detour.get());
 	}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "EWS.h"
 #include "PhysicsManager.h"
 #include "LevelData.h"
+#include "LevelCompiler.h"
 
 #include "RecastInterface.h"
 #include "DetourInterface.h"
@@ -4,6 +4,9 @@
 #include "Utility.h"
 
 Character::Character(Ogre::SceneManager* scene,CrowdManager* crowd,const Ogre::Vector3& position)
+	: _crowd(crowd),
+	  _filter(DetourInterface::DT_FILTER_DEFAULT),
+	  _pathRequest(0)
 {
 	//won't use this often.
 }
@@ -12,29 +15,31 @@ Character::Character()
 	: _node(nullptr),
 	  _movableObject(nullptr),
 	  _agentID(-1),
-	  _agent(nullptr),
+	  _filter(DetourInterface::DT_FILTER_DEFAULT),
 	  _isStopped(false),
 	  _isAgentControlled(true),
 	  _crowd(nullptr),
 	  _destination(0.0f),
 	  _manualVelocity(0.0f),
-	  _destRadius(4.0f)
+	  _destRadius(4.0f),
+	  _pathRequest(0)
 {}
 
 Character::Character(Ogre::SceneNode* node,CrowdManager* crowd,const Ogre::Vector3& position)
 	: _node(node),
 	  _movableObject(nullptr),
 	  _agentID(-1),
-	  _agent(nullptr),
+	  _filter(DetourInterface::DT_FILTER_DEFAULT),
 	  _isStopped(false),
 	  _isAgentControlled(true),
 	  _crowd(crowd),
-	  _destRadius(4.0f)
+	  _destRadius(4.0f),
+	  _pathRequest(0)
 {
 	_agentID = _crowd->addAgent(position);
-	_agent = _crowd->getAgent(_agentID);
+	const CrowdManager::AgentState* state = getAgentState();
 	
-	if(_agent->active != 1)
+	if(state == nullptr || !state->active)
 	{
 		std::cout << "Agent is inactive! Name:" << node->getName() << std::endl;
 	}
@@ -43,6 +48,12 @@ Character::Character(Ogre::SceneNode* node,CrowdManager* crowd,const Ogre::Vecto
 	_movableObject = node->getAttachedObject(0);
 }
 
+Character::~Character()
+{
+	//the callback points back at this character.
+	cancelPath();
+}
+
 //!Finds closest point on navmesh and updates destination of agent to it.
 void Character::updateDestination(const Ogre::Vector3& destination,bool updatePrevPath)
 {
@@ -52,7 +63,7 @@ void Character::updateDestination(const Ogre::Vector3& destination,bool updatePr
 	}
 
 	Ogre::Vector3 result;
-	if(!_crowd->_getDetour()->findNearestPointOnNavmesh(destination,result))
+	if(!_crowd->_getDetour()->findNearestPointOnNavmesh(destination,result,_filter))
 	{
 		return;
 	}
@@ -72,14 +83,13 @@ void Character::setPosition(const Ogre::Vector3& position)
 	}
 	
 	Ogre::Vector3 result;
-	if(!_crowd->_getDetour()->findNearestPointOnNavmesh(position,result))
+	if(!_crowd->_getDetour()->findNearestPointOnNavmesh(position,result,_filter))
 	{
 		return;
 	}
 
 	_crowd->removeAgent(_agentID);
-	_agentID = _crowd->addAgent(result);
-	_agent = _crowd->getAgent(_agentID);
+	_agentID = _crowd->addAgent(result,DEFAULT_MAXSPEED,_filter);
 
 	_node->setPosition(result);
 }
@@ -108,11 +118,11 @@ void Character::setVelocity(const Ogre::Vector3& velocity)
 
 Ogre::Vector3 Character::getVelocity()
 {
-	if(_isAgentControlled)
+	//the last finished crowd step, doesn't wait for the running one.
+	const CrowdManager::AgentState* state = (_isAgentControlled) ? getAgentState() : nullptr;
+	if(state != nullptr)
 	{
-		Ogre::Vector3 vel;
-		Utility::floatPtr_toVector3(_agent->nvel,vel);
-		return vel;
+		return state->velocity;
 	}
 	else
 	{
@@ -139,21 +149,22 @@ float Character::getSpeed()
 
 float Character::getMaxSpeed()
 {
-	return _agent->params.maxSpeed;
+	const CrowdManager::AgentState* state = getAgentState();
+	return (state != nullptr) ? state->maxSpeed : 0.0f;
 }
 
 void Character::setMaxSpeed(float maxSpeedFactor)
 {
 	_crowd->removeAgent(_agentID);
-	_agentID = _crowd->addAgent(_node->getPosition(),maxSpeedFactor);
-	_agent = _crowd->getAgent(_agentID);
+	_agentID = _crowd->addAgent(_node->getPosition(),maxSpeedFactor,_filter);
 
 	return;
 }
 
 float Character::getMaxAcceleration()
 {
-	return _agent->params.maxAcceleration;
+	const CrowdManager::AgentState* state = getAgentState();
+	return (state != nullptr) ? state->maxAcceleration : 0.0f;
 }
 
 bool Character::isMoving()
@@ -172,8 +183,7 @@ void Character::setAgentControlled(bool agentControlled)
 	{
 		if(agentControlled)
 		{
-			_agentID = _crowd->addAgent(_node->getPosition());
-			_agent = _crowd->getAgent(_agentID);
+			_agentID = _crowd->addAgent(_node->getPosition(),DEFAULT_MAXSPEED,_filter);
 			_destination = _crowd->getLastDestination();
 			_manualVelocity = Ogre::Vector3::ZERO;
 			_isStopped = true;
@@ -190,13 +200,38 @@ void Character::setAgentControlled(bool agentControlled)
 	return;
 }
 
+void Character::setFilter(int filter)
+{
+	_filter = filter;
+	if(_isAgentControlled && _crowd)
+	{
+		_crowd->setAgentFilter(_agentID,filter);
+	}
+}
+
+bool Character::setFilter(const std::string& name)
+{
+	int filter = (_crowd) ? _crowd->_getDetour()->getFilterID(name) : -1;
+	if(filter == -1)
+	{
+		return false;
+	}
+
+	setFilter(filter);
+	return true;
+}
+
 void Character::updatePosition(float deltaTimeInSecs)
 {
 	if(_isAgentControlled)
 	{
-		Ogre::Vector3 agentPosition;
-		Utility::floatPtr_toVector3(_agent->npos,agentPosition);
-		_node->setPosition(agentPosition);
+		const CrowdManager::AgentState* state = getAgentState();
+		if(state == nullptr)
+		{
+			return;
+		}
+
+		_node->setPosition(state->position);
 	}
 	else
 	{
@@ -206,7 +241,7 @@ void Character::updatePosition(float deltaTimeInSecs)
 		}
 
 		Ogre::Vector3 testPosition = getPosition() + deltaTimeInSecs * getVelocity();
-		if(_crowd->_getDetour()->findNearestPointOnNavmesh(testPosition,testPosition))
+		if(_crowd->_getDetour()->findNearestPointOnNavmesh(testPosition,testPosition,_filter))
 		{
 			_node->setPosition(testPosition);
 		}
@@ -223,4 +258,48 @@ void Character::setDestination(const Ogre::Vector3& destination)
 	_destination = destination;
 	_manualVelocity = Ogre::Vector3::ZERO;
 	_isStopped = false;
+}
+
+void Character::requestPath(const Ogre::Vector3& destination,DetourInterface::DT_PATH_PRIORITY priority)
+{
+	cancelPath();
+	if(!_crowd)
+	{
+		return;
+	}
+
+	_pathRequest = _crowd->_getDetour()->requestPath(getPosition(),destination,_agentID,
+		[this] (DetourInterface::PathRequestID id,DetourInterface::DT_PATHFIND_RETURN result,const PathRef& path) {
+			if(id == _pathRequest)
+			{
+				_pathRequest = 0;
+				onPathFound(result,path);
+			}
+		},priority,_filter);
+}
+
+void Character::cancelPath()
+{
+	if(_pathRequest != 0)
+	{
+		//cleared first, so the cancelled callback doesn't throw away the current path.
+		DetourInterface::PathRequestID request = _pathRequest;
+		_pathRequest = 0;
+		_crowd->_getDetour()->cancelPath(request);
+	}
+}
+
+void Character::onPathFound(DetourInterface::DT_PATHFIND_RETURN result,const PathRef& path)
+{
+	//shares the pooled path, nothing is copied.
+	_path = path;
+	if(result != DetourInterface::DT_PATH_SUCCESS || !_isAgentControlled)
+	{
+		return;
+	}
+
+	//the path ends on the navmesh, so the agent can head straight for its last corner.
+	_crowd->setMoveTarget(path->getVertex(path->getVertexCount() - 1),false,_agentID);
+	_isStopped = false;
+	_manualVelocity = Ogre::Vector3::ZERO;
 }
\ No newline at end of file
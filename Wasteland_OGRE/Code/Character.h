@@ -11,6 +11,7 @@ public:
 	Character(Ogre::SceneManager* scene, CrowdManager* crowd, const Ogre::Vector3& position);
 	Character(Ogre::SceneNode* node,CrowdManager* crowd,const Ogre::Vector3& position);
 	Character();
+	virtual ~Character();
 
 	inline Ogre::SceneNode* getNode() { return _node; }
 	inline Ogre::MovableObject* getMovableObject() { return _movableObject; }
@@ -21,7 +22,11 @@ public:
 	virtual void updateDestination(const Ogre::Vector3& destination,bool updatePrevPath = false);
 
 	inline int getAgentID() { return _agentID; }
-	inline const dtCrowdAgent* getAgent() { return _agent; }
+	//Position and velocity from the last finished crowd step, doesn't wait. Use this one.
+	inline const CrowdManager::AgentState* getAgentState() { return _crowd->getAgentState(_agentID); }
+	//Only for the raw Detour agent, waits for the crowd step.
+	//Looked up every time, the agent moves around as it changes partitions.
+	inline const dtCrowdAgent* getAgent() { return _crowd->getAgent(_agentID); }
 
 	inline Ogre::Vector3 getDestination() { if(_isAgentControlled) return _destination; else return Ogre::Vector3::ZERO; }
 
@@ -54,7 +59,25 @@ public:
 	void setAgentControlled(bool agentControlled);
 	bool getAgentControlled() { return _isAgentControlled; }
 
+	//Filter profile used for the character's paths and crowd agent, see DetourInterface::registerFilter.
+	void setFilter(int filter);
+	//False if there's no profile by that name.
+	bool setFilter(const std::string& name);
+	int getFilter() { return _filter; }
+
+	//Asks for a full path to destination, it's searched over the next crowd ticks and handed to onPathFound.
+	//A request that's still pending is cancelled. Once found, the agent is sent to the end of the path.
+	void requestPath(const Ogre::Vector3& destination,DetourInterface::DT_PATH_PRIORITY priority = DetourInterface::DT_PATH_PRIORITY_NORMAL);
+	void cancelPath();
+	bool isPathPending() { return _pathRequest != 0; }
+
+	//Corners of the last path found, null if there's none.
+	const PathRef& getPath() { return _path; }
+
 protected:
+	//Called when a requested path is done. By default just keeps it for getPath().
+	virtual void onPathFound(DetourInterface::DT_PATHFIND_RETURN result,const PathRef& path);
+
 	virtual void updatePosition(float deltaTime);
 	
 	virtual void setDestination(const Ogre::Vector3& destination);
@@ -67,8 +90,8 @@ protected:
 
 	CrowdManager* _crowd;
 	
-	const dtCrowdAgent* _agent;
 	int _agentID;
+	int _filter;
 
 	Ogre::Vector3 _destination;
 
@@ -77,6 +100,9 @@ protected:
 	bool _isStopped;
 
 	bool _isAgentControlled;
+
+	DetourInterface::PathRequestID _pathRequest;
+	PathRef _path;
 	
 	//Not sure how to integrate Bullet into all this. Ghost collision similar to the player character?
 	//btRigidBody* _rigidBody;
@@ -19,8 +19,7 @@ void CharacterController::create(Ogre::Camera* camera,const Ogre::Vector3& initi
 	cGhostObject->setWorldTransform(initial);
 
 	//collision shape
-	//Patch: uses a member variable instead of a 'new btGhostPairCallback' that causes a memory leak.
-	phyWorld->getPairCache()->setInternalGhostPairCallback(&__pairCallback);
+	//ghost pair callback is installed by the PhysicsManager, which also uses it for trigger volumes.
 	//btScalar charHeight = 1.9f;
 	btScalar charHeight = 1.9f * .5f;
 	btScalar charWidth = .75f;
@@ -34,7 +33,9 @@ void CharacterController::create(Ogre::Camera* camera,const Ogre::Vector3& initi
 	cController = new btKinematicCharacterController(cGhostObject,capsule,charHeight);
 
 	//adding ghost/controller to physics world
-	phyWorld->addCollisionObject(cGhostObject,btBroadphaseProxy::CharacterFilter,btBroadphaseProxy::StaticFilter | btBroadphaseProxy::DefaultFilter);
+	//SensorTrigger is in the mask so the trigger volumes see the player. The PhysicsManager's pair callback keeps
+	//them out of the ghost's overlaps, so the controller doesn't sweep against them.
+	phyWorld->addCollisionObject(cGhostObject,btBroadphaseProxy::CharacterFilter,btBroadphaseProxy::StaticFilter | btBroadphaseProxy::DefaultFilter | btBroadphaseProxy::SensorTrigger);
 	phyWorld->addAction(cController);
 
 	cNode = cCamera->getSceneManager()->getRootSceneNode()->createChildSceneNode("characterController");
@@ -156,11 +157,11 @@ void CharacterController::update(float physicsTimeElapsed,InputManager* inputMan
 	cController->setWalkDirection(walkDirection * walkSpd);
 
 	//positioning the ogre node
+	//the position is interpolated between physics steps by the PhysicsManager, only the orientation is set here.
 	Ogre::Quaternion ogreRot;
 	ogreRot = Utility::convert_btQuaternion(cGhostObject->getWorldTransform().getRotation());
-	Ogre::Vector3 ogrePos = Utility::convert_btVector3(cGhostObject->getWorldTransform().getOrigin());
+	Ogre::Vector3 ogrePos;
 
-	cNode->setPosition(ogrePos);
 	Ogre::Quaternion zRot = cNode->getOrientation();
 	//getting rid of x and y axis rotation.
 	//zRot.x = 0;
@@ -22,6 +22,8 @@ public:
 	void update(float physicsTimeElapsed,InputManager* inputManager, OgreTransform& transform);
 
 	Ogre::SceneNode* getNode() { return cNode; }
+	//Moved by Bullet, the PhysicsManager interpolates the node's position from it.
+	btCollisionObject* getGhostObject() { return cGhostObject; }
 
 	void shutdown() { _world->removeAction(cController); _world->removeCollisionObject(cGhostObject); }
 
@@ -31,8 +33,6 @@ private:
 	Ogre::Camera* cCamera;
 	Ogre::SceneNode* cNode;
 
-	btGhostPairCallback __pairCallback;
-
 	btKinematicCharacterController* cController;
 	btPairCachingGhostObject* cGhostObject;
 	btDiscreteDynamicsWorld* _world;
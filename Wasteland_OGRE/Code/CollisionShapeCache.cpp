@@ -0,0 +1,278 @@
+#include "StdAfx.h"
+
+#include "CollisionShapeCache.h"
+
+#include <BulletCollision\CollisionShapes\btOptimizedBvh.h>
+#include <fstream>
+
+/*
+Triangle mesh cache file layout:
+ShapeFileHeader
+float triangles[triangleCount * 9]
+char bvh[bvhSize]	-- btOptimizedBvh::serializeInPlace output, deserialized in place after loading
+*/
+namespace
+{
+#pragma pack(push,1)
+	struct ShapeFileHeader
+	{
+		char magic[4];
+		Ogre::uint32 version;
+		Ogre::uint64 meshHash;
+		Ogre::uint32 triangleCount;
+		Ogre::uint32 bvhSize;
+	};
+#pragma pack(pop)
+
+	const char SHAPE_MAGIC[4] = { 'W','C','O','L' };
+	//Bump whenever the layout changes.
+	const Ogre::uint32 SHAPE_VERSION = 1;
+	//btQuantizedBvh wants its buffer 16 byte aligned.
+	const int BVH_ALIGNMENT = 16;
+
+	//64-bit FNV-1a of the triangle positions.
+	Ogre::uint64 hashTriangles(const std::vector<btVector3>& triangles)
+	{
+		Ogre::uint64 hash = 14695981039346656037ULL;
+		for(auto itr = triangles.begin(); itr != triangles.end(); ++itr)
+		{
+			float xyz[3] = { itr->x(),itr->y(),itr->z() };
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(xyz);
+			for(size_t i = 0; i < sizeof(xyz); ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ULL;
+			}
+		}
+		return hash;
+	}
+}
+
+CollisionShapeCache::CollisionShapeCache()
+{
+}
+
+CollisionShapeCache::~CollisionShapeCache()
+{
+	clear();
+}
+
+btCollisionShape* CollisionShapeCache::acquire(const std::string& key)
+{
+	auto itr = _entries.find(key);
+	if(itr == _entries.end())
+	{
+		return nullptr;
+	}
+
+	++itr->second.references;
+	return itr->second.shape;
+}
+
+btCollisionShape* CollisionShapeCache::insert(const std::string& key,btCollisionShape* shape,
+											  btStridingMeshInterface* mesh,void* bvhBuffer)
+{
+	if(_entries.find(key) != _entries.end())
+	{
+		std::cout << "Error! CollisionShapeCache - a shape is already stored as " << key << std::endl;
+		return nullptr;
+	}
+
+	Entry entry;
+	entry.shape = shape;
+	entry.mesh = mesh;
+	entry.bvhBuffer = bvhBuffer;
+	entry.references = 1;
+	_entries[key] = entry;
+	_keys[shape] = key;
+
+	return shape;
+}
+
+bool CollisionShapeCache::release(btCollisionShape* shape)
+{
+	auto keyItr = _keys.find(shape);
+	if(keyItr == _keys.end())
+	{
+		return false;
+	}
+
+	auto itr = _entries.find(keyItr->second);
+	if(--itr->second.references <= 0)
+	{
+		_destroy(itr->second);
+		_entries.erase(itr);
+		_keys.erase(keyItr);
+	}
+
+	return true;
+}
+
+void CollisionShapeCache::clear()
+{
+	for(auto itr = _entries.begin(); itr != _entries.end(); ++itr)
+	{
+		_destroy(itr->second);
+	}
+	_entries.clear();
+	_keys.clear();
+}
+
+void CollisionShapeCache::_destroy(Entry& entry)
+{
+	//shape first, it still points into the mesh and the BVH buffer.
+	delete entry.shape;
+	delete entry.mesh;
+	if(entry.bvhBuffer)
+	{
+		btAlignedFree(entry.bvhBuffer);
+	}
+}
+
+btBvhTriangleMeshShape* CollisionShapeCache::createTriangleMeshShape(const std::string& key,const std::vector<btVector3>& triangles,
+																	 const std::string& cacheFile)
+{
+	btCollisionShape* shared = acquire(key);
+	if(shared)
+	{
+		return static_cast<btBvhTriangleMeshShape*>(shared);
+	}
+
+	Ogre::uint64 hash = hashTriangles(triangles);
+	if(!cacheFile.empty())
+	{
+		btBvhTriangleMeshShape* loaded = _loadFile(key,cacheFile,&hash);
+		if(loaded)
+		{
+			return loaded;
+		}
+	}
+
+	btTriangleMesh* mesh = new btTriangleMesh();
+	for(size_t i = 0; i + 2 < triangles.size(); i += 3)
+	{
+		mesh->addTriangle(triangles[i],triangles[i+1],triangles[i+2]);
+	}
+
+	btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(mesh,true,true);
+	insert(key,shape,mesh);
+
+	if(!cacheFile.empty())
+	{
+		_saveFile(cacheFile,shape,triangles,hash);
+	}
+
+	return shape;
+}
+
+btBvhTriangleMeshShape* CollisionShapeCache::loadTriangleMeshShape(const std::string& key,const std::string& file)
+{
+	btCollisionShape* shared = acquire(key);
+	if(shared)
+	{
+		return static_cast<btBvhTriangleMeshShape*>(shared);
+	}
+
+	btBvhTriangleMeshShape* shape = _loadFile(key,file,nullptr);
+	if(shape == nullptr)
+	{
+		std::cout << "Error! CollisionShapeCache - could not load collision shape " << file << std::endl;
+	}
+	return shape;
+}
+
+btBvhTriangleMeshShape* CollisionShapeCache::_loadFile(const std::string& key,const std::string& file,const Ogre::uint64* expectedHash)
+{
+	std::ifstream in(file.c_str(),std::ios::in | std::ios::binary);
+	if(!in.is_open())
+	{
+		return nullptr;
+	}
+
+	ShapeFileHeader header;
+	in.read(reinterpret_cast<char*>(&header),sizeof(header));
+	if(!in || memcmp(header.magic,SHAPE_MAGIC,sizeof(SHAPE_MAGIC)) != 0 || header.version != SHAPE_VERSION)
+	{
+		return nullptr;
+	}
+	if(expectedHash && header.meshHash != *expectedHash)
+	{
+		//mesh was changed since the file was written.
+		return nullptr;
+	}
+
+	std::vector<float> positions(header.triangleCount * 9);
+	if(!positions.empty())
+	{
+		in.read(reinterpret_cast<char*>(&positions[0]),positions.size() * sizeof(float));
+	}
+
+	void* bvhBuffer = btAlignedAlloc(header.bvhSize,BVH_ALIGNMENT);
+	in.read(static_cast<char*>(bvhBuffer),header.bvhSize);
+	if(!in)
+	{
+		btAlignedFree(bvhBuffer);
+		return nullptr;
+	}
+
+	btOptimizedBvh* bvh = static_cast<btOptimizedBvh*>(btQuantizedBvh::deSerializeInPlace(bvhBuffer,header.bvhSize,false));
+	if(bvh == nullptr)
+	{
+		btAlignedFree(bvhBuffer);
+		return nullptr;
+	}
+
+	//same triangle order as when the BVH was built, its leaves refer to triangles by index.
+	btTriangleMesh* mesh = new btTriangleMesh();
+	for(size_t i = 0; i < positions.size(); i += 9)
+	{
+		mesh->addTriangle(btVector3(positions[i],positions[i+1],positions[i+2]),
+						  btVector3(positions[i+3],positions[i+4],positions[i+5]),
+						  btVector3(positions[i+6],positions[i+7],positions[i+8]));
+	}
+
+	btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(mesh,true,false);
+	shape->setOptimizedBvh(bvh);
+
+	insert(key,shape,mesh,bvhBuffer);
+	return shape;
+}
+
+bool CollisionShapeCache::_saveFile(const std::string& file,btBvhTriangleMeshShape* shape,const std::vector<btVector3>& triangles,Ogre::uint64 hash)
+{
+	btOptimizedBvh* bvh = shape->getOptimizedBvh();
+	unsigned int bvhSize = bvh->calculateSerializeBufferSize();
+	void* bvhBuffer = btAlignedAlloc(bvhSize,BVH_ALIGNMENT);
+	if(!bvh->serializeInPlace(bvhBuffer,bvhSize,false))
+	{
+		btAlignedFree(bvhBuffer);
+		std::cout << "Error! CollisionShapeCache - could not serialize BVH for " << file << std::endl;
+		return false;
+	}
+
+	std::ofstream out(file.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open())
+	{
+		btAlignedFree(bvhBuffer);
+		std::cout << "Error! CollisionShapeCache - could not write " << file << std::endl;
+		return false;
+	}
+
+	ShapeFileHeader header;
+	memcpy(header.magic,SHAPE_MAGIC,sizeof(SHAPE_MAGIC));
+	header.version = SHAPE_VERSION;
+	header.meshHash = hash;
+	header.triangleCount = static_cast<Ogre::uint32>(triangles.size() / 3);
+	header.bvhSize = bvhSize;
+	out.write(reinterpret_cast<const char*>(&header),sizeof(header));
+
+	for(size_t i = 0; i < header.triangleCount * 3; ++i)
+	{
+		float xyz[3] = { triangles[i].x(),triangles[i].y(),triangles[i].z() };
+		out.write(reinterpret_cast<const char*>(xyz),sizeof(xyz));
+	}
+	out.write(static_cast<const char*>(bvhBuffer),bvhSize);
+
+	btAlignedFree(bvhBuffer);
+	return out.good();
+}
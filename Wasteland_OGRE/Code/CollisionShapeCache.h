@@ -0,0 +1,78 @@
+#include "StdAfx.h"
+
+#ifndef _COLLISION_SHAPE_CACHE_H_
+#define _COLLISION_SHAPE_CACHE_H_
+
+#include <btBulletCollisionCommon.h>
+#include <map>
+
+/*! \brief Reference counted collision shapes, shared between every body that's described the same way.
+
+Triangle mesh shapes can also keep their BVH on disk, so it doesn't have to be rebuilt every time the level loads.
+*/
+class CollisionShapeCache
+{
+public:
+	CollisionShapeCache();
+	//! Deletes every shape, whether it's still referenced or not.
+	~CollisionShapeCache();
+
+	//! Returns the shape stored under key with one more reference to it, or null if there's none.
+	btCollisionShape* acquire(const std::string& key);
+
+	//! Stores a new shape under key, the caller holds the first reference.
+	/*!
+		The cache owns the shape from now on.
+		\param mesh Triangle data used by the shape, deleted with it.
+		\param bvhBuffer Aligned buffer the shape's BVH lives in, freed with it.
+	*/
+	btCollisionShape* insert(const std::string& key,btCollisionShape* shape,
+							 btStridingMeshInterface* mesh = nullptr,void* bvhBuffer = nullptr);
+
+	//! Drops a reference, the shape is deleted along with the last one.
+	/*!
+		\returns false if the shape isn't owned by the cache.
+	*/
+	bool release(btCollisionShape* shape);
+
+	//! Whether the shape is owned by the cache.
+	bool contains(btCollisionShape* shape) { return _keys.find(shape) != _keys.end(); }
+
+	//! Deletes every shape.
+	void clear();
+
+	//! Builds a static triangle mesh shape, or shares the one already stored under key.
+	/*!
+		\param triangles Three vertices per triangle.
+		\param cacheFile The BVH is loaded from here if the file was written from the same triangles,
+						 otherwise it's built and saved to it. Empty to skip the file.
+	*/
+	btBvhTriangleMeshShape* createTriangleMeshShape(const std::string& key,const std::vector<btVector3>& triangles,
+													const std::string& cacheFile);
+
+	//! Loads a triangle mesh shape saved by createTriangleMeshShape, or shares the one already stored under key.
+	/*!
+		Used for "Custom" collision shapes. Returns null if the file can't be read.
+	*/
+	btBvhTriangleMeshShape* loadTriangleMeshShape(const std::string& key,const std::string& file);
+
+private:
+	struct Entry
+	{
+		btCollisionShape* shape;
+		btStridingMeshInterface* mesh;
+		void* bvhBuffer;
+		int references;
+	};
+
+	void _destroy(Entry& entry);
+
+	//expectedHash is checked against the stored triangles if it's given.
+	btBvhTriangleMeshShape* _loadFile(const std::string& key,const std::string& file,const Ogre::uint64* expectedHash);
+	bool _saveFile(const std::string& file,btBvhTriangleMeshShape* shape,const std::vector<btVector3>& triangles,Ogre::uint64 hash);
+
+	std::map<std::string,Entry> _entries;
+	std::map<btCollisionShape*,std::string> _keys;
+};
+
+#endif
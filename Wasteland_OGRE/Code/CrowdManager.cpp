@@ -5,8 +5,7 @@
 #include "Utility.h"
 
 CrowdManager::CrowdManager(DetourInterface* detour,rcdtConfig* config)
-	: _crowd(nullptr),
-	  _detour(detour),
+	: _detour(detour),
 	  _targetRef(0),
 	  _activeAgents(0),
 	  _anticipateTurns(true),
@@ -15,89 +14,133 @@ CrowdManager::CrowdManager(DetourInterface* detour,rcdtConfig* config)
 	  _obstacleAvoidance(true),
 	  _separation(false),
 	  _separationWeight(2.0f),
-	  _config(*config)
+	  _config(*config),
+	  _pathIterationBudget(DEFAULT_PATH_ITERATIONS),
+	  _tileUpdateBudget(DEFAULT_TILE_UPDATES),
+	  _trailsEnabled(false),
+	  _workers(std::max(WorkerPool::getCoreCount() - 1,1)),
+	  _stepping(false),
+	  _readState(0)
 {
-	_crowd = dtAllocCrowd();
-	if(!_crowd)
+	//same extents a dtCrowd uses for its own queries.
+	float radius = config->userConfig->_getWalkableRadius();
+	_queryExtents[0] = radius * 2.0f;
+	_queryExtents[1] = radius * 1.5f;
+	_queryExtents[2] = radius * 2.0f;
+
+	_partitionMargin = config->userConfig->getAgentRadius() * 4.0f;
+
+	//a solo navmesh is one big tile, so small levels end up with a single region.
+	//Regions are counted from the navmesh origin, so they line up with its tiles wherever the level is.
+	_partitionSize = 0.0f;
+	_regionOrigin[0] = _regionOrigin[1] = 0.0f;
+	dtNavMesh* nav = detour->getNavMesh();
+	if(nav)
 	{
-		std::cout << "Detour: Couldn't allocate crowd instance." << std::endl;
-		Ogre::LogManager::getSingleton().logMessage("Detour: Could not allocate crowd instance.");
+		const dtNavMeshParams* params = nav->getParams();
+		_partitionSize = std::max(params->tileWidth,params->tileHeight) * DEFAULT_PARTITION_TILES;
+		_regionOrigin[0] = params->orig[0];
+		_regionOrigin[1] = params->orig[2];
+	}
+	if(_partitionSize <= 0.0f)
+	{
+		_partitionSize = 1000.0f;
 	}
+}
 
-	memset(_trails,0,sizeof(_trails));
+CrowdManager::~CrowdManager()
+{
+	waitForUpdate();
 
-	dtNavMesh* nav = detour->getNavMesh();
-	dtCrowd* crowd = _crowd;
-	if(nav && crowd && crowd->getAgentCount() == 0)
+	for(auto itr = _agents.begin(); itr != _agents.end(); ++itr)
 	{
-		crowd->init(MAX_AGENTS,config->userConfig->_getWalkableRadius(),nav);
-		//crowd->init(MAX_AGENTS,static_cast<float>(config->recastConfig->walkableRadius),nav);
+		delete itr->trail;
+	}
 
-		//excludes disabled polygons.
-		crowd->getEditableFilter()->setExcludeFlags(0x10);
+	for(auto itr = _partitions.begin(); itr != _partitions.end(); ++itr)
+	{
+		dtFreeCrowd((*itr)->crowd);
+		delete *itr;
+	}
+	//dtFreeObstacleAvoidanceDebugData(_vod);
+}
 
-		dtObstacleAvoidanceParams params;
-		memcpy(&params,crowd->getObstacleAvoidanceParams(0),sizeof(dtObstacleAvoidanceParams));
+void CrowdManager::updateTick(float deltaTime)
+{
+	if(!_detour->getNavMesh())
+	{
+		return;
+	}
 
-		// Low (11)
-        params.velBias = 0.5f;
-        params.adaptiveDivs = 5;
-        params.adaptiveRings = 2;
-        params.adaptiveDepth = 1;
-        crowd->setObstacleAvoidanceParams(0, &params);
+	waitForUpdate();
 
-        // Medium (22)
-        params.velBias = 0.5f;
-        params.adaptiveDivs = 5;
-        params.adaptiveRings = 2;
-        params.adaptiveDepth = 2;
-        crowd->setObstacleAvoidanceParams(1, &params);
+	//obstacles change the navmesh, which the step and the path requests read, so tiles are rebuilt here
+	//while nothing else is using it. Agents on a rebuilt tile find their way back onto the new polygons.
+	_detour->updateTileCache(deltaTime,_tileUpdateBudget);
 
-        // Good (45)
-        params.velBias = 0.5f;
-        params.adaptiveDivs = 7;
-        params.adaptiveRings = 2;
-        params.adaptiveDepth = 3;
-        crowd->setObstacleAvoidanceParams(2, &params);
+	_migrateAgents();
+	_removeEmptyPartitions();
 
-        // High (66)
-        params.velBias = 0.5f;
-        params.adaptiveDivs = 7;
-        params.adaptiveRings = 3;
-        params.adaptiveDepth = 3;
-		crowd->setObstacleAvoidanceParams(3,&params);
+	//the crowds don't share anything but the navmesh, which is only read while stepping.
+	_stepping = !_partitions.empty();
+	for(auto itr = _partitions.begin(); itr != _partitions.end(); ++itr)
+	{
+		Partition* partition = *itr;
+		_workers.push([this,partition,deltaTime] () {
+			_stepPartition(partition,deltaTime);
+		});
 	}
-}
 
-CrowdManager::~CrowdManager()
-{
-	dtFreeCrowd(_crowd);
-	//dtFreeObstacleAvoidanceDebugData(_vod);
+	//spreads re-pathing of many characters over several frames instead of spiking this one.
+	//Uses the DetourInterface's own query, so it can run alongside the step.
+	_detour->updatePathRequests(_pathIterationBudget);
+
+	//_agentDebug.vod->normalizeSamples();
 }
 
-void CrowdManager::updateTick(float deltaTime)
+void CrowdManager::waitForUpdate()
 {
-	if(!_detour->getNavMesh() || !_crowd)
+	if(!_stepping)
 	{
 		return;
 	}
 
-	_crowd->update(deltaTime,NULL);
+	_workers.wait();
+	_readState = 1 - _readState;
+	_stepping = false;
+
+	_flushPendingRequests();
+}
+
+void CrowdManager::_stepPartition(Partition* partition,float deltaTime)
+{
+	partition->crowd->update(deltaTime,NULL);
 
-	for(int i = 0; i < _crowd->getAgentCount(); ++i)
+	std::vector<AgentState>& states = _states[1 - _readState];
+	for(int i = 0; i < PARTITION_MAX_AGENTS; ++i)
 	{
-		const dtCrowdAgent* agent = _crowd->getAgent(i);
-		AgentTrail* trail = &_trails[i];
-		if(!agent->active)
+		int id = partition->agentIDs[i];
+		if(id == -1)
 		{
 			continue;
 		}
 
-		trail->htrail = (trail->htrail + 1) % AGENT_MAX_TRAIL_LENGTH;
-		dtVcopy(&trail->trail[trail->htrail*3],agent->npos);
+		const dtCrowdAgent* agent = partition->crowd->getAgent(i);
+		AgentState& state = states[id];
+		Utility::floatPtr_toVector3(agent->npos,state.position);
+		Utility::floatPtr_toVector3(agent->nvel,state.velocity);
+		state.maxSpeed = agent->params.maxSpeed;
+		state.maxAcceleration = agent->params.maxAcceleration;
+		state.active = (agent->active != 0);
+
+		//an agent is only ever in one crowd, so no other job touches its trail.
+		AgentTrail* trail = _agents[id].trail;
+		if(trail != nullptr)
+		{
+			trail->htrail = (trail->htrail + 1) % AGENT_MAX_TRAIL_LENGTH;
+			dtVcopy(&trail->trail[trail->htrail*3],agent->npos);
+		}
 	}
-
-	//_agentDebug.vod->normalizeSamples();
 }
 
 int CrowdManager::addAgent(const Ogre::Vector3& position)
@@ -106,7 +149,7 @@ int CrowdManager::addAgent(const Ogre::Vector3& position)
 	return addAgent(position,DEFAULT_MAXSPEED);
 }
 
-int CrowdManager::addAgent(const Ogre::Vector3& position,float maxSpeedFactor)
+int CrowdManager::addAgent(const Ogre::Vector3& position,float maxSpeedFactor,int filter)
 {
 	dtCrowdAgentParams ap;
 	memset(&ap,0,sizeof(ap));
@@ -117,106 +160,534 @@ int CrowdManager::addAgent(const Ogre::Vector3& position,float maxSpeedFactor)
 	ap.collisionQueryRange = ap.radius * 12.0f;
 	ap.pathOptimizationRange = ap.radius * 30.0f;
 
-	ap.updateFlags = 0;
-	if(_anticipateTurns)
+	_setQualityParams(ap,AGENT_QUALITY_HIGH);
+
+	waitForUpdate();
+
+	int id;
+	if(!_freeAgents.empty())
 	{
-		ap.updateFlags |= DT_CROWD_ANTICIPATE_TURNS;
+		id = _freeAgents.back();
+		_freeAgents.pop_back();
 	}
-	if(_optimizeVis)
+	else
 	{
-		ap.updateFlags |= DT_CROWD_OPTIMIZE_VIS;
+		id = static_cast<int>(_agents.size());
+		_agents.push_back(AgentSlot());
 	}
-	if(_optimizeTopo)
+
+	AgentSlot& slot = _agents[id];
+	slot.partition = nullptr;
+	slot.index = -1;
+	slot.request = MOVE_NONE;
+	slot.targetRef = 0;
+	slot.trail = nullptr;
+	slot.requestPending = false;
+	slot.pendingQuality = -1;
+
+	float p[3];
+	Utility::vector3_toFloatPtr(position,p);
+	if(!_placeAgent(id,p,ap,filter))
 	{
-		ap.updateFlags |= DT_CROWD_OPTIMIZE_TOPO;
+		_freeAgents.push_back(id);
+		return -1;
 	}
-	if(_obstacleAvoidance)
+
+	if(_targetRef)
 	{
-		ap.updateFlags |= DT_CROWD_OBSTACLE_AVOIDANCE;
+		slot.request = MOVE_TARGET;
+		slot.targetRef = _targetRef;
+		dtVcopy(slot.target,_targetPosition);
+		_reissueRequest(id);
 	}
-	if(_separation)
+
+	if(_trailsEnabled)
 	{
-		ap.updateFlags |= DT_CROWD_SEPARATION;
+		slot.trail = new AgentTrail;
+		for(int i = 0; i < AGENT_MAX_TRAIL_LENGTH; ++i)
+		{
+			dtVcopy(&slot.trail->trail[i * 3],p);
+		}
+		slot.trail->htrail = 0;
 	}
-	//ap.obstacleAvoidanceType = static_cast<unsigned char>(_obstacleAvoidanceType);
-	ap.obstacleAvoidanceType = static_cast<unsigned char>(3.0f);
 
-	float p[3];
-	Utility::vector3_toFloatPtr(position,p);
-	int id = _crowd->addAgent(p,&ap);
-	if(id != -1)
+	//both buffers, it's read before its first step is done.
+	AgentState state;
+	state.position = position;
+	state.velocity = Ogre::Vector3::ZERO;
+	state.maxSpeed = ap.maxSpeed;
+	state.maxAcceleration = ap.maxAcceleration;
+	state.active = true;
+	for(int i = 0; i < 2; ++i)
+	{
+		if(_states[i].size() < _agents.size())
+		{
+			_states[i].resize(_agents.size());
+		}
+		_states[i][id] = state;
+	}
+
+	_activeAgents++;
+
+	return id;
+}
+
+void CrowdManager::_regionAt(const float* position,int& regionX,int& regionZ)
+{
+	regionX = static_cast<int>(floor((position[0] - _regionOrigin[0]) / _partitionSize));
+	regionZ = static_cast<int>(floor((position[2] - _regionOrigin[1]) / _partitionSize));
+}
+
+CrowdManager::Partition* CrowdManager::_getPartition(int regionX,int regionZ,int filter)
+{
+	auto range = _regions.equal_range(std::make_pair(regionX,regionZ));
+	for(auto itr = range.first; itr != range.second; ++itr)
+	{
+		if(itr->second->filter == filter && itr->second->agentCount < PARTITION_MAX_AGENTS)
+		{
+			return itr->second;
+		}
+	}
+
+	dtNavMesh* nav = _detour->getNavMesh();
+	dtCrowd* crowd = dtAllocCrowd();
+	if(!nav || !crowd || !crowd->init(PARTITION_MAX_AGENTS,_config.userConfig->_getWalkableRadius(),nav))
+	{
+		std::cout << "Detour: Couldn't allocate crowd instance." << std::endl;
+		Ogre::LogManager::getSingleton().logMessage("Detour: Could not allocate crowd instance.");
+		dtFreeCrowd(crowd);
+		return nullptr;
+	}
+
+	//a dtCrowd has the one filter, so every profile gets crowds of its own.
+	*crowd->getEditableFilter() = *_detour->getFilter(filter);
+
+	dtObstacleAvoidanceParams params;
+	memcpy(&params,crowd->getObstacleAvoidanceParams(0),sizeof(dtObstacleAvoidanceParams));
+
+	// Low (11)
+	params.velBias = 0.5f;
+	params.adaptiveDivs = 5;
+	params.adaptiveRings = 2;
+	params.adaptiveDepth = 1;
+	crowd->setObstacleAvoidanceParams(0, &params);
+
+	// Medium (22)
+	params.velBias = 0.5f;
+	params.adaptiveDivs = 5;
+	params.adaptiveRings = 2;
+	params.adaptiveDepth = 2;
+	crowd->setObstacleAvoidanceParams(1, &params);
+
+	// Good (45)
+	params.velBias = 0.5f;
+	params.adaptiveDivs = 7;
+	params.adaptiveRings = 2;
+	params.adaptiveDepth = 3;
+	crowd->setObstacleAvoidanceParams(2, &params);
+
+	// High (66)
+	params.velBias = 0.5f;
+	params.adaptiveDivs = 7;
+	params.adaptiveRings = 3;
+	params.adaptiveDepth = 3;
+	crowd->setObstacleAvoidanceParams(3,&params);
+
+	Partition* partition = new Partition;
+	partition->crowd = crowd;
+	partition->regionX = regionX;
+	partition->regionZ = regionZ;
+	partition->filter = filter;
+	partition->agentCount = 0;
+	std::fill(partition->agentIDs,partition->agentIDs + PARTITION_MAX_AGENTS,-1);
+
+	_partitions.push_back(partition);
+	_regions.insert(std::make_pair(std::make_pair(regionX,regionZ),partition));
+	return partition;
+}
+
+bool CrowdManager::_placeAgent(int id,const float* position,const dtCrowdAgentParams& params,int filter)
+{
+	int regionX,regionZ;
+	_regionAt(position,regionX,regionZ);
+	Partition* partition = _getPartition(regionX,regionZ,filter);
+	if(partition == nullptr)
+	{
+		return false;
+	}
+
+	int index = partition->crowd->addAgent(position,&params);
+	if(index == -1)
+	{
+		return false;
+	}
+
+	partition->agentIDs[index] = id;
+	partition->agentCount++;
+	_agents[id].partition = partition;
+	_agents[id].index = index;
+	return true;
+}
+
+void CrowdManager::_migrateAgents()
+{
+	for(int id = 0; id < static_cast<int>(_agents.size()); ++id)
+	{
+		AgentSlot& slot = _agents[id];
+		Partition* old = slot.partition;
+		if(old == nullptr)
+		{
+			continue;
+		}
+
+		const dtCrowdAgent* agent = old->crowd->getAgent(slot.index);
+		float minX = _regionOrigin[0] + old->regionX * _partitionSize - _partitionMargin;
+		float maxX = _regionOrigin[0] + (old->regionX + 1) * _partitionSize + _partitionMargin;
+		float minZ = _regionOrigin[1] + old->regionZ * _partitionSize - _partitionMargin;
+		float maxZ = _regionOrigin[1] + (old->regionZ + 1) * _partitionSize + _partitionMargin;
+		if(agent->npos[0] >= minX && agent->npos[0] <= maxX && agent->npos[2] >= minZ && agent->npos[2] <= maxZ)
+		{
+			continue;
+		}
+
+		_moveAgent(id,old->filter);
+	}
+}
+
+bool CrowdManager::_moveAgent(int id,int filter)
+{
+	AgentSlot& slot = _agents[id];
+	Partition* old = slot.partition;
+	const dtCrowdAgent* agent = old->crowd->getAgent(slot.index);
+
+	//into the new crowd first, if that fails the agent just stays where it is.
+	float position[3];
+	dtVcopy(position,agent->npos);
+	dtCrowdAgentParams params = agent->params;
+	int oldIndex = slot.index;
+	if(!_placeAgent(id,position,params,filter))
+	{
+		slot.partition = old;
+		slot.index = oldIndex;
+		return false;
+	}
+
+	old->crowd->removeAgent(oldIndex);
+	old->agentIDs[oldIndex] = -1;
+	old->agentCount--;
+
+	_reissueRequest(id);
+	return true;
+}
+
+bool CrowdManager::setAgentFilter(int id,int filter)
+{
+	if(!_isValid(id))
+	{
+		return false;
+	}
+
+	if(filter < 0 || filter >= _detour->getFilterCount())
+	{
+		filter = DetourInterface::DT_FILTER_DEFAULT;
+	}
+	if(_agents[id].partition->filter == filter)
+	{
+		return true;
+	}
+
+	waitForUpdate();
+	return _moveAgent(id,filter);
+}
+
+int CrowdManager::getAgentFilter(int id)
+{
+	return _isValid(id) ? _agents[id].partition->filter : DetourInterface::DT_FILTER_DEFAULT;
+}
+
+void CrowdManager::_reissueRequest(int id)
+{
+	AgentSlot& slot = _agents[id];
+	switch(slot.request)
+	{
+	case MOVE_TARGET:
+		slot.partition->crowd->requestMoveTarget(slot.index,slot.targetRef,slot.target);
+		break;
+	case MOVE_VELOCITY:
+		slot.partition->crowd->requestMoveVelocity(slot.index,slot.target);
+		break;
+	default:
+		break;
+	}
+}
+
+void CrowdManager::_requestChanged(int id)
+{
+	if(_stepping)
+	{
+		_agents[id].requestPending = true;
+	}
+	else
+	{
+		_reissueRequest(id);
+	}
+}
+
+void CrowdManager::_flushPendingRequests()
+{
+	for(int id = 0; id < static_cast<int>(_agents.size()); ++id)
 	{
-		if(_targetRef)
+		AgentSlot& slot = _agents[id];
+		if(slot.partition == nullptr)
+		{
+			continue;
+		}
+
+		if(slot.pendingQuality != -1)
+		{
+			dtCrowdAgentParams ap = slot.partition->crowd->getAgent(slot.index)->params;
+			_setQualityParams(ap,static_cast<AGENT_QUALITY>(slot.pendingQuality));
+			slot.partition->crowd->updateAgentParameters(slot.index,&ap);
+			slot.pendingQuality = -1;
+		}
+
+		if(slot.requestPending)
 		{
-			_crowd->requestMoveTarget(id,_targetRef,_targetPosition);
+			_reissueRequest(id);
+			slot.requestPending = false;
 		}
+	}
+}
 
-		AgentTrail* trail = &_trails[id];
+void CrowdManager::_removeEmptyPartitions()
+{
+	for(auto itr = _partitions.begin(); itr != _partitions.end();)
+	{
+		Partition* partition = *itr;
+		if(partition->agentCount > 0)
+		{
+			++itr;
+			continue;
+		}
+
+		auto range = _regions.equal_range(std::make_pair(partition->regionX,partition->regionZ));
+		for(auto region = range.first; region != range.second; ++region)
+		{
+			if(region->second == partition)
+			{
+				_regions.erase(region);
+				break;
+			}
+		}
+
+		dtFreeCrowd(partition->crowd);
+		delete partition;
+		itr = _partitions.erase(itr);
+	}
+}
+
+void CrowdManager::setPartitionSize(float size)
+{
+	waitForUpdate();
+
+	if(size > 0.0f)
+	{
+		_partitionSize = size;
+	}
+}
+
+void CrowdManager::setTrailsEnabled(bool enabled)
+{
+	if(enabled == _trailsEnabled)
+	{
+		return;
+	}
+	_trailsEnabled = enabled;
+	waitForUpdate();
+
+	for(auto itr = _agents.begin(); itr != _agents.end(); ++itr)
+	{
+		if(!enabled || itr->partition == nullptr)
+		{
+			delete itr->trail;
+			itr->trail = nullptr;
+			continue;
+		}
+
+		const dtCrowdAgent* agent = itr->partition->crowd->getAgent(itr->index);
+		itr->trail = new AgentTrail;
 		for(int i = 0; i < AGENT_MAX_TRAIL_LENGTH; ++i)
 		{
-			dtVcopy(&trail->trail[i * 3],p);
+			dtVcopy(&itr->trail->trail[i * 3],agent->npos);
 		}
-		trail->htrail = 0;
+		itr->trail->htrail = 0;
 	}
+}
 
-	_activeAgents++;
+const CrowdManager::AgentTrail* CrowdManager::getTrail(int id)
+{
+	if(id < 0 || id >= static_cast<int>(_agents.size()))
+	{
+		return nullptr;
+	}
+	return _agents[id].trail;
+}
 
-	return id;
+DetourInterface::PathRequestID CrowdManager::requestPath(int agentID,const Ogre::Vector3& destination,
+														const DetourInterface::PathCallback& callback,
+														DetourInterface::DT_PATH_PRIORITY priority)
+{
+	const AgentState* state = getAgentState(agentID);
+	if(!state || !state->active)
+	{
+		return 0;
+	}
+
+	return _detour->requestPath(state->position,destination,agentID,callback,priority,getAgentFilter(agentID));
+}
+
+bool CrowdManager::cancelPath(DetourInterface::PathRequestID id)
+{
+	return _detour->cancelPath(id);
+}
+
+const CrowdManager::AgentState* CrowdManager::getAgentState(int id)
+{
+	if(!_isValid(id))
+	{
+		return nullptr;
+	}
+	return &_states[_readState][id];
 }
 
 const dtCrowdAgent* CrowdManager::getAgent(int id)
 {
-	return _crowd->getAgent(id);
+	if(!_isValid(id))
+	{
+		return nullptr;
+	}
+
+	waitForUpdate();
+	return _agents[id].partition->crowd->getAgent(_agents[id].index);
 }
 
 void CrowdManager::removeAgent(int id)
 {
-	_crowd->removeAgent(id);
+	if(!_isValid(id))
+	{
+		return;
+	}
+
+	waitForUpdate();
+
+	AgentSlot& slot = _agents[id];
+	slot.partition->crowd->removeAgent(slot.index);
+	slot.partition->agentIDs[slot.index] = -1;
+	//the crowd itself goes at the start of the next tick, in case the agent is just being re-added.
+	slot.partition->agentCount--;
+	slot.partition = nullptr;
+	slot.index = -1;
+	_states[0][id].active = false;
+	_states[1][id].active = false;
+
+	delete slot.trail;
+	slot.trail = nullptr;
+
+	_freeAgents.push_back(id);
 	_activeAgents--;
 }
 
+void CrowdManager::setAgentQuality(int id,AGENT_QUALITY quality)
+{
+	if(!_isValid(id))
+	{
+		return;
+	}
+
+	AgentSlot& slot = _agents[id];
+	if(_stepping)
+	{
+		slot.pendingQuality = quality;
+		return;
+	}
+
+	dtCrowdAgentParams ap = slot.partition->crowd->getAgent(slot.index)->params;
+	_setQualityParams(ap,quality);
+	slot.partition->crowd->updateAgentParameters(slot.index,&ap);
+}
+
+void CrowdManager::_setQualityParams(dtCrowdAgentParams& ap,AGENT_QUALITY quality)
+{
+	ap.updateFlags = 0;
+	if(_anticipateTurns)
+	{
+		ap.updateFlags |= DT_CROWD_ANTICIPATE_TURNS;
+	}
+	if(_optimizeVis && quality != AGENT_QUALITY_LOW)
+	{
+		ap.updateFlags |= DT_CROWD_OPTIMIZE_VIS;
+	}
+	if(_optimizeTopo && quality == AGENT_QUALITY_HIGH)
+	{
+		ap.updateFlags |= DT_CROWD_OPTIMIZE_TOPO;
+	}
+	if(_obstacleAvoidance && quality != AGENT_QUALITY_LOW)
+	{
+		ap.updateFlags |= DT_CROWD_OBSTACLE_AVOIDANCE;
+	}
+	if(_separation)
+	{
+		ap.updateFlags |= DT_CROWD_SEPARATION;
+	}
+	//indices of the obstacle avoidance params set up in the constructor, High(66) and Low(11).
+	//ap.obstacleAvoidanceType = static_cast<unsigned char>(_obstacleAvoidanceType);
+	ap.obstacleAvoidanceType = static_cast<unsigned char>((quality == AGENT_QUALITY_HIGH) ? 3 : 0);
+}
+
 void CrowdManager::setMoveTarget(const Ogre::Vector3& position,bool adjust,int agentID)
 {
 	dtNavMeshQuery* navQuery = _detour->getNavQuery();
-	const dtQueryFilter* filter = _crowd->getFilter();
-	const float* extents = _crowd->getQueryExtents();
 	float pos[3];
 	Utility::vector3_toFloatPtr(position,pos);
 
-	navQuery->findNearestPoly(pos,extents,filter,&_targetRef,_targetPosition);
+	//the whole crowd uses the default profile, a single agent its own.
+	int filter = (agentID != -1) ? getAgentFilter(agentID) : DetourInterface::DT_FILTER_DEFAULT;
+	navQuery->findNearestPoly(pos,_queryExtents,_detour->getFilter(filter),&_targetRef,_targetPosition);
 
-	int start = 0,end = _crowd->getAgentCount();
+	int start = 0,end = static_cast<int>(_agents.size());
 	if(agentID != -1) { start = agentID; end = agentID + 1; }
 
-	if(adjust)
+	for(int i = start; i < end; ++i)
 	{
-		for(int i = start; i < end; ++i)
+		const AgentState* state = getAgentState(i);
+		if(!state || !state->active) continue;
+
+		AgentSlot& slot = _agents[i];
+		if(adjust)
 		{
-			const dtCrowdAgent* agent = _crowd->getAgent(i);
-			if(!agent->active) continue;
-			float velocity[3];
-			calculateVelocity(velocity,pos,_targetPosition,agent->params.maxSpeed);
-			_crowd->requestMoveVelocity(i,velocity);
+			slot.request = MOVE_VELOCITY;
+			calculateVelocity(slot.target,pos,_targetPosition,state->maxSpeed);
 		}
-	}
-	else
-	{
-		for(int i = start; i < end; ++i)
+		else
 		{
-			const dtCrowdAgent* agent = _crowd->getAgent(i);
-			if(!agent->active) continue;
-			_crowd->requestMoveTarget(i,_targetRef,_targetPosition);
+			slot.request = MOVE_TARGET;
+			slot.targetRef = _targetRef;
+			dtVcopy(slot.target,_targetPosition);
 		}
+		_requestChanged(i);
 	}
 }
 
 bool CrowdManager::requestVelocity(int agentID,const Ogre::Vector3& velocity)
 {
-	if(_crowd->getAgent(agentID)->active)
+	const AgentState* state = getAgentState(agentID);
+	if(state && state->active)
 	{
-		float velocityF[3];
-		Utility::vector3_toFloatPtr(velocity,velocityF);
-		return _crowd->requestMoveVelocity(agentID,velocityF);
+		AgentSlot& slot = _agents[agentID];
+		slot.request = MOVE_VELOCITY;
+		Utility::vector3_toFloatPtr(velocity,slot.target);
+		_requestChanged(agentID);
+		return true;
 	}
 	else
 	{
@@ -226,8 +697,17 @@ bool CrowdManager::requestVelocity(int agentID,const Ogre::Vector3& velocity)
 
 bool CrowdManager::stopAgent(int agentID)
 {
-	float zeroVelocity[3] = {0,0,0};
-	return _crowd->resetMoveTarget(agentID) && _crowd->requestMoveVelocity(agentID,zeroVelocity);
+	if(!_isValid(agentID))
+	{
+		return false;
+	}
+
+	//a zero velocity request stops the agent and drops its move target.
+	AgentSlot& slot = _agents[agentID];
+	slot.request = MOVE_VELOCITY;
+	dtVset(slot.target,0.0f,0.0f,0.0f);
+	_requestChanged(agentID);
+	return true;
 }
 
 Ogre::Vector3 CrowdManager::calculateVelocity(const Ogre::Vector3& position,const Ogre::Vector3& target,float speed)
@@ -1,27 +1,92 @@
 #include "StdAfx.h"
 
 #include "DetourInterface.h"
+#include "WorkerPool.h"
+
+#include <map>
 
 #ifndef _CROWD_MANAGER_H_
 #define _CROWD_MANAGER_H_
 
 #define AGENT_MAX_TRAIL_LENGTH 64
-#define MAX_AGENTS 128
+//Agents per dtCrowd, a region that's full gets another crowd.
+#define PARTITION_MAX_AGENTS 128
+//Side of a partition's region, in navmesh tiles.
+#define DEFAULT_PARTITION_TILES 4
 #define DEFAULT_MAXSPEED 1.5f
-
+#define DEFAULT_PATH_ITERATIONS 100
+#define DEFAULT_TILE_UPDATES 4
+
+/*
+	Keeps the Detour crowds moving the characters.
+
+	The navmesh is split into square regions on the X/Z plane. A region gets its own dtCrowd once an agent
+	is in it and loses it again when it's empty, so memory follows the agents actually in use.
+	A dtCrowd only has one query filter, so agents with different filter profiles are kept in separate crowds.
+	Agents that walk out of their region are handed over to the crowd of the region they walked into,
+	their IDs stay the same. Agents only steer around agents of their own crowd.
+
+	The crowds are stepped on worker threads, one job per crowd. updateTick() starts the step and returns,
+	so it runs alongside the rest of the frame, and the next updateTick() waits for it. What the step
+	produced is published through two buffers of AgentState: getAgentState() reads the last finished step,
+	the running step writes the other one, so reading positions never waits or locks.
+	Move requests made while a step is running are recorded and handed to Detour once it's done.
+	Adding or removing agents waits for the running step.
+*/
 class CrowdManager
 {
 public:
+	//How much work the crowd puts into steering an agent.
+	enum AGENT_QUALITY
+	{
+		//Everything that's enabled for the crowd, best obstacle avoidance.
+		AGENT_QUALITY_HIGH = 0,
+		//No topology optimization, cheaper obstacle avoidance.
+		AGENT_QUALITY_MEDIUM,
+		//Follows the path corners only, no avoidance or path optimization.
+		AGENT_QUALITY_LOW
+	};
+
+	struct AgentTrail
+	{
+		float trail[AGENT_MAX_TRAIL_LENGTH*3];
+		int htrail;
+	};
+
+	//An agent as of the last finished crowd step.
+	struct AgentState
+	{
+		Ogre::Vector3 position;
+		Ogre::Vector3 velocity;
+		float maxSpeed;
+		float maxAcceleration;
+		bool active;
+	};
+
 	CrowdManager(DetourInterface* detour,rcdtConfig* config);
 	~CrowdManager();
 
 	int addAgent(const Ogre::Vector3& position);
-	int addAgent(const Ogre::Vector3& position, float maxSpeedFactor);
+	//filter is one of the DetourInterface's filter profiles, see DetourInterface::registerFilter.
+	int addAgent(const Ogre::Vector3& position, float maxSpeedFactor,int filter = DetourInterface::DT_FILTER_DEFAULT);
 
+	//Moves the agent into a crowd using that filter profile, unknown profiles mean the default one.
+	//Agents only avoid agents of their own crowd, so agents with different profiles walk through each other.
+	bool setAgentFilter(int id,int filter);
+	int getAgentFilter(int id);
+
+	//Null if there's no such agent. Safe to call at any time, doesn't wait for the running step.
+	const AgentState* getAgentState(int id);
+
+	//Changes when the agent moves to another partition, look it up again instead of keeping it.
+	//Waits for the running step, use getAgentState() for positions and velocities.
 	const dtCrowdAgent* getAgent(int id);
 
 	void removeAgent(int id);
 
+	//Agents are added at AGENT_QUALITY_HIGH.
+	void setAgentQuality(int id,AGENT_QUALITY quality);
+
 	//Sets the move target either for the entire crowd or for an individual agent.
 	//Defaults to entire crowd.
 	void setMoveTarget(const Ogre::Vector3& position,bool adjust = true,int agentID = -1);
@@ -38,30 +103,117 @@ public:
 	static Ogre::Vector3 calculateVelocity(const Ogre::Vector3& position, const Ogre::Vector3& target, float speed);
 	static void calculateVelocity(float* velocity,const float* position,const float* target, float speed);
 
-	//Needs to be called every frame.
+	//Needs to be called every frame. Finishes the previous step and starts the next one on the workers.
+	//Also advances the queued path requests of the DetourInterface, within the path iteration budget,
+	//and rebuilds the tiles touched by obstacle changes, within the tile update budget.
 	void updateTick(const float deltaTime);
 
+	//Blocks until the running step is done. Anything that changes the navmesh needs to call this first.
+	void waitForUpdate();
+
+	//Queues a path query from an agent's current position, see DetourInterface::requestPath.
+	DetourInterface::PathRequestID requestPath(int agentID,const Ogre::Vector3& destination,
+											   const DetourInterface::PathCallback& callback,
+											   DetourInterface::DT_PATH_PRIORITY priority = DetourInterface::DT_PATH_PRIORITY_NORMAL);
+	bool cancelPath(DetourInterface::PathRequestID id);
+
+	//How many Detour search iterations queued path requests may use per tick.
+	void setPathIterationBudget(int iterations) { _pathIterationBudget = iterations; }
+	int getPathIterationBudget() { return _pathIterationBudget; }
+
+	//How many tile cache tiles may be rebuilt per tick, see DetourInterface::updateTileCache.
+	void setTileUpdateBudget(int tiles) { _tileUpdateBudget = tiles; }
+	int getTileUpdateBudget() { return _tileUpdateBudget; }
+
 	std::vector<dtCrowdAgent*> getActiveAgents();
 
 	Ogre::Vector3 getLastDestination();
 
+	//Side of the partition regions in world units, defaults to DEFAULT_PARTITION_TILES navmesh tiles.
+	//Agents already placed move over as they're updated.
+	void setPartitionSize(float size);
+	float getPartitionSize() { return _partitionSize; }
+	int getPartitionCount() { return static_cast<int>(_partitions.size()); }
+	int getAgentCount() { return _activeAgents; }
+
+	//Trails of the agents' last positions, for debug drawing. Off by default, nothing is allocated for them then.
+	void setTrailsEnabled(bool enabled);
+	//Null if trails are off or there's no such agent.
+	const AgentTrail* getTrail(int id);
+
 	DetourInterface* _getDetour() { return _detour; }
 private:
+	//One dtCrowd and who's in it.
+	struct Partition
+	{
+		dtCrowd* crowd;
+		int regionX,regionZ;
+		//filter profile of the crowd.
+		int filter;
+		int agentCount;
+		//crowd agent index -> agent ID
+		int agentIDs[PARTITION_MAX_AGENTS];
+	};
+
+	//What was last asked of an agent, so it can be asked again after a move to another partition.
+	enum MOVE_REQUEST
+	{
+		MOVE_NONE = 0,
+		MOVE_TARGET,
+		MOVE_VELOCITY
+	};
+
+	struct AgentSlot
+	{
+		//null for free slots.
+		Partition* partition;
+		int index;
+		MOVE_REQUEST request;
+		dtPolyRef targetRef;
+		float target[3];
+		AgentTrail* trail;
+		//the request/quality changed while a step was running, not yet handed to Detour.
+		bool requestPending;
+		int pendingQuality;
+	};
+
+	void _setQualityParams(dtCrowdAgentParams& params,AGENT_QUALITY quality);
+	void _regionAt(const float* position,int& regionX,int& regionZ);
+	//A crowd of the region and filter profile with room for one more agent, created if needed.
+	Partition* _getPartition(int regionX,int regionZ,int filter);
+	//Puts the agent into a crowd of the region it's in, false if Detour refused it.
+	bool _placeAgent(int id,const float* position,const dtCrowdAgentParams& params,int filter);
+	//Agents that left their region go to the region they're in now.
+	void _migrateAgents();
+	//Hands a placed agent over to the crowd of the region it's in with that profile.
+	bool _moveAgent(int id,int filter);
+	void _reissueRequest(int id);
+	//Hands the request to Detour now, or after the running step.
+	void _requestChanged(int id);
+	void _flushPendingRequests();
+	void _removeEmptyPartitions();
+	//Runs on a worker. Writes into the state buffer that isn't being read.
+	void _stepPartition(Partition* partition,float deltaTime);
+	bool _isValid(int id) { return id >= 0 && id < static_cast<int>(_agents.size()) && _agents[id].partition != nullptr; }
 
-	dtCrowd* _crowd;
 	DetourInterface* _detour;
 	rcdtConfig _config;
 
+	std::vector<Partition*> _partitions;
+	std::multimap<std::pair<int,int>,Partition*> _regions;
+	std::vector<AgentSlot> _agents;
+	std::vector<int> _freeAgents;
+
+	float _partitionSize;
+	//x/z of the navmesh origin, region 0,0 starts there.
+	float _regionOrigin[2];
+	//agents only change partitions once they're this far outside their region, so they don't flip back and forth.
+	float _partitionMargin;
+	float _queryExtents[3];
+
 	dtPolyRef _targetRef;
 	float _targetPosition[3];
 
-	struct AgentTrail
-	{
-		float trail[AGENT_MAX_TRAIL_LENGTH*3];
-		int htrail;
-	};
-	AgentTrail _trails[MAX_AGENTS];
-
 	bool _anticipateTurns;
 	bool _optimizeVis;
 	bool _optimizeTopo;
@@ -71,6 +223,17 @@ private:
 	float _separationWeight;
 
 	int _activeAgents;
+
+	int _pathIterationBudget;
+	int _tileUpdateBudget;
+
+	bool _trailsEnabled;
+
+	WorkerPool _workers;
+	bool _stepping;
+	std::vector<AgentState> _states[2];
+	//index of the buffer getAgentState() reads.
+	int _readState;
 };
 
-#endif
\ No newline at end of file
+#endif
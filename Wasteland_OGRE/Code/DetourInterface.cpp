@@ -4,14 +4,154 @@
 #include <Recast.h>
 #include "Utility.h"
 
-float frand() { return (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)); }
+#include <fstream>
+#include <set>
+
+namespace
+{
+	//PackBits style run length encoding. Layers are mostly runs of the same height/area, which this catches,
+	//and it needs no state, so every worker can use the same one.
+	//A header byte below 128 is followed by header+1 literal bytes, above 128 by one byte repeated 257-header times.
+	class RLECompressor : public dtTileCacheCompressor
+	{
+	public:
+		virtual int maxCompressedSize(const int bufferSize)
+		{
+			return bufferSize + (bufferSize + 127) / 128 + 1;
+		}
+
+		virtual dtStatus compress(const unsigned char* buffer,const int bufferSize,unsigned char* compressed,const int maxSize,int* compressedSize)
+		{
+			int in = 0;
+			int out = 0;
+			while(in < bufferSize)
+			{
+				int run = 1;
+				while(in + run < bufferSize && run < 128 && buffer[in + run] == buffer[in])
+				{
+					++run;
+				}
+
+				if(run > 1)
+				{
+					if(out + 2 > maxSize)
+					{
+						return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+					}
+					compressed[out++] = static_cast<unsigned char>(257 - run);
+					compressed[out++] = buffer[in];
+					in += run;
+					continue;
+				}
+
+				//literal bytes up to the next run.
+				int count = 1;
+				while(in + count < bufferSize && count < 128 &&
+					  !(in + count + 1 < bufferSize && buffer[in + count] == buffer[in + count + 1]))
+				{
+					++count;
+				}
+				if(out + count + 1 > maxSize)
+				{
+					return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+				}
+				compressed[out++] = static_cast<unsigned char>(count - 1);
+				memcpy(compressed + out,buffer + in,count);
+				out += count;
+				in += count;
+			}
+
+			*compressedSize = out;
+			return DT_SUCCESS;
+		}
+
+		virtual dtStatus decompress(const unsigned char* compressed,const int compressedSize,unsigned char* buffer,const int maxBufferSize,int* bufferSize)
+		{
+			int in = 0;
+			int out = 0;
+			while(in < compressedSize)
+			{
+				int header = compressed[in++];
+				if(header < 128)
+				{
+					int count = header + 1;
+					if(in + count > compressedSize || out + count > maxBufferSize)
+					{
+						return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+					}
+					memcpy(buffer + out,compressed + in,count);
+					in += count;
+					out += count;
+				}
+				else if(header > 128)
+				{
+					int count = 257 - header;
+					if(in >= compressedSize || out + count > maxBufferSize)
+					{
+						return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+					}
+					memset(buffer + out,compressed[in++],count);
+					out += count;
+				}
+			}
+
+			*bufferSize = out;
+			return DT_SUCCESS;
+		}
+	};
+
+	//Same areas/flags as DetourInterface::setPolyFlags, for the tiles the tile cache builds.
+	class TileCacheMeshProcess : public dtTileCacheMeshProcess
+	{
+	public:
+		virtual void process(dtNavMeshCreateParams* params,unsigned char* polyAreas,unsigned short* polyFlags)
+		{
+			for(int i = 0; i < params->polyCount; ++i)
+			{
+				if(polyAreas[i] == DT_TILECACHE_WALKABLE_AREA)
+				{
+					polyAreas[i] = DetourInterface::DT_PA_GROUND;
+					polyFlags[i] = DetourInterface::DT_PF_WALK;
+				}
+			}
+		}
+	};
+
+	RLECompressor tileCacheCompressor;
+	TileCacheMeshProcess tileCacheMeshProcess;
+}
+
+//xorshift with its state per thread, so random points can be picked on any thread without sharing rand().
+static __declspec(thread) unsigned int randomState = 0;
+
+float frand()
+{
+	if(randomState == 0)
+	{
+		randomState = (GetTickCount() ^ (GetCurrentThreadId() * 2654435761u)) | 1;
+	}
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return static_cast<float>(randomState >> 8) / 16777216.0f;
+}
 
 DetourInterface::DetourInterface(rcPolyMesh* polyMesh,rcPolyMeshDetail* detailMesh,rcdtConfig& config)
 	: _navMesh(nullptr),
 	  _navQuery(nullptr),
-	  _isMeshBuilt(false)
+	  _isMeshBuilt(false),
+	  _slicedQuery(nullptr),
+	  _hasActiveRequest(false),
+	  _nextRequestID(1),
+	  _pathCacheSize(DEFAULT_PATH_CACHE_SIZE),
+	  _pathCacheHits(0),
+	  _pathCacheMisses(0),
+	  _tileCache(nullptr),
+	  _nextObstacleID(1),
+	  _obstacleRequestsQueued(false)
 {
 	detourCleanup();
+	_registerDefaultFilters();
 
 	unsigned char* navData = 0;
 	int navDataSize = 0;
@@ -25,14 +165,7 @@ DetourInterface::DetourInterface(rcPolyMesh* polyMesh,rcPolyMeshDetail* detailMe
 	std::cout << "Detour - Stage 1" << std::endl;
 #endif
 
-	for(int i = 0; i < polyMesh->npolys; ++i)
-	{
-		if(polyMesh->areas[i] == RC_WALKABLE_AREA)
-		{
-			polyMesh->areas[i] = DT_PA_GROUND;
-			polyMesh->flags[i] = DT_PF_WALK;
-		}
-	}
+	setPolyFlags(polyMesh);
 
 	dtNavMeshCreateParams params;
 	memset(&params,0,sizeof(params));
@@ -105,148 +238,1179 @@ DetourInterface::DetourInterface(rcPolyMesh* polyMesh,rcPolyMeshDetail* detailMe
 	std::cout << "Detour - Stage 5" << std::endl;
 #endif
 
-	_navQuery = dtAllocNavMeshQuery();
-	status = _navQuery->init(_navMesh,2048);
-	if(dtStatusFailed(status))
+	if(!_initNavQuery())
 	{
-		std::cout << "Error! Detour - could not initialize Detour navmesh query." << std::endl;
 		return;
 	}
 
 	_isMeshBuilt = true;
 }
 
+DetourInterface::DetourInterface()
+	: _navMesh(nullptr),
+	  _navQuery(nullptr),
+	  _isMeshBuilt(false),
+	  _slicedQuery(nullptr),
+	  _hasActiveRequest(false),
+	  _nextRequestID(1),
+	  _pathCacheSize(DEFAULT_PATH_CACHE_SIZE),
+	  _pathCacheHits(0),
+	  _pathCacheMisses(0),
+	  _tileCache(nullptr),
+	  _nextObstacleID(1),
+	  _obstacleRequestsQueued(false)
+{
+	_registerDefaultFilters();
+}
+
 DetourInterface::~DetourInterface()
 {
 	detourCleanup();
 }
 
-Ogre::Vector3 DetourInterface::getRandomNavMeshPoint()
+void DetourInterface::_registerDefaultFilters()
 {
 	dtQueryFilter filter;
-	filter.setIncludeFlags(0xFFFF);
-	filter.setExcludeFlags(0);
+	filter.setIncludeFlags(DT_PF_ALL);
+	filter.setExcludeFlags(DT_PF_DISABLED);
 	filter.setAreaCost(DT_PA_GROUND,1.0f);
-	//filter.setAreaCost(DT_TILECACHE_WALKABLE_AREA,1.0f);
+	registerFilter("default",filter);
 
-	float resultPoint[3];
-	dtPolyRef resultPoly;
-	_navQuery->findRandomPoint(&filter,frand,&resultPoly,resultPoint);
+	dtQueryFilter civilian = filter;
+	civilian.setAreaCost(DT_PA_ROAD,1.0f);
+	civilian.setAreaCost(DT_PA_GRASS,2.0f);
+	civilian.setAreaCost(DT_PA_WATER,10.0f);
+	civilian.setExcludeFlags(DT_PF_DISABLED | DT_PF_JUMP);
+	registerFilter("civilian",civilian);
 
-	return Ogre::Vector3(resultPoint[0],resultPoint[1],resultPoint[2]);
+	dtQueryFilter enemy = filter;
+	enemy.setAreaCost(DT_PA_WATER,3.0f);
+	registerFilter("enemy",enemy);
 }
 
-bool DetourInterface::findNearestPointOnNavmesh(const Ogre::Vector3& position,Ogre::Vector3& resultPoint)
+int DetourInterface::registerFilter(const std::string& name,const dtQueryFilter& filter)
 {
-	float extents[3] = { 16.0f, 16.0f, 16.0f };
+	//routes found with the old profile may not be the ones this one would pick.
+	invalidatePathCache();
 
-	dtQueryFilter filter;
-	filter.setIncludeFlags(0xFFFF);
-	filter.setExcludeFlags(0);
-	filter.setAreaCost(DT_PA_GROUND,1.0f);
-	//filter.setAreaCost(DT_TILECACHE_WALKABLE_AREA,1.0f);
+	int id = getFilterID(name);
+	if(id != -1)
+	{
+		_filters[id] = filter;
+		return id;
+	}
 
-	float point[3];
-	Utility::vector3_toFloatPtr(position,point);
-	float rPoint[3];
-	dtPolyRef poly;
-	dtStatus status = _navQuery->findNearestPoly(point,extents,&filter,&poly,rPoint);
-	//Check if Detour found a polygon.
-	if( (status & DT_FAILURE) || ( status & DT_STATUS_DETAIL_MASK) )
+	_filters.push_back(filter);
+	_filterNames.push_back(name);
+	return static_cast<int>(_filters.size()) - 1;
+}
+
+int DetourInterface::getFilterID(const std::string& name)
+{
+	for(size_t i = 0; i < _filterNames.size(); ++i)
+	{
+		if(_filterNames[i] == name)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+const dtQueryFilter* DetourInterface::getFilter(int id)
+{
+	return &_filters[_checkFilter(id)];
+}
+
+void DetourInterface::setPolyFlags(rcPolyMesh* polyMesh)
+{
+	for(int i = 0; i < polyMesh->npolys; ++i)
+	{
+		if(polyMesh->areas[i] == RC_WALKABLE_AREA)
+		{
+			polyMesh->areas[i] = DT_PA_GROUND;
+			polyMesh->flags[i] = DT_PF_WALK;
+		}
+	}
+}
+
+bool DetourInterface::initTiledNavMesh(const float* origin,float tileWidth,float tileHeight,int maxTiles,int maxPolysPerTile)
+{
+	detourCleanup();
+	_isMeshBuilt = false;
+
+	dtNavMeshParams params;
+	memset(&params,0,sizeof(params));
+	dtVcopy(params.orig,origin);
+	params.tileWidth = tileWidth;
+	params.tileHeight = tileHeight;
+	params.maxTiles = maxTiles;
+	params.maxPolys = maxPolysPerTile;
+
+	_navMesh = dtAllocNavMesh();
+	if(!_navMesh || dtStatusFailed(_navMesh->init(&params)))
 	{
+		std::cout << "Error! Detour - could not create tiled Detour navmesh!" << std::endl;
+		detourCleanup();
+		return false;
+	}
+
+	if(!_initNavQuery())
+	{
+		detourCleanup();
 		return false;
 	}
 
-	Utility::floatPtr_toVector3(rPoint,resultPoint);
 	return true;
 }
 
-DetourInterface::DT_PATHFIND_RETURN DetourInterface::findPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,PathData* path)
+bool DetourInterface::addTile(unsigned char* data,int dataSize)
 {
-	float start[3];
-	float end[3];
-	Utility::vector3_toFloatPtr(startPosition,start);
-	Utility::vector3_toFloatPtr(endPosition,end);
-	return findPath(start,end,target,path);
+	if(!_navMesh)
+	{
+		dtFree(data);
+		return false;
+	}
+
+	dtStatus status = _navMesh->addTile(data,dataSize,DT_TILE_FREE_DATA,0,0);
+	if(dtStatusFailed(status))
+	{
+		dtFree(data);
+		std::cout << "Error! Detour - could not add navmesh tile." << std::endl;
+		return false;
+	}
+
+	//the new tile may connect polygons that had no path, or a shorter one, before.
+	invalidatePathCache();
+
+	_isMeshBuilt = true;
+	return true;
 }
 
-DetourInterface::DT_PATHFIND_RETURN DetourInterface::findPath(float* startPosition,float* endPosition,int target,PathData* path)
+bool DetourInterface::changePolyFlags(dtPolyRef ref,unsigned short flags)
 {
-	dtStatus status;
-	float extents[3] = { 32.0f,32.0f,32.0f };
-	dtPolyRef startPoly;
-	float startNearest[3];
+	if(!_navMesh || dtStatusFailed(_navMesh->setPolyFlags(ref,flags)))
+	{
+		return false;
+	}
 
-	dtPolyRef endPoly;
-	float endNearest[3];
+	invalidatePathCache();
+	return true;
+}
 
-	dtPolyRef polyPath[MAX_PATHPOLY];
-	int pathCount = 0;
-	float straightPath[MAX_PATHVERT * 3];
-	int vertexCount = 0;
+bool DetourInterface::initTileCache(const dtTileCacheParams& params,int maxPolysPerTile)
+{
+	//the navmesh of a tile cache is always tiled, one navmesh tile for every layer.
+	int maxTiles = params.maxTiles;
+	if(!initTiledNavMesh(params.orig,params.width * params.cs,params.height * params.cs,maxTiles,maxPolysPerTile))
+	{
+		return false;
+	}
 
-	dtQueryFilter filter;
-	filter.setIncludeFlags(0xFFFF);
-	filter.setExcludeFlags(0);
-	filter.setAreaCost(DT_PA_GROUND,1.0f);
-	
-	status = _navQuery->findNearestPoly(startPosition,extents,&filter,&startPoly,startNearest);
-	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+	_tileCache = dtAllocTileCache();
+	if(!_tileCache || dtStatusFailed(_tileCache->init(&params,&_tileCacheAlloc,&tileCacheCompressor,&tileCacheMeshProcess)))
 	{
-		return DT_PATH_NOPOLY_START;
+		std::cout << "Error! Detour - could not create the tile cache!" << std::endl;
+		detourCleanup();
+		return false;
 	}
 
-	status = _navQuery->findNearestPoly(endPosition,extents,&filter,&endPoly,endNearest);
-	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+	return true;
+}
+
+bool DetourInterface::addTileCacheLayer(unsigned char* data,int dataSize)
+{
+	if(!_tileCache)
 	{
-		return DT_PATH_NOPOLY_END;
+		dtFree(data);
+		return false;
 	}
 
-	status = _navQuery->findPath(startPoly,endPoly,startPosition,endPosition,&filter,polyPath,&pathCount,MAX_PATHPOLY);
-	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+	dtStatus status = _tileCache->addTile(data,dataSize,DT_COMPRESSEDTILE_FREE_DATA,0);
+	if(dtStatusFailed(status))
 	{
-		return DT_PATH_NOCREATE;
+		dtFree(data);
+		std::cout << "Error! Detour - could not add tile cache layer." << std::endl;
+		return false;
 	}
-	if(pathCount == 0) { return DT_PATH_NOFIND; }
+	return true;
+}
 
-	status = _navQuery->findStraightPath(startPosition,endPosition,polyPath,pathCount,straightPath,NULL,NULL,&vertexCount,MAX_PATHVERT);
-	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+bool DetourInterface::buildTileCacheTile(int tx,int ty)
+{
+	if(!_tileCache || dtStatusFailed(_tileCache->buildNavMeshTilesAt(tx,ty,_navMesh)))
 	{
-		return DT_PATH_NOCREATESTRAIGHT;
+		std::cout << "Error! Detour - could not build navmesh tile " << tx << "," << ty << " from the tile cache." << std::endl;
+		return false;
 	}
-	if(vertexCount == 0) { return DT_PATH_NOFINDSTRAIGHT; }
 
-	//have our path.
-	//copy it to the path storehouse.
-	int index = 0;
-	/*
-	for(int nV = 0; nV < vertexCount; nV++)
-	{
-		_pathsData[pathNum].x[nV]=straightPath[index++];
-		_pathsData[pathNum].y[nV]=straightPath[index++];
-		_pathsData[pathNum].z[nV]=straightPath[index++];
-	}
-	_pathsData[pathNum].maxVertex = vertexCount;
-	_pathsData[pathNum].target = target;
-	*/
-	//instead, copy it into the passed-in path variable
-	path->maxVertex = vertexCount;
-	path->target = target;
-	for(int n = 0; n < vertexCount; n++)
+	invalidatePathCache();
+	_isMeshBuilt = true;
+	return true;
+}
+
+dtTileCacheCompressor* DetourInterface::getTileCacheCompressor()
+{
+	return &tileCacheCompressor;
+}
+
+dtObstacleRef DetourInterface::_addObstacle(const float* position,float radius,float height)
+{
+	dtObstacleRef ref = 0;
+	if(dtStatusFailed(_tileCache->addObstacle(position,radius,height,&ref)))
 	{
-		path->x[n] = straightPath[index++];
-		path->y[n] = straightPath[index++];
-		path->z[n] = straightPath[index++];
+		return 0;
 	}
 
-	return DT_PATH_SUCCESS;
+	_obstacleRequestsQueued = true;
+	return ref;
 }
 
-void DetourInterface::detourCleanup()
+DetourInterface::ObstacleID DetourInterface::addCylinderObstacle(const Ogre::Vector3& position,float radius,float height)
 {
-	dtFreeNavMesh(_navMesh);
-	_navMesh = 0;
+	if(!_tileCache)
+	{
+		return 0;
+	}
 
-	dtFreeNavMeshQuery(_navQuery);
-	_navQuery = 0;
+	float pos[3] = { position.x, position.y, position.z };
+	dtObstacleRef ref = _addObstacle(pos,radius,height);
+	if(ref == 0)
+	{
+		std::cout << "Error! Detour - could not add obstacle, too many obstacles or requests." << std::endl;
+		return 0;
+	}
+
+	ObstacleID id = _nextObstacleID++;
+	_obstacles[id].push_back(ref);
+	return id;
+}
+
+DetourInterface::ObstacleID DetourInterface::addBoxObstacle(const Ogre::Vector3& center,const Ogre::Vector3& halfExtents,const Ogre::Radian& yaw)
+{
+	if(!_tileCache)
+	{
+		return 0;
+	}
+
+	//this tile cache only knows cylinders, so the box is covered by a row of them along its long side.
+	//every cylinder reaches the corners of its segment, which makes the box a bit fatter at the sides.
+	Ogre::Vector3 axis = Ogre::Quaternion(yaw,Ogre::Vector3::UNIT_Y) * Ogre::Vector3::UNIT_X;
+	float along = halfExtents.x;
+	float across = halfExtents.z;
+	if(halfExtents.z > halfExtents.x)
+	{
+		axis = Ogre::Quaternion(yaw,Ogre::Vector3::UNIT_Y) * Ogre::Vector3::UNIT_Z;
+		along = halfExtents.z;
+		across = halfExtents.x;
+	}
+	across = std::max(across,_tileCache->getParams()->cs);
+
+	int count = static_cast<int>(std::ceil(along / across));
+	count = std::max(count,1);
+	float segment = along / count;
+	float radius = std::sqrt(across * across + segment * segment);
+
+	std::vector<dtObstacleRef> refs;
+	for(int i = 0; i < count; ++i)
+	{
+		//cylinders centered on the segments of the long side, standing on the bottom of the box.
+		float offset = -along + segment * (2 * i + 1);
+		Ogre::Vector3 bottom = center + axis * offset;
+		float pos[3] = { bottom.x, center.y - halfExtents.y, bottom.z };
+
+		dtObstacleRef ref = _addObstacle(pos,radius,halfExtents.y * 2.0f);
+		if(ref == 0)
+		{
+			std::cout << "Error! Detour - could not add box obstacle, too many obstacles or requests." << std::endl;
+			//the cylinders already added get an ID of their own, so they're removed even if the queue is full right now.
+			if(!refs.empty())
+			{
+				ObstacleID partial = _nextObstacleID++;
+				_obstacles[partial].swap(refs);
+				removeObstacle(partial);
+			}
+			return 0;
+		}
+		refs.push_back(ref);
+	}
+
+	ObstacleID id = _nextObstacleID++;
+	_obstacles[id].swap(refs);
+	return id;
+}
+
+bool DetourInterface::removeObstacle(ObstacleID id)
+{
+	auto itr = _obstacles.find(id);
+	if(!_tileCache || itr == _obstacles.end())
+	{
+		return false;
+	}
+
+	//already waiting for room in the request queue.
+	if(std::find(_pendingRemovals.begin(),_pendingRemovals.end(),id) != _pendingRemovals.end())
+	{
+		return true;
+	}
+
+	if(_removeObstacleRefs(itr->second))
+	{
+		_obstacles.erase(itr);
+	}
+	else
+	{
+		_pendingRemovals.push_back(id);
+	}
+	return true;
+}
+
+bool DetourInterface::_removeObstacleRefs(std::vector<dtObstacleRef>& refs)
+{
+	//the tile cache only takes so many requests between updates, whatever doesn't fit stays in refs.
+	auto kept = refs.begin();
+	for(auto ref = refs.begin(); ref != refs.end(); ++ref)
+	{
+		if(dtStatusFailed(_tileCache->removeObstacle(*ref)))
+		{
+			*kept++ = *ref;
+		}
+		else
+		{
+			_obstacleRequestsQueued = true;
+		}
+	}
+	refs.erase(kept,refs.end());
+	return refs.empty();
+}
+
+void DetourInterface::_retryObstacleRemovals()
+{
+	for(auto itr = _pendingRemovals.begin(); itr != _pendingRemovals.end();)
+	{
+		auto obstacle = _obstacles.find(*itr);
+		if(obstacle == _obstacles.end() || _removeObstacleRefs(obstacle->second))
+		{
+			if(obstacle != _obstacles.end())
+			{
+				_obstacles.erase(obstacle);
+			}
+			itr = _pendingRemovals.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+bool DetourInterface::isTileCacheUpToDate()
+{
+	if(!_tileCache)
+	{
+		return true;
+	}
+	if(_obstacleRequestsQueued || !_pendingRemovals.empty())
+	{
+		return false;
+	}
+
+	for(int i = 0; i < _tileCache->getObstacleCount(); ++i)
+	{
+		const dtTileCacheObstacle* obstacle = _tileCache->getObstacle(i);
+		if(obstacle->state == DT_OBSTACLE_PROCESSING || obstacle->state == DT_OBSTACLE_REMOVING)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DetourInterface::updateTileCache(float deltaTime,int maxTileUpdates)
+{
+	if(isTileCacheUpToDate())
+	{
+		return;
+	}
+
+	//the first update hands the queued obstacle changes to the tiles, every update rebuilds one touched tile.
+	for(int i = 0; i < maxTileUpdates; ++i)
+	{
+		_tileCache->update(deltaTime,_navMesh);
+		_obstacleRequestsQueued = false;
+		//the update emptied the request queue, so removals that didn't fit before may now.
+		_retryObstacleRemovals();
+		if(isTileCacheUpToDate())
+		{
+			break;
+		}
+	}
+
+	//the rebuilt tiles have new poly refs.
+	invalidatePathCache();
+}
+
+bool DetourInterface::_initNavQuery()
+{
+	_navQuery = dtAllocNavMeshQuery();
+	dtStatus status = _navQuery->init(_navMesh,NAVQUERY_MAX_NODES);
+	if(dtStatusFailed(status))
+	{
+		std::cout << "Error! Detour - could not initialize Detour navmesh query." << std::endl;
+		return false;
+	}
+
+	_slicedQuery = dtAllocNavMeshQuery();
+	status = _slicedQuery->init(_navMesh,NAVQUERY_MAX_NODES);
+	if(dtStatusFailed(status))
+	{
+		std::cout << "Error! Detour - could not initialize Detour sliced navmesh query." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+dtNavMeshQuery* DetourInterface::acquireQuery()
+{
+	ScopedLock lock(_queryMutex);
+	if(!_navMesh)
+	{
+		return nullptr;
+	}
+
+	if(!_freeQueries.empty())
+	{
+		dtNavMeshQuery* query = _freeQueries.back();
+		_freeQueries.pop_back();
+		return query;
+	}
+
+	//first time this many threads query at once.
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	if(!query || dtStatusFailed(query->init(_navMesh,NAVQUERY_MAX_NODES)))
+	{
+		std::cout << "Error! Detour - could not initialize pooled navmesh query." << std::endl;
+		dtFreeNavMeshQuery(query);
+		return nullptr;
+	}
+	_queryPool.push_back(query);
+	return query;
+}
+
+void DetourInterface::releaseQuery(dtNavMeshQuery* query)
+{
+	if(query == nullptr)
+	{
+		return;
+	}
+
+	ScopedLock lock(_queryMutex);
+	_freeQueries.push_back(query);
+}
+
+//Navmesh cache file layout:
+//NavMeshCacheHeader, then for each tile a NavMeshCacheTile followed by its data.
+static const int NAVMESH_CACHE_MAGIC = 'W'<<24 | 'N'<<16 | 'A'<<8 | 'V';
+static const int NAVMESH_CACHE_VERSION = 1;
+
+struct NavMeshCacheHeader
+{
+	int magic;
+	int version;
+	Ogre::uint64 key;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+struct NavMeshCacheTile
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+bool DetourInterface::saveNavMesh(const std::string& fileName,Ogre::uint64 key)
+{
+	if(!_isMeshBuilt || !_navMesh)
+	{
+		return false;
+	}
+
+	std::ofstream out(fileName.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open())
+	{
+		std::cout << "Error! Detour - could not write navmesh cache " << fileName << std::endl;
+		return false;
+	}
+
+	//const access to the tiles, dtNavMesh only hands them out through the const overload.
+	const dtNavMesh* navMesh = _navMesh;
+
+	NavMeshCacheHeader header;
+	memset(&header,0,sizeof(header));
+	header.magic = NAVMESH_CACHE_MAGIC;
+	header.version = NAVMESH_CACHE_VERSION;
+	header.key = key;
+	header.numTiles = 0;
+	memcpy(&header.params,_navMesh->getParams(),sizeof(dtNavMeshParams));
+	for(int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if(tile && tile->header && tile->dataSize > 0)
+		{
+			header.numTiles++;
+		}
+	}
+	out.write(reinterpret_cast<const char*>(&header),sizeof(header));
+
+	for(int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if(!tile || !tile->header || tile->dataSize <= 0)
+		{
+			continue;
+		}
+
+		NavMeshCacheTile tileHeader;
+		tileHeader.tileRef = navMesh->getTileRef(tile);
+		tileHeader.dataSize = tile->dataSize;
+		out.write(reinterpret_cast<const char*>(&tileHeader),sizeof(tileHeader));
+		out.write(reinterpret_cast<const char*>(tile->data),tile->dataSize);
+	}
+
+	return out.good();
+}
+
+bool DetourInterface::loadNavMesh(const std::string& fileName,Ogre::uint64 key)
+{
+	std::ifstream in(fileName.c_str(),std::ios::in | std::ios::binary);
+	if(!in.is_open())
+	{
+		return false;
+	}
+
+	NavMeshCacheHeader header;
+	in.read(reinterpret_cast<char*>(&header),sizeof(header));
+	if(!in.good() || header.magic != NAVMESH_CACHE_MAGIC || header.version != NAVMESH_CACHE_VERSION)
+	{
+		std::cout << "Detour - navmesh cache " << fileName << " is unreadable, rebuilding." << std::endl;
+		return false;
+	}
+	if(header.key != key)
+	{
+		std::cout << "Detour - navmesh cache " << fileName << " is out of date, rebuilding." << std::endl;
+		return false;
+	}
+
+	detourCleanup();
+	_isMeshBuilt = false;
+
+	_navMesh = dtAllocNavMesh();
+	if(!_navMesh || dtStatusFailed(_navMesh->init(&header.params)))
+	{
+		std::cout << "Error! Detour - could not create Detour navmesh!" << std::endl;
+		detourCleanup();
+		return false;
+	}
+
+	for(int i = 0; i < header.numTiles; ++i)
+	{
+		NavMeshCacheTile tileHeader;
+		in.read(reinterpret_cast<char*>(&tileHeader),sizeof(tileHeader));
+		if(!in.good() || tileHeader.tileRef == 0 || tileHeader.dataSize <= 0)
+		{
+			std::cout << "Error! Detour - navmesh cache " << fileName << " is corrupt." << std::endl;
+			detourCleanup();
+			return false;
+		}
+
+		unsigned char* data = static_cast<unsigned char*>(dtAlloc(tileHeader.dataSize,DT_ALLOC_PERM));
+		in.read(reinterpret_cast<char*>(data),tileHeader.dataSize);
+		if(!in.good() || dtStatusFailed(_navMesh->addTile(data,tileHeader.dataSize,DT_TILE_FREE_DATA,tileHeader.tileRef,0)))
+		{
+			dtFree(data);
+			std::cout << "Error! Detour - navmesh cache " << fileName << " is corrupt." << std::endl;
+			detourCleanup();
+			return false;
+		}
+	}
+
+	if(!_initNavQuery())
+	{
+		detourCleanup();
+		return false;
+	}
+
+	_isMeshBuilt = true;
+	return true;
+}
+
+//Tile cache file layout:
+//TileCacheFileHeader, then for each compressed layer its size followed by its data.
+static const int TILECACHE_FILE_MAGIC = 'W'<<24 | 'T'<<16 | 'C'<<8 | 'H';
+static const int TILECACHE_FILE_VERSION = 1;
+
+struct TileCacheFileHeader
+{
+	int magic;
+	int version;
+	Ogre::uint64 key;
+	int numLayers;
+	int maxPolysPerTile;
+	dtTileCacheParams params;
+};
+
+bool DetourInterface::saveTileCache(const std::string& fileName,Ogre::uint64 key)
+{
+	if(!_isMeshBuilt || !_tileCache)
+	{
+		return false;
+	}
+
+	std::ofstream out(fileName.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open())
+	{
+		std::cout << "Error! Detour - could not write tile cache " << fileName << std::endl;
+		return false;
+	}
+
+	const dtTileCache* tileCache = _tileCache;
+
+	TileCacheFileHeader header;
+	memset(&header,0,sizeof(header));
+	header.magic = TILECACHE_FILE_MAGIC;
+	header.version = TILECACHE_FILE_VERSION;
+	header.key = key;
+	header.numLayers = 0;
+	header.maxPolysPerTile = _navMesh->getParams()->maxPolys;
+	memcpy(&header.params,_tileCache->getParams(),sizeof(dtTileCacheParams));
+	for(int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if(tile && tile->header && tile->dataSize > 0)
+		{
+			header.numLayers++;
+		}
+	}
+	out.write(reinterpret_cast<const char*>(&header),sizeof(header));
+
+	//a layer's data is its dtTileCacheLayerHeader and the compressed layer, exactly what addTileCacheLayer takes.
+	for(int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if(!tile || !tile->header || tile->dataSize <= 0)
+		{
+			continue;
+		}
+
+		out.write(reinterpret_cast<const char*>(&tile->dataSize),sizeof(tile->dataSize));
+		out.write(reinterpret_cast<const char*>(tile->data),tile->dataSize);
+	}
+
+	return out.good();
+}
+
+bool DetourInterface::loadTileCache(const std::string& fileName,Ogre::uint64 key)
+{
+	std::ifstream in(fileName.c_str(),std::ios::in | std::ios::binary);
+	if(!in.is_open())
+	{
+		return false;
+	}
+
+	TileCacheFileHeader header;
+	in.read(reinterpret_cast<char*>(&header),sizeof(header));
+	if(!in.good() || header.magic != TILECACHE_FILE_MAGIC || header.version != TILECACHE_FILE_VERSION)
+	{
+		std::cout << "Detour - tile cache " << fileName << " is unreadable, rebuilding." << std::endl;
+		return false;
+	}
+	if(header.key != key)
+	{
+		std::cout << "Detour - tile cache " << fileName << " is out of date, rebuilding." << std::endl;
+		return false;
+	}
+
+	if(!initTileCache(header.params,header.maxPolysPerTile))
+	{
+		return false;
+	}
+
+	//tiles are built once all of their layers are in.
+	std::set<std::pair<int,int>> tiles;
+	for(int i = 0; i < header.numLayers; ++i)
+	{
+		int dataSize = 0;
+		in.read(reinterpret_cast<char*>(&dataSize),sizeof(dataSize));
+		if(!in.good() || dataSize < static_cast<int>(sizeof(dtTileCacheLayerHeader)))
+		{
+			std::cout << "Error! Detour - tile cache " << fileName << " is corrupt." << std::endl;
+			detourCleanup();
+			return false;
+		}
+
+		unsigned char* data = static_cast<unsigned char*>(dtAlloc(dataSize,DT_ALLOC_PERM));
+		in.read(reinterpret_cast<char*>(data),dataSize);
+		const dtTileCacheLayerHeader* layer = reinterpret_cast<const dtTileCacheLayerHeader*>(data);
+		if(!in.good() || layer->magic != DT_TILECACHE_MAGIC || layer->version != DT_TILECACHE_VERSION)
+		{
+			dtFree(data);
+			std::cout << "Error! Detour - tile cache " << fileName << " is corrupt." << std::endl;
+			detourCleanup();
+			return false;
+		}
+
+		std::pair<int,int> tile(layer->tx,layer->ty);
+		if(!addTileCacheLayer(data,dataSize))
+		{
+			detourCleanup();
+			return false;
+		}
+		tiles.insert(tile);
+	}
+
+	for(auto itr = tiles.begin(); itr != tiles.end(); ++itr)
+	{
+		buildTileCacheTile(itr->first,itr->second);
+	}
+
+	return _isMeshBuilt;
+}
+
+Ogre::Vector3 DetourInterface::getRandomNavMeshPoint(int filter)
+{
+	PooledQuery query(this);
+	if(!query.get())
+	{
+		return Ogre::Vector3::ZERO;
+	}
+
+	float resultPoint[3];
+	dtPolyRef resultPoly;
+	query->findRandomPoint(getFilter(filter),frand,&resultPoly,resultPoint);
+
+	return Ogre::Vector3(resultPoint[0],resultPoint[1],resultPoint[2]);
+}
+
+bool DetourInterface::findNearestPointOnNavmesh(const Ogre::Vector3& position,Ogre::Vector3& resultPoint,int filter)
+{
+	float extents[3] = { 16.0f, 16.0f, 16.0f };
+
+	PooledQuery query(this);
+	if(!query.get())
+	{
+		return false;
+	}
+
+	float point[3];
+	Utility::vector3_toFloatPtr(position,point);
+	float rPoint[3];
+	dtPolyRef poly;
+	dtStatus status = query->findNearestPoly(point,extents,getFilter(filter),&poly,rPoint);
+	//Check if Detour found a polygon.
+	if( (status & DT_FAILURE) || ( status & DT_STATUS_DETAIL_MASK) )
+	{
+		return false;
+	}
+
+	Utility::floatPtr_toVector3(rPoint,resultPoint);
+	return true;
+}
+
+DetourInterface::DT_PATHFIND_RETURN DetourInterface::findPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,PathRef& path,
+															   int filter)
+{
+	float start[3];
+	float end[3];
+	Utility::vector3_toFloatPtr(startPosition,start);
+	Utility::vector3_toFloatPtr(endPosition,end);
+	return findPath(start,end,target,path,filter);
+}
+
+DetourInterface::DT_PATHFIND_RETURN DetourInterface::findPath(float* startPosition,float* endPosition,int target,PathRef& path,int filter)
+{
+	dtStatus status;
+	float extents[3] = { 32.0f,32.0f,32.0f };
+	dtPolyRef startPoly;
+	float startNearest[3];
+
+	dtPolyRef endPoly;
+	float endNearest[3];
+
+	dtPolyRef polyPath[MAX_PATHPOLY];
+	int pathCount = 0;
+
+	filter = _checkFilter(filter);
+	const dtQueryFilter* queryFilter = &_filters[filter];
+
+	PooledQuery query(this);
+	if(!query.get())
+	{
+		return DT_PATH_NOPOLY_START;
+	}
+
+	status = query->findNearestPoly(startPosition,extents,queryFilter,&startPoly,startNearest);
+	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+	{
+		return DT_PATH_NOPOLY_START;
+	}
+
+	status = query->findNearestPoly(endPosition,extents,queryFilter,&endPoly,endNearest);
+	if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+	{
+		return DT_PATH_NOPOLY_END;
+	}
+
+	PathCacheKey key;
+	key.startRef = startPoly;
+	key.endRef = endPoly;
+	key.filter = filter;
+	if(!_findCachedPath(key,polyPath,pathCount))
+	{
+		status = query->findPath(startPoly,endPoly,startPosition,endPosition,queryFilter,polyPath,&pathCount,MAX_PATHPOLY);
+		if( (status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK) )
+		{
+			return DT_PATH_NOCREATE;
+		}
+		if(pathCount == 0) { return DT_PATH_NOFIND; }
+
+		_cachePath(key,polyPath,pathCount);
+	}
+
+	return _straightenPath(query.get(),startPosition,endPosition,polyPath,pathCount,target,path);
+}
+
+DetourInterface::DT_PATHFIND_RETURN DetourInterface::_straightenPath(dtNavMeshQuery* query,const float* start,const float* end,
+																	 const dtPolyRef* polys,int polyCount,int target,PathRef& path)
+{
+	float straightPath[MAX_PATHVERT * 3];
+	int vertexCount = 0;
+	dtStatus status = query->findStraightPath(start,end,polys,polyCount,straightPath,NULL,NULL,&vertexCount,MAX_PATHVERT);
+	//a straight path cut short at MAX_PATHVERT still gets the agent going.
+	if(dtStatusFailed(status))
+	{
+		return DT_PATH_NOCREATESTRAIGHT;
+	}
+	if(vertexCount == 0) { return DT_PATH_NOFINDSTRAIGHT; }
+
+	//have our path, copy it into a pooled one of just the right size.
+	path = PathRef::create(vertexCount);
+	path->target = target;
+	memcpy(path->getVertices(),straightPath,vertexCount * 3 * sizeof(float));
+
+	return DT_PATH_SUCCESS;
+}
+
+bool DetourInterface::_findCachedPath(const PathCacheKey& key,dtPolyRef* polys,int& polyCount)
+{
+	ScopedLock lock(_pathCacheMutex);
+	auto found = _pathCacheIndex.find(key);
+	if(found == _pathCacheIndex.end())
+	{
+		_pathCacheMisses++;
+		return false;
+	}
+
+	//most recently used goes to the front.
+	_pathCache.splice(_pathCache.begin(),_pathCache,found->second);
+
+	const std::vector<dtPolyRef>& cached = found->second->polys;
+	polyCount = static_cast<int>(cached.size());
+	std::copy(cached.begin(),cached.end(),polys);
+	_pathCacheHits++;
+	return true;
+}
+
+void DetourInterface::_cachePath(const PathCacheKey& key,const dtPolyRef* polys,int polyCount)
+{
+	ScopedLock lock(_pathCacheMutex);
+	if(_pathCacheSize <= 0 || _pathCacheIndex.count(key) > 0)
+	{
+		return;
+	}
+
+	while(static_cast<int>(_pathCache.size()) >= _pathCacheSize)
+	{
+		_pathCacheIndex.erase(_pathCache.back().key);
+		_pathCache.pop_back();
+	}
+
+	PathCacheEntry entry;
+	entry.key = key;
+	entry.polys.assign(polys,polys + polyCount);
+	_pathCache.push_front(entry);
+	_pathCacheIndex[key] = _pathCache.begin();
+}
+
+void DetourInterface::setPathCacheSize(int size)
+{
+	ScopedLock lock(_pathCacheMutex);
+	_pathCacheSize = size;
+	while(static_cast<int>(_pathCache.size()) > std::max(_pathCacheSize,0))
+	{
+		_pathCacheIndex.erase(_pathCache.back().key);
+		_pathCache.pop_back();
+	}
+}
+
+void DetourInterface::invalidatePathCache()
+{
+	ScopedLock lock(_pathCacheMutex);
+	_pathCache.clear();
+	_pathCacheIndex.clear();
+}
+
+DetourInterface::PathRequestID DetourInterface::requestPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,
+															  const PathCallback& callback,DT_PATH_PRIORITY priority,int filter)
+{
+	if(priority < DT_PATH_PRIORITY_LOW || priority >= DT_PATH_PRIORITY_COUNT)
+	{
+		priority = DT_PATH_PRIORITY_NORMAL;
+	}
+
+	PathRequest request;
+	request.id = _nextRequestID++;
+	if(_nextRequestID == 0)
+	{
+		_nextRequestID = 1;
+	}
+	Utility::vector3_toFloatPtr(startPosition,request.start);
+	Utility::vector3_toFloatPtr(endPosition,request.end);
+	request.target = target;
+	request.callback = callback;
+	request.filter = _checkFilter(filter);
+	request.startRef = 0;
+	request.endRef = 0;
+
+	_pathRequests[priority].push_back(request);
+	return request.id;
+}
+
+bool DetourInterface::cancelPath(PathRequestID id)
+{
+	if(_hasActiveRequest && _activeRequest.id == id)
+	{
+		//the sliced query is simply abandoned, the next init overwrites it.
+		_finishPathRequest(DT_PATH_CANCELLED);
+		return true;
+	}
+
+	for(int p = 0; p < DT_PATH_PRIORITY_COUNT; ++p)
+	{
+		for(auto itr = _pathRequests[p].begin(); itr != _pathRequests[p].end(); ++itr)
+		{
+			if(itr->id == id)
+			{
+				//erased before the callback, so it can queue or cancel requests freely.
+				PathRequest cancelled = *itr;
+				_pathRequests[p].erase(itr);
+				if(cancelled.callback)
+				{
+					cancelled.callback(cancelled.id,DT_PATH_CANCELLED,PathRef());
+				}
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+int DetourInterface::getPendingPathCount()
+{
+	int count = _hasActiveRequest ? 1 : 0;
+	for(int p = 0; p < DT_PATH_PRIORITY_COUNT; ++p)
+	{
+		count += static_cast<int>(_pathRequests[p].size());
+	}
+	return count;
+}
+
+void DetourInterface::updatePathRequests(int maxIterations)
+{
+	if(!_slicedQuery)
+	{
+		return;
+	}
+
+	int iterationsLeft = maxIterations;
+	while(iterationsLeft > 0)
+	{
+		if(!_hasActiveRequest)
+		{
+			//starting a request is a couple of nearest-poly lookups, counted as one iteration.
+			--iterationsLeft;
+			if(!_startNextPathRequest())
+			{
+				return;
+			}
+			if(!_hasActiveRequest)
+			{
+				//failed to start, the callback was already called.
+				continue;
+			}
+		}
+
+		int iterationsDone = 0;
+		dtStatus status = _slicedQuery->updateSlicedFindPath(iterationsLeft,&iterationsDone);
+		iterationsLeft -= rcMax(iterationsDone,1);
+
+		if(dtStatusInProgress(status))
+		{
+			//out of budget, continue next frame.
+			continue;
+		}
+		if(dtStatusFailed(status))
+		{
+			_finishPathRequest(DT_PATH_NOCREATE);
+			continue;
+		}
+
+		dtPolyRef polyPath[MAX_PATHPOLY];
+		int pathCount = 0;
+		status = _slicedQuery->finalizeSlicedFindPath(polyPath,&pathCount,MAX_PATHPOLY);
+		if(dtStatusFailed(status))
+		{
+			_finishPathRequest(DT_PATH_NOCREATE);
+			continue;
+		}
+		if(pathCount == 0)
+		{
+			_finishPathRequest(DT_PATH_NOFIND);
+			continue;
+		}
+
+		//partial paths only get close to the end, don't hand them out for later requests.
+		if(!dtStatusDetail(status,DT_PARTIAL_RESULT))
+		{
+			PathCacheKey key;
+			key.startRef = _activeRequest.startRef;
+			key.endRef = _activeRequest.endRef;
+			key.filter = _activeRequest.filter;
+			_cachePath(key,polyPath,pathCount);
+		}
+
+		_finishPathRequest(_straightenPath(_slicedQuery,_activeRequest.start,_activeRequest.end,polyPath,pathCount,
+										   _activeRequest.target,_pathResult));
+	}
+}
+
+bool DetourInterface::_startNextPathRequest()
+{
+	int priority = DT_PATH_PRIORITY_COUNT - 1;
+	while(priority >= 0 && _pathRequests[priority].empty())
+	{
+		--priority;
+	}
+	if(priority < 0)
+	{
+		return false;
+	}
+
+	_activeRequest = _pathRequests[priority].front();
+	_pathRequests[priority].pop_front();
+	_hasActiveRequest = true;
+
+	float extents[3] = { 32.0f,32.0f,32.0f };
+	dtPolyRef startPoly,endPoly;
+	float startNearest[3],endNearest[3];
+
+	const dtQueryFilter* filter = getFilter(_activeRequest.filter);
+	dtStatus status = _slicedQuery->findNearestPoly(_activeRequest.start,extents,filter,&startPoly,startNearest);
+	if(dtStatusFailed(status) || (status & DT_STATUS_DETAIL_MASK) || startPoly == 0)
+	{
+		_finishPathRequest(DT_PATH_NOPOLY_START);
+		return true;
+	}
+
+	status = _slicedQuery->findNearestPoly(_activeRequest.end,extents,filter,&endPoly,endNearest);
+	if(dtStatusFailed(status) || (status & DT_STATUS_DETAIL_MASK) || endPoly == 0)
+	{
+		_finishPathRequest(DT_PATH_NOPOLY_END);
+		return true;
+	}
+
+	_activeRequest.startRef = startPoly;
+	_activeRequest.endRef = endPoly;
+
+	//a route that was found before needs no search at all.
+	PathCacheKey key;
+	key.startRef = startPoly;
+	key.endRef = endPoly;
+	key.filter = _activeRequest.filter;
+	dtPolyRef polyPath[MAX_PATHPOLY];
+	int pathCount = 0;
+	if(_findCachedPath(key,polyPath,pathCount))
+	{
+		_finishPathRequest(_straightenPath(_slicedQuery,_activeRequest.start,_activeRequest.end,polyPath,pathCount,
+										   _activeRequest.target,_pathResult));
+		return true;
+	}
+
+	status = _slicedQuery->initSlicedFindPath(startPoly,endPoly,_activeRequest.start,_activeRequest.end,filter);
+	if(dtStatusFailed(status))
+	{
+		_finishPathRequest(DT_PATH_NOCREATE);
+	}
+	return true;
+}
+
+void DetourInterface::_finishPathRequest(DT_PATHFIND_RETURN result)
+{
+	//cleared before the callback, so the callback can queue or cancel requests freely.
+	PathRequest finished = _activeRequest;
+	_hasActiveRequest = false;
+	_activeRequest.callback = nullptr;
+
+	//the interface doesn't hang on to the path, it's the callback's to keep or drop.
+	PathRef path;
+	if(result == DT_PATH_SUCCESS)
+	{
+		path = _pathResult;
+	}
+	_pathResult.reset();
+
+	if(finished.callback)
+	{
+		finished.callback(finished.id,result,path);
+	}
+}
+
+void DetourInterface::detourCleanup()
+{
+	dtFreeTileCache(_tileCache);
+	_tileCache = 0;
+	_obstacles.clear();
+	_pendingRemovals.clear();
+	_obstacleRequestsQueued = false;
+
+	dtFreeNavMesh(_navMesh);
+	_navMesh = 0;
+
+	dtFreeNavMeshQuery(_navQuery);
+	_navQuery = 0;
+
+	{
+		ScopedLock lock(_queryMutex);
+		for(auto itr = _queryPool.begin(); itr != _queryPool.end(); ++itr)
+		{
+			dtFreeNavMeshQuery(*itr);
+		}
+		_queryPool.clear();
+		_freeQueries.clear();
+	}
+
+	//queued requests hold positions, not poly refs, so only the running one is lost with the navmesh.
+	//Its owner still gets told, or it would wait for it forever.
+	if(_hasActiveRequest)
+	{
+		_finishPathRequest(DT_PATH_CANCELLED);
+	}
+	dtFreeNavMeshQuery(_slicedQuery);
+	_slicedQuery = 0;
+
+	//poly refs of the old navmesh mean nothing to the next one.
+	invalidatePathCache();
+
+	//paths still held by characters stay valid, only the idle blocks go.
+	PathData::releasePooledPaths();
 }
\ No newline at end of file
@@ -5,33 +5,59 @@
 #include <DetourNavMesh.h>
 #include <DetourNavMeshBuilder.h>
 #include <DetourNavMeshQuery.h>
+#include <DetourTileCache.h>
+#include <DetourTileCacheBuilder.h>
 #include "RecastDetourUtil.h"
+#include "PathData.h"
+#include "WorkerPool.h"
+
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
 
 #ifndef _DETOUR_INTERFACE_H_
 #define _DETOUR_INTERFACE_H_
 
-#define MAX_PATHSLOT 128 // max # of paths
 #define MAX_PATHPOLY 256 // max # of polygons in path
 #define MAX_PATHVERT 512 // max # of verts in path
-
-class PathData
-{
-public:
-	float x[MAX_PATHVERT];
-	float y[MAX_PATHVERT];
-	float z[MAX_PATHVERT];
-	int maxVertex;
-	int target;
-};
+#define DEFAULT_PATH_CACHE_SIZE 128 // # of polygon corridors kept by the path cache
+#define NAVQUERY_MAX_NODES 2048 // search nodes of every dtNavMeshQuery
+#define TILECACHE_LAYERS_PER_TILE 4 // expected # of layers(floors) in one tile of a tile cache
+#define TILECACHE_MAX_OBSTACLES 256 // # of dtTileCache obstacles, a box obstacle takes several
 
 struct rcPolyMesh;
 struct rcPolyMeshDetail;
 struct RecastDetourConfiguration;
 typedef RecastDetourConfiguration rcdtConfig;
 
+/*
+	findNearestPointOnNavmesh, getRandomNavMeshPoint, findPath, the filter/path cache getters and PooledQuery
+	can be used from any thread, e.g. from WorkerPool jobs. Each of them borrows a dtNavMeshQuery from a pool
+	that grows to one query per thread using it at the same time, and random points use a generator per thread.
+	The navmesh itself isn't locked: building, loading, cleaning up, changing polygon flags and registering
+	filters must happen while no job is querying. The queued path requests are main thread only.
+*/
 class DetourInterface
 {
 public:
+	//Borrows a query from the pool for as long as it's around. get() is null without a navmesh.
+	class PooledQuery
+	{
+	public:
+		explicit PooledQuery(DetourInterface* detour) : _detour(detour),_query(detour->acquireQuery()) {}
+		~PooledQuery() { _detour->releaseQuery(_query); }
+
+		dtNavMeshQuery* get() { return _query; }
+		dtNavMeshQuery* operator->() { return _query; }
+	private:
+		PooledQuery(const PooledQuery&);
+		PooledQuery& operator=(const PooledQuery&);
+
+		DetourInterface* _detour;
+		dtNavMeshQuery* _query;
+	};
+
 	enum DT_POLYAREA_TYPE
 	{
 		DT_PA_GROUND = 1,
@@ -61,34 +87,238 @@ public:
 		DT_PATH_NOCREATE,
 		DT_PATH_NOFIND,
 		DT_PATH_NOCREATESTRAIGHT,
-		DT_PATH_NOFINDSTRAIGHT
+		DT_PATH_NOFINDSTRAIGHT,
+		DT_PATH_CANCELLED
+	};
+
+	//Filter profiles every DetourInterface starts with, registerFilter adds more after these.
+	enum DT_FILTER_PROFILE
+	{
+		//Anything walkable except disabled polygons.
+		DT_FILTER_DEFAULT = 0,
+		//Sticks to roads and dry ground, stays out of water.
+		DT_FILTER_CIVILIAN,
+		//Takes the shortest way across anything walkable, doesn't mind the water as much.
+		DT_FILTER_ENEMY,
+		DT_FILTER_BUILTIN_COUNT
+	};
+
+	enum DT_PATH_PRIORITY
+	{
+		DT_PATH_PRIORITY_LOW = 0,
+		DT_PATH_PRIORITY_NORMAL,
+		DT_PATH_PRIORITY_HIGH,
+		DT_PATH_PRIORITY_COUNT
 	};
+
+	//0 is never handed out, so it can be used as 'no request'.
+	typedef unsigned int PathRequestID;
+	//0 is never handed out either.
+	typedef unsigned int ObstacleID;
+	//Called from updatePathRequests when a queued request finishes. path is null unless result is DT_PATH_SUCCESS,
+	//copy the PathRef to keep the path.
+	typedef std::function<void (PathRequestID id,DT_PATHFIND_RETURN result,const PathRef& path)> PathCallback;
+
 	//create constructors that create dtNavMesh/dtNavQuery/etc
 	DetourInterface(rcPolyMesh* polyMesh,rcPolyMeshDetail* detailMesh,rcdtConfig& config);
+	//Empty interface, use loadNavMesh to fill it.
+	DetourInterface();
 	~DetourInterface();
 
-	bool findNearestPointOnNavmesh(const Ogre::Vector3& position,Ogre::Vector3& resultPoint);
+	//Starts an empty tiled navmesh with its tile grid starting at origin, tiles are then added with addTile.
+	bool initTiledNavMesh(const float* origin,float tileWidth,float tileHeight,int maxTiles,int maxPolysPerTile);
+	//Adds a tile made by dtCreateNavMeshData. The navmesh takes ownership of data, even on failure.
+	bool addTile(unsigned char* data,int dataSize);
+
+	//Tile cache: the compressed Recast layers of every tile stay in memory, so tiles can be rebuilt from them
+	//when obstacles are added or removed, without going back to the level geometry.
+	//Starts an empty tiled navmesh along with the tile cache, see RecastInterface::buildTileCache.
+	bool initTileCache(const dtTileCacheParams& params,int maxPolysPerTile);
+	//Adds a layer made by dtBuildTileCacheLayer. The tile cache takes ownership of data, even on failure.
+	bool addTileCacheLayer(unsigned char* data,int dataSize);
+	//Builds the navmesh tiles at tx,ty from their layers, once all of them are added.
+	bool buildTileCacheTile(int tx,int ty);
+	bool hasTileCache() { return _tileCache != nullptr; }
+	//Thread safe, layers are compressed on the workers building them.
+	static dtTileCacheCompressor* getTileCacheCompressor();
+
+	//Temporary obstacles, cut out of the navmesh of the tiles they touch. 0 if there's no tile cache or no room.
+	//position is the bottom of the cylinder.
+	ObstacleID addCylinderObstacle(const Ogre::Vector3& position,float radius,float height);
+	//A box turned by yaw around its center(e.g. a door), covered by a row of cylinders.
+	ObstacleID addBoxObstacle(const Ogre::Vector3& center,const Ogre::Vector3& halfExtents,const Ogre::Radian& yaw);
+	//Removals that don't fit in the tile cache's request queue are retried by updateTileCache,
+	//the ID stays taken until all of its parts are gone.
+	bool removeObstacle(ObstacleID id);
+	//Rebuilds at most maxTileUpdates of the tiles touched by obstacle changes. The navmesh changes, so no
+	//crowd step or query job can be running, CrowdManager::updateTick calls this at the right time.
+	void updateTileCache(float deltaTime,int maxTileUpdates);
+	//False while obstacle changes still have tiles to rebuild.
+	bool isTileCacheUpToDate();
+
+	//Converts Recast's walkable areas to the area types/flags used by the queries.
+	static void setPolyFlags(rcPolyMesh* polyMesh);
+	//Changes the flags of a single polygon of the navmesh(e.g. DT_PF_DISABLED), drops the cached paths.
+	//The crowds read the navmesh while stepping, call CrowdManager::waitForUpdate() first.
+	bool changePolyFlags(dtPolyRef ref,unsigned short flags);
+
+	//Writes every tile of the navmesh to fileName, tagged with key(see RecastInterface::getCacheKey).
+	bool saveNavMesh(const std::string& fileName,Ogre::uint64 key);
+	//Replaces the current navmesh with the one in fileName.
+	//Fails if the file is missing, from another version or was saved with a different key.
+	bool loadNavMesh(const std::string& fileName,Ogre::uint64 key);
+	//Same for a tile cache: its compressed layers are written instead of the navmesh tiles, so loading
+	//rebuilds the tiles from them and obstacles still work. Obstacles themselves aren't saved.
+	bool saveTileCache(const std::string& fileName,Ogre::uint64 key);
+	bool loadTileCache(const std::string& fileName,Ogre::uint64 key);
 
-	Ogre::Vector3 getRandomNavMeshPoint();
+	//Named query filters(area costs, include/exclude flags) that are set up once and picked by ID afterwards.
+	//Registering a name that already exists replaces that profile. Returns the profile's ID.
+	//dtCrowds copy the filter when they're made, so register profiles before agents use them.
+	int registerFilter(const std::string& name,const dtQueryFilter& filter);
+	//-1 if there's no such profile.
+	int getFilterID(const std::string& name);
+	//The default profile for unknown IDs.
+	const dtQueryFilter* getFilter(int id);
+	int getFilterCount() { return static_cast<int>(_filters.size()); }
 
-	DT_PATHFIND_RETURN findPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,PathData* path);
-	DT_PATHFIND_RETURN findPath(float* startPosition, float* endPosition, int target,PathData* path);
+	bool findNearestPointOnNavmesh(const Ogre::Vector3& position,Ogre::Vector3& resultPoint,int filter = DT_FILTER_DEFAULT);
+
+	Ogre::Vector3 getRandomNavMeshPoint(int filter = DT_FILTER_DEFAULT);
+
+	//path is only set on success.
+	DT_PATHFIND_RETURN findPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,PathRef& path,
+								int filter = DT_FILTER_DEFAULT);
+	DT_PATHFIND_RETURN findPath(float* startPosition, float* endPosition, int target,PathRef& path,int filter = DT_FILTER_DEFAULT);
+
+	//Queues a path query that's worked on a little every frame by updatePathRequests.
+	//Higher priorities are served first, requests of the same priority in the order they came in.
+	PathRequestID requestPath(const Ogre::Vector3& startPosition,const Ogre::Vector3& endPosition,int target,
+							  const PathCallback& callback,DT_PATH_PRIORITY priority = DT_PATH_PRIORITY_NORMAL,
+							  int filter = DT_FILTER_DEFAULT);
+	//Drops a queued or running request, its callback is called right away with DT_PATH_CANCELLED.
+	//Returns false if it's already finished.
+	bool cancelPath(PathRequestID id);
+	//Runs queued requests for at most maxIterations Detour search iterations.
+	void updatePathRequests(int maxIterations);
+	int getPendingPathCount();
+
+	//Found paths are remembered by start polygon, end polygon and filter profile, so asking for the same route again
+	//skips the A* search. Only the polygon corridor is kept, the straight path is still made from the actual
+	//start and end positions. The least recently used corridor goes when the cache is full.
+	//Everything is dropped when tiles, polygon flags or filter profiles change, call invalidatePathCache()
+	//after changing the navmesh from outside.
+	void setPathCacheSize(int size);
+	int getPathCacheSize() { return _pathCacheSize; }
+	void invalidatePathCache();
+	int getPathCacheHits() { return _pathCacheHits; }
+	int getPathCacheMisses() { return _pathCacheMisses; }
 
 	bool isMeshBuilt() { return _isMeshBuilt; }
 
 	void detourCleanup();
 
 	dtNavMesh* getNavMesh() { return _navMesh; }
+	//Main thread only, other threads use PooledQuery.
 	dtNavMeshQuery* getNavQuery() { return _navQuery; }
 
+	//A query for this thread to use on its own, null without a navmesh. Hand it back with releaseQuery.
+	dtNavMeshQuery* acquireQuery();
+	void releaseQuery(dtNavMeshQuery* query);
+
 private:
+	struct PathRequest
+	{
+		PathRequestID id;
+		float start[3];
+		float end[3];
+		int target;
+		PathCallback callback;
+		int filter;
+		dtPolyRef startRef;
+		dtPolyRef endRef;
+	};
+
+	struct PathCacheKey
+	{
+		dtPolyRef startRef;
+		dtPolyRef endRef;
+		int filter;
+
+		bool operator<(const PathCacheKey& other) const
+		{
+			if(startRef != other.startRef) return startRef < other.startRef;
+			if(endRef != other.endRef) return endRef < other.endRef;
+			return filter < other.filter;
+		}
+	};
+
+	struct PathCacheEntry
+	{
+		PathCacheKey key;
+		std::vector<dtPolyRef> polys;
+	};
+
+	bool _initNavQuery();
+	dtObstacleRef _addObstacle(const float* position,float radius,float height);
+	//Asks the tile cache to remove refs, leaves the ones it refused. True if none are left.
+	bool _removeObstacleRefs(std::vector<dtObstacleRef>& refs);
+	void _retryObstacleRemovals();
+
+	//Starts the sliced search for the next queued request, false if there's nothing left to start.
+	bool _startNextPathRequest();
+	void _finishPathRequest(DT_PATHFIND_RETURN result);
+	//Turns a polygon corridor into the straight path written to path.
+	DT_PATHFIND_RETURN _straightenPath(dtNavMeshQuery* query,const float* start,const float* end,
+									   const dtPolyRef* polys,int polyCount,int target,PathRef& path);
+
+	void _registerDefaultFilters();
+	//The profile ID itself for valid IDs, DT_FILTER_DEFAULT otherwise.
+	int _checkFilter(int id) { return (id >= 0 && id < static_cast<int>(_filters.size())) ? id : DT_FILTER_DEFAULT; }
+	//Copies a cached corridor to polys, marks it most recently used. False if there's none.
+	bool _findCachedPath(const PathCacheKey& key,dtPolyRef* polys,int& polyCount);
+	void _cachePath(const PathCacheKey& key,const dtPolyRef* polys,int polyCount);
+
 	dtNavMesh* _navMesh;
 	dtNavMeshQuery* _navQuery;
 
 	bool _isMeshBuilt;
 
-	//PathData
-	PathData _pathsData[MAX_PATHSLOT];
+	//Sliced path queries, kept on their own query object so they don't disturb the immediate ones.
+	dtNavMeshQuery* _slicedQuery;
+	std::deque<PathRequest> _pathRequests[DT_PATH_PRIORITY_COUNT];
+	PathRequest _activeRequest;
+	bool _hasActiveRequest;
+	PathRequestID _nextRequestID;
+	//only held until the callback has it.
+	PathRef _pathResult;
+
+	//a deque so adding profiles doesn't move the ones the sliced query is pointing at.
+	std::deque<dtQueryFilter> _filters;
+	std::vector<std::string> _filterNames;
+
+	dtTileCache* _tileCache;
+	dtTileCacheAlloc _tileCacheAlloc;
+	//every obstacle is one or more dtTileCache obstacles.
+	std::map<ObstacleID,std::vector<dtObstacleRef>> _obstacles;
+	ObstacleID _nextObstacleID;
+	//removed obstacles with parts the tile cache had no room to remove yet.
+	std::vector<ObstacleID> _pendingRemovals;
+	//changes the tile cache hasn't seen yet, they only show up in the obstacle states after its next update.
+	bool _obstacleRequestsQueued;
+
+	//queries not borrowed right now, and every query of the pool.
+	std::vector<dtNavMeshQuery*> _freeQueries;
+	std::vector<dtNavMeshQuery*> _queryPool;
+	Mutex _queryMutex;
+
+	//most recently used at the front.
+	Mutex _pathCacheMutex;
+	std::list<PathCacheEntry> _pathCache;
+	std::map<PathCacheKey,std::list<PathCacheEntry>::iterator> _pathCacheIndex;
+	int _pathCacheSize;
+	int _pathCacheHits;
+	int _pathCacheMisses;
 };
 
 #endif
\ No newline at end of file
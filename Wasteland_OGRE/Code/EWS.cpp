@@ -21,6 +21,7 @@ EWSManager::~EWSManager()
 	{
 		Ogre::ColourValue color(0.0f,0.0f,0.0f,0.0f);
 		Fill(color);
+		Present();
 	}
 }
 
@@ -41,6 +42,12 @@ void EWSManager::Setup(Ogre::SceneManager* scene)
 	//get pixel buffer
 	_pixelBuffer = _ewsTexture->getBuffer();
 
+	//everything is drawn here first, the texture is only written by Present().
+	_width = static_cast<int>(_pixelBuffer->getWidth());
+	_height = static_cast<int>(_pixelBuffer->getHeight());
+	_canvas.assign(_width * _height,0);
+	_isDirty = false;
+
 	//setting up the scene nodes and entities.
 	_ewsNode = scene->getRootSceneNode()->createChildSceneNode("EWSNode");
 	_ewsEntity = scene->createEntity("EWSEntity","ewsPlain.mesh");
@@ -116,6 +123,8 @@ void EWSManager::Update(int newTime,bool isPlacing,const sPlayerData& playerData
 			}
 
 			oldTime = newTime;
+
+			Present();
 		}
 		_material->setDepthWriteEnabled(false);
 		_material->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
@@ -204,135 +213,110 @@ void EWSManager::Place(const Ogre::Vector3& rayCastPosition,const Ogre::Vector3&
 
 void EWSManager::Fill(Ogre::ColourValue& color)
 {
-	_pixelBuffer->lock(Ogre::HardwareBuffer::HBL_NORMAL);
-	const Ogre::PixelBox& pixBox = _pixelBuffer->getCurrentLock();
+	EWSRaster::fillRect(getCanvas(),0,0,_width - 1,_height - 1,makeBrush(color,EWSRaster::REPLACE));
+	markDirty(0,0,_width,_height);
+}
 
-	Ogre::uint8 red = static_cast<Ogre::uint8>(color.r * 255);
-	Ogre::uint8 green = static_cast<Ogre::uint8>(color.g * 255);
-	Ogre::uint8 blue = static_cast<Ogre::uint8>(color.b * 255);
-	Ogre::uint8 alpha = static_cast<Ogre::uint8>(color.a * 255);
+void EWSManager::Box(Ogre::Rect rect, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
+{
+	EWSRaster::fillRect(getCanvas(),rect.left,rect.top,rect.right,rect.bottom,makeBrush(color,mode));
+	markDirty(rect.left,rect.top,rect.right + 1,rect.bottom + 1);
+}
 
-	Ogre::uint8* pData = static_cast<Ogre::uint8*>(pixBox.data);
-	for(unsigned int i = 0; i < _ewsTexture->getSrcWidth(); ++i)
-	{
-		for(unsigned int j = 0; j < _ewsTexture->getSrcHeight(); ++j)
-		{
-			*pData++ = red;
-			*pData++ = green;
-			*pData++ = blue;
-			*pData++ = alpha;
-		}
-	}
+void EWSManager::Line(Ogre::Vector2 start, Ogre::Vector2 end, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
+{
+	int x0 = static_cast<int>(start.x),y0 = static_cast<int>(start.y);
+	int x1 = static_cast<int>(end.x),y1 = static_cast<int>(end.y);
+	EWSRaster::line(getCanvas(),x0,y0,x1,y1,makeBrush(color,mode));
+	markDirty(std::min(x0,x1),std::min(y0,y1),std::max(x0,x1) + 1,std::max(y0,y1) + 1);
+}
 
-	_pixelBuffer->unlock();
+void EWSManager::Circle(Ogre::Vector2 center,int radius, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
+{
+	int cx = static_cast<int>(center.x),cy = static_cast<int>(center.y);
+	EWSRaster::fillCircle(getCanvas(),cx,cy,radius,makeBrush(color,mode));
+	markDirty(cx - radius,cy - radius,cx + radius + 1,cy + radius + 1);
 }
 
-void EWSManager::Box(Ogre::Rect rect, Ogre::ColourValue& color)
+void EWSManager::Arc(Ogre::Vector2 center,int radius,float startAngle,float endAngle,Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
 {
-	_pixelBuffer->lock(Ogre::HardwareBuffer::HBL_NORMAL);
-	const Ogre::PixelBox& pixBox = _pixelBuffer->getCurrentLock();
+	int cx = static_cast<int>(center.x),cy = static_cast<int>(center.y);
+	EWSRaster::arc(getCanvas(),cx,cy,radius,startAngle,endAngle,makeBrush(color,mode));
+	markDirty(cx - radius,cy - radius,cx + radius + 1,cy + radius + 1);
+}
 
-	Ogre::uint8* pData = static_cast<Ogre::uint8*>(pixBox.data);
-	for(int ix = rect.left; ix <= rect.right; ++ix)
+void EWSManager::Polygon(const std::vector<Ogre::Vector2>& points,Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
+{
+	if(points.size() < 3)
 	{
-		for(int iy = rect.top; iy <= rect.bottom; ++iy)
-		{
-			if((ix >= 0 && ix < 512) && (iy >= 0 && iy < 512))
-			{
-				unsigned int offset = getOffset(ix,iy,pixBox.rowPitch);
-				SetPixel(pData + offset,color);
-			}
-		}
+		return;
 	}
-	
 
-	_pixelBuffer->unlock();
+	EWSRaster::fillPolygon(getCanvas(),&points[0],static_cast<int>(points.size()),makeBrush(color,mode));
+
+	Ogre::Vector2 min = points[0],max = points[0];
+	for(auto itr = points.begin(); itr != points.end(); ++itr)
+	{
+		min.makeFloor(*itr);
+		max.makeCeil(*itr);
+	}
+	markDirty(static_cast<int>(floor(min.x)),static_cast<int>(floor(min.y)),
+			  static_cast<int>(ceil(max.x)) + 1,static_cast<int>(ceil(max.y)) + 1);
 }
 
-void EWSManager::Line(Ogre::Vector2 start, Ogre::Vector2 end, Ogre::ColourValue& color)
+void EWSManager::Present()
 {
-	_pixelBuffer->lock(Ogre::HardwareBuffer::HBL_NORMAL);
-	const Ogre::PixelBox& pixbox = _pixelBuffer->getCurrentLock();
-
-	Ogre::uint8* pData = static_cast<Ogre::uint8*>(pixbox.data);
-
-	for(int ix = (int)start.x; ix <= (int)end.x; ++ix)
+	if(!_isDirty)
 	{
-		unsigned int offset = getOffset(ix,(int)start.x,pixbox.rowPitch);
-		SetPixel(pData + offset,color);
+		return;
 	}
 
-	_pixelBuffer->unlock();
+	//only the changed rows/columns are locked and copied.
+	Ogre::PixelBox canvas(_width,_height,1,_pixelBuffer->getFormat(),&_canvas[0]);
+	_pixelBuffer->blitFromMemory(canvas.getSubVolume(_dirty),_dirty);
 
-	return;
+	_isDirty = false;
 }
 
-//VERY LOW PERFORMANCE!! Needs to be optimized before used in EWS system.
-void EWSManager::Circle(Ogre::Vector2 center,int radius, Ogre::ColourValue& color)
+Ogre::uint32 EWSManager::packColour(const Ogre::ColourValue& color)
 {
-	int w,h;
-	w = _ewsTexture->getSrcWidth();
-	h = _ewsTexture->getSrcHeight();
-	_pixelBuffer->lock(Ogre::HardwareBuffer::HBL_NORMAL);
-	const Ogre::PixelBox& pixBox = _pixelBuffer->getCurrentLock();
-
-	Ogre::uint8* pData = static_cast<Ogre::uint8*>(pixBox.data);
-
-	int dots = static_cast<int>(radius * (Ogre::Math::TWO_PI*4));
-	float deg2dot = 360 / (dots * 1.0f);
+	//the canvas uses 32 bits a pixel, which matches the R8G8B8A8/A8R8G8B8 formats the texture comes in.
+	Ogre::uint32 pixel = 0;
+	Ogre::PixelUtil::packColour(color,_pixelBuffer->getFormat(),&pixel);
+	return pixel;
+}
 
-	for(int f = 0; f <= radius; ++f)
-	{
-		for(int d = 0; d <= dots; ++d)
-		{
-			int u = static_cast<int>(sin(d * deg2dot) * (radius - f));
-			int v = static_cast<int>(cos(d * deg2dot) * (radius - f));
-			if(((center.x + u) >= 0) && ((center.x + u) < w))
-			{
-				if( ((center.y + v) >= 0) && ((center.y + v) < h) )
-				{
-					int offset = getOffset(static_cast<int>(center.x + u),static_cast<int>(center.y + v),pixBox.rowPitch);
-					SetPixel(pData + offset,color);
-				}
-			}
-		}
-	}
+EWSRaster::Brush EWSManager::makeBrush(const Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode)
+{
+	return EWSRaster::Brush(packColour(color),color.a,mode);
+}
 
-	_pixelBuffer->unlock();
+EWSRaster::Canvas EWSManager::getCanvas()
+{
+	EWSRaster::Canvas canvas = { &_canvas[0],_width,_height };
+	return canvas;
 }
 
-inline void EWSManager::SetPixel(Ogre::uint8* data,Ogre::ColourValue& color)
+void EWSManager::markDirty(int left,int top,int right,int bottom)
 {
-	
-	Ogre::uint8 pixData[4];
-	pixData[0] = static_cast<Ogre::uint8>(color.a * 255); //alpha
-	pixData[1] = static_cast<Ogre::uint8>(color.r * 255); //red
-	pixData[2] = static_cast<Ogre::uint8>(color.g * 255); //green
-	pixData[3] = static_cast<Ogre::uint8>(color.b * 255); //blue
-
-	int format = _pixelBuffer->getFormat();
-	//assumes data pointer is set to the correct setting.
-	if(format == Ogre::PF_R8G8B8A8)
+	left = std::max(left,0);
+	top = std::max(top,0);
+	right = std::min(right,_width);
+	bottom = std::min(bottom,_height);
+	if(left >= right || top >= bottom)
 	{
-		*data++ = pixData[1]; //red
-		*data++ = pixData[2]; //green
-		*data++ = pixData[3]; //blue
-		*data++ = pixData[0]; //alpha
+		return;
 	}
-	if(format == Ogre::PF_A8R8G8B8)
+
+	if(!_isDirty)
 	{
-		//BGRA???!!!! WHAT THE FUCK!!!
-		//alpha at the end???
-		*data++ = pixData[3]; //blue
-		*data++ = pixData[2]; //green
-		*data++ = pixData[1]; //red
-		*data++ = pixData[0]; //alpha
+		_dirty = Ogre::Image::Box(left,top,right,bottom);
+		_isDirty = true;
+		return;
 	}
-	 
-	return;
-}
 
-int EWSManager::getOffset(int x,int y, int rowPitch)
-{
-	return (x * 4) + ( y * 4 * rowPitch );
-}
\ No newline at end of file
+	_dirty.left = std::min<size_t>(_dirty.left,left);
+	_dirty.top = std::min<size_t>(_dirty.top,top);
+	_dirty.right = std::max<size_t>(_dirty.right,right);
+	_dirty.bottom = std::max<size_t>(_dirty.bottom,bottom);
+}
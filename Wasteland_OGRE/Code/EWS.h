@@ -1,6 +1,7 @@
 #include "StdAfx.h"
 
 #include "Utility.h"
+#include "EWSRaster.h"
 
 #ifndef _ENVWARNSYS_H_
 #define _ENVWARNSYS_H_
@@ -44,18 +45,36 @@ public:
 	void Place(const Ogre::Vector3& rayCastPosition,const Ogre::Vector3& rayCastNormal,const OgreTransform& playerTransform);
 
 protected:
+	//The drawing functions only touch the CPU-side canvas, Present() uploads what changed.
+	//BLEND mixes the color in using its alpha, REPLACE writes it as it is(alpha included).
 	void Fill(Ogre::ColourValue& color);
-	void Box(Ogre::Rect rect, Ogre::ColourValue& color);
-	void Line(Ogre::Vector2 start, Ogre::Vector2 end, Ogre::ColourValue& color);
-	void Circle(Ogre::Vector2 center,int radius, Ogre::ColourValue& color);
-	
-	void SetPixel(Ogre::uint8* data, Ogre::ColourValue& color);
-	int getOffset(int x, int y, int rowPitch);
+	void Box(Ogre::Rect rect, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode = EWSRaster::REPLACE);
+	void Line(Ogre::Vector2 start, Ogre::Vector2 end, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode = EWSRaster::REPLACE);
+	void Circle(Ogre::Vector2 center,int radius, Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode = EWSRaster::REPLACE);
+	//Circle outline from startAngle to endAngle(radians, counter-clockwise, 0 pointing right).
+	void Arc(Ogre::Vector2 center,int radius,float startAngle,float endAngle,Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode = EWSRaster::REPLACE);
+	void Polygon(const std::vector<Ogre::Vector2>& points,Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode = EWSRaster::REPLACE);
+
+	//! Copies the dirty part of the canvas to the texture, in one go.
+	void Present();
+
+	//Converts color to the texture's pixel format, once per primitive rather than once per pixel.
+	Ogre::uint32 packColour(const Ogre::ColourValue& color);
+	EWSRaster::Brush makeBrush(const Ogre::ColourValue& color,EWSRaster::BLEND_MODE mode);
+	EWSRaster::Canvas getCanvas();
+	//Grows the dirty region to include [left,right) x [top,bottom), clipped to the canvas.
+	void markDirty(int left,int top,int right,int bottom);
 
 private:
 	Ogre::TexturePtr _ewsTexture;
 	Ogre::MaterialPtr _material;
 	Ogre::HardwarePixelBufferSharedPtr _pixelBuffer;
+
+	//CPU copy of the texture, same pixel format, and the part of it not uploaded yet.
+	std::vector<Ogre::uint32> _canvas;
+	int _width,_height;
+	Ogre::Image::Box _dirty;
+	bool _isDirty;
 	Ogre::SceneNode* _ewsNode;
 	Ogre::Entity* _ewsEntity;
 
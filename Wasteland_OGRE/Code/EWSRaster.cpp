@@ -0,0 +1,345 @@
+#include "StdAfx.h"
+
+#include "EWSRaster.h"
+
+#include <algorithm>
+
+#ifdef EWS_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace EWSRaster
+{
+	namespace
+	{
+		void fillPixels(Ogre::uint32* dst,int count,Ogre::uint32 pixel)
+		{
+#ifdef EWS_RASTER_SSE2
+			__m128i value = _mm_set1_epi32(static_cast<int>(pixel));
+			for(; count >= 4; count -= 4,dst += 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst),value);
+			}
+#endif
+			for(; count > 0; --count)
+			{
+				*dst++ = pixel;
+			}
+		}
+
+		void blendPixels(Ogre::uint32* dst,int count,Ogre::uint32 pixel,Ogre::uint32 weight)
+		{
+#ifdef EWS_RASTER_SSE2
+			//channels widened to 16 bits: (src * w + dst * (256 - w)) >> 8, which can't overflow.
+			__m128i zero = _mm_setzero_si128();
+			__m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(pixel)),zero);
+			__m128i srcWeighted = _mm_mullo_epi16(src,_mm_set1_epi16(static_cast<short>(weight)));
+			__m128i dstWeight = _mm_set1_epi16(static_cast<short>(256 - weight));
+			for(; count >= 4; count -= 4,dst += 4)
+			{
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst));
+				__m128i lo = _mm_unpacklo_epi8(d,zero);
+				__m128i hi = _mm_unpackhi_epi8(d,zero);
+				lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo,dstWeight),srcWeighted),8);
+				hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi,dstWeight),srcWeighted),8);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst),_mm_packus_epi16(lo,hi));
+			}
+#endif
+			for(; count > 0; --count,++dst)
+			{
+				*dst = blendPixel(*dst,pixel,weight);
+			}
+		}
+
+		inline void plot(const Canvas& canvas,int x,int y,const Brush& brush)
+		{
+			if(x < 0 || x >= canvas.width || y < 0 || y >= canvas.height)
+			{
+				return;
+			}
+
+			Ogre::uint32& dst = canvas.pixels[y * canvas.width + x];
+			dst = (brush.mode == BLEND) ? blendPixel(dst,brush.pixel,brush.weight) : brush.pixel;
+		}
+
+		//the 8 mirrored points of a circle octant, without plotting any of them twice.
+		void plotOctants(const Canvas& canvas,int cx,int cy,int x,int y,const Brush& brush)
+		{
+			if(x == 0)
+			{
+				plot(canvas,cx,cy + y,brush);
+				plot(canvas,cx,cy - y,brush);
+				plot(canvas,cx + y,cy,brush);
+				plot(canvas,cx - y,cy,brush);
+				return;
+			}
+
+			plot(canvas,cx + x,cy + y,brush);
+			plot(canvas,cx - x,cy + y,brush);
+			plot(canvas,cx + x,cy - y,brush);
+			plot(canvas,cx - x,cy - y,brush);
+			if(x != y)
+			{
+				plot(canvas,cx + y,cy + x,brush);
+				plot(canvas,cx - y,cy + x,brush);
+				plot(canvas,cx + y,cy - x,brush);
+				plot(canvas,cx - y,cy - x,brush);
+			}
+		}
+
+		//calls func(x,y) for every point of the first octant, from the top of the circle.
+		template<typename Func>
+		void midpointCircle(int radius,Func func)
+		{
+			int x = 0,y = radius;
+			int d = 1 - radius;
+			while(x <= y)
+			{
+				func(x,y);
+				if(d < 0)
+				{
+					d += 2 * x + 3;
+				}
+				else
+				{
+					d += 2 * (x - y) + 5;
+					--y;
+				}
+				++x;
+			}
+		}
+	}
+
+	Brush::Brush(Ogre::uint32 packedPixel,float alpha,BLEND_MODE blendMode)
+		: pixel(packedPixel),
+		  mode(blendMode)
+	{
+		alpha = std::max(0.0f,std::min(alpha,1.0f));
+		weight = static_cast<Ogre::uint32>(alpha * 256.0f + 0.5f);
+	}
+
+	Ogre::uint32 blendPixel(Ogre::uint32 dst,Ogre::uint32 src,Ogre::uint32 weight)
+	{
+		//two channels at a time, each has 16 bits to work with.
+		Ogre::uint32 inv = 256 - weight;
+		Ogre::uint32 rb = (((src & 0x00FF00FF) * weight + (dst & 0x00FF00FF) * inv) >> 8) & 0x00FF00FF;
+		Ogre::uint32 ag = (((src >> 8) & 0x00FF00FF) * weight + ((dst >> 8) & 0x00FF00FF) * inv) & 0xFF00FF00;
+		return rb | ag;
+	}
+
+	void span(const Canvas& canvas,int y,int x0,int x1,const Brush& brush)
+	{
+		if(y < 0 || y >= canvas.height)
+		{
+			return;
+		}
+		if(x0 > x1)
+		{
+			std::swap(x0,x1);
+		}
+		x0 = std::max(x0,0);
+		x1 = std::min(x1,canvas.width - 1);
+		if(x0 > x1)
+		{
+			return;
+		}
+
+		Ogre::uint32* dst = canvas.pixels + y * canvas.width + x0;
+		int count = x1 - x0 + 1;
+		if(brush.mode == REPLACE || brush.weight >= 256)
+		{
+			fillPixels(dst,count,brush.pixel);
+		}
+		else if(brush.weight > 0)
+		{
+			blendPixels(dst,count,brush.pixel,brush.weight);
+		}
+	}
+
+	void fillRect(const Canvas& canvas,int left,int top,int right,int bottom,const Brush& brush)
+	{
+		top = std::max(top,0);
+		bottom = std::min(bottom,canvas.height - 1);
+		for(int y = top; y <= bottom; ++y)
+		{
+			span(canvas,y,left,right,brush);
+		}
+	}
+
+	void line(const Canvas& canvas,int x0,int y0,int x1,int y1,const Brush& brush)
+	{
+		if(y0 == y1)
+		{
+			span(canvas,y0,x0,x1,brush);
+			return;
+		}
+
+		int dx = abs(x1 - x0),sx = (x0 < x1) ? 1 : -1;
+		int dy = -abs(y1 - y0),sy = (y0 < y1) ? 1 : -1;
+		int err = dx + dy;
+		for(;;)
+		{
+			plot(canvas,x0,y0,brush);
+			if(x0 == x1 && y0 == y1)
+			{
+				break;
+			}
+
+			int e2 = 2 * err;
+			if(e2 >= dy)
+			{
+				err += dy;
+				x0 += sx;
+			}
+			if(e2 <= dx)
+			{
+				err += dx;
+				y0 += sy;
+			}
+		}
+	}
+
+	void circle(const Canvas& canvas,int cx,int cy,int radius,const Brush& brush)
+	{
+		if(radius <= 0)
+		{
+			plot(canvas,cx,cy,brush);
+			return;
+		}
+
+		midpointCircle(radius,[&] (int x,int y) {
+			plotOctants(canvas,cx,cy,x,y,brush);
+		});
+	}
+
+	void fillCircle(const Canvas& canvas,int cx,int cy,int radius,const Brush& brush)
+	{
+		if(radius <= 0)
+		{
+			plot(canvas,cx,cy,brush);
+			return;
+		}
+
+		//one span per row, so blending never touches a pixel twice.
+		//half width shrinks as the rows move away from the center, same limit as the midpoint outline.
+		int limit = radius * radius + radius;
+		int halfWidth = radius;
+		for(int dy = 0; dy <= radius; ++dy)
+		{
+			while(halfWidth > 0 && halfWidth * halfWidth + dy * dy > limit)
+			{
+				--halfWidth;
+			}
+
+			span(canvas,cy + dy,cx - halfWidth,cx + halfWidth,brush);
+			if(dy != 0)
+			{
+				span(canvas,cy - dy,cx - halfWidth,cx + halfWidth,brush);
+			}
+		}
+	}
+
+	void arc(const Canvas& canvas,int cx,int cy,int radius,float startAngle,float endAngle,const Brush& brush)
+	{
+		const float twoPi = Ogre::Math::TWO_PI;
+		float sweep = endAngle - startAngle;
+		if(sweep >= twoPi || sweep <= -twoPi)
+		{
+			circle(canvas,cx,cy,radius,brush);
+			return;
+		}
+		if(sweep < 0.0f)
+		{
+			sweep += twoPi;
+		}
+		startAngle = fmod(startAngle,twoPi);
+		if(startAngle < 0.0f)
+		{
+			startAngle += twoPi;
+		}
+
+		//the outline is cheap enough that the angle of each point can just be checked.
+		auto plotIfInside = [&] (int dx,int dy) {
+			float angle = atan2(static_cast<float>(-dy),static_cast<float>(dx)) - startAngle;
+			if(angle < 0.0f)
+			{
+				angle += twoPi;
+			}
+			if(angle < 0.0f)
+			{
+				angle += twoPi;
+			}
+			if(angle <= sweep)
+			{
+				plot(canvas,cx + dx,cy + dy,brush);
+			}
+		};
+
+		midpointCircle(radius,[&] (int x,int y) {
+			plotIfInside(x,y);
+			plotIfInside(-x,-y);
+			if(x != 0)
+			{
+				plotIfInside(-x,y);
+				plotIfInside(x,-y);
+			}
+			if(x != y)
+			{
+				plotIfInside(y,x);
+				plotIfInside(-y,-x);
+				if(x != 0)
+				{
+					plotIfInside(-y,x);
+					plotIfInside(y,-x);
+				}
+			}
+		});
+	}
+
+	void fillPolygon(const Canvas& canvas,const Ogre::Vector2* points,int count,const Brush& brush)
+	{
+		if(count < 3)
+		{
+			return;
+		}
+
+		float minY = points[0].y,maxY = points[0].y;
+		for(int i = 1; i < count; ++i)
+		{
+			minY = std::min(minY,points[i].y);
+			maxY = std::max(maxY,points[i].y);
+		}
+
+		int top = std::max(static_cast<int>(ceil(minY - 0.5f)),0);
+		int bottom = std::min(static_cast<int>(floor(maxY - 0.5f)),canvas.height - 1);
+
+		std::vector<float> crossings;
+		crossings.reserve(count);
+		for(int y = top; y <= bottom; ++y)
+		{
+			//sample through the pixel centers.
+			float sampleY = y + 0.5f;
+			crossings.clear();
+			for(int i = 0,j = count - 1; i < count; j = i++)
+			{
+				const Ogre::Vector2& a = points[i];
+				const Ogre::Vector2& b = points[j];
+				if((a.y <= sampleY && b.y > sampleY) || (b.y <= sampleY && a.y > sampleY))
+				{
+					crossings.push_back(a.x + (sampleY - a.y) * (b.x - a.x) / (b.y - a.y));
+				}
+			}
+
+			std::sort(crossings.begin(),crossings.end());
+			for(size_t k = 0; k + 1 < crossings.size(); k += 2)
+			{
+				int x0 = static_cast<int>(ceil(crossings[k] - 0.5f));
+				int x1 = static_cast<int>(ceil(crossings[k + 1] - 0.5f)) - 1;
+				if(x0 <= x1)
+				{
+					span(canvas,y,x0,x1,brush);
+				}
+			}
+		}
+	}
+};
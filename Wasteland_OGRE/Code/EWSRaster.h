@@ -0,0 +1,66 @@
+#include "StdAfx.h"
+
+#ifndef _EWS_RASTER_H_
+#define _EWS_RASTER_H_
+
+//SSE2 is always there on the x86/x64 targets we build for, anything else gets the plain loops.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define EWS_RASTER_SSE2
+#endif
+
+/*! \brief Small software rasterizer used by the EWS to draw into its canvas.
+
+Everything works on 32-bit pixels that are already packed in the texture's format, and is clipped to the canvas.
+Shapes are broken into horizontal spans, which is where the (SIMD) fill/blend work happens.
+*/
+namespace EWSRaster
+{
+	struct Canvas
+	{
+		Ogre::uint32* pixels;
+		int width;
+		int height;
+	};
+
+	enum BLEND_MODE
+	{
+		//! Pixels are overwritten.
+		REPLACE = 0,
+		//! Pixels are mixed with what's already there, using the brush's alpha.
+		BLEND
+	};
+
+	struct Brush
+	{
+		Brush(Ogre::uint32 packedPixel,float alpha = 1.0f,BLEND_MODE blendMode = REPLACE);
+
+		Ogre::uint32 pixel;
+		//! 0-256, so that a full blend is a plain shift.
+		Ogre::uint32 weight;
+		BLEND_MODE mode;
+	};
+
+	//! Mixes src over dst, every channel(alpha included) with the same weight(0-256).
+	Ogre::uint32 blendPixel(Ogre::uint32 dst,Ogre::uint32 src,Ogre::uint32 weight);
+
+	//! Fills x0..x1(inclusive) of row y.
+	void span(const Canvas& canvas,int y,int x0,int x1,const Brush& brush);
+
+	//! Fills the rectangle, corners inclusive.
+	void fillRect(const Canvas& canvas,int left,int top,int right,int bottom,const Brush& brush);
+
+	//! Bresenham line, both end points included.
+	void line(const Canvas& canvas,int x0,int y0,int x1,int y1,const Brush& brush);
+
+	//! Midpoint circle outline.
+	void circle(const Canvas& canvas,int cx,int cy,int radius,const Brush& brush);
+	//! Midpoint circle, filled with one span per row.
+	void fillCircle(const Canvas& canvas,int cx,int cy,int radius,const Brush& brush);
+	//! Midpoint circle outline between two angles(radians, counter-clockwise from +x, y pointing down the canvas).
+	void arc(const Canvas& canvas,int cx,int cy,int radius,float startAngle,float endAngle,const Brush& brush);
+
+	//! Scanline fill of a polygon(even-odd rule), points in canvas coordinates.
+	void fillPolygon(const Canvas& canvas,const Ogre::Vector2* points,int count,const Brush& brush);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "StdAfx.h"
+
+#include "EWSRasterBenchmark.h"
+
+#ifdef EWS_RASTER_BENCHMARK
+
+#include "EWSRaster.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#define BENCH_CANVAS_WIDTH 1024
+#define BENCH_CANVAS_HEIGHT 1024
+#define BENCH_ITERATIONS 200
+#define BENCH_CIRCLE_RADIUS 64
+
+namespace EWSRaster
+{
+	namespace
+	{
+		//the old EWSManager routines, kept here so there is something to compare against.
+		inline void plotOld(const Canvas& canvas,int x,int y,Ogre::uint32 pixel)
+		{
+			if(x >= 0 && x < canvas.width && y >= 0 && y < canvas.height)
+			{
+				canvas.pixels[y * canvas.width + x] = pixel;
+			}
+		}
+
+		inline void plotBlendOld(const Canvas& canvas,int x,int y,Ogre::uint32 pixel,Ogre::uint32 weight)
+		{
+			if(x >= 0 && x < canvas.width && y >= 0 && y < canvas.height)
+			{
+				Ogre::uint32& dst = canvas.pixels[y * canvas.width + x];
+				dst = blendPixel(dst,pixel,weight);
+			}
+		}
+
+		void boxOld(const Canvas& canvas,int left,int top,int right,int bottom,Ogre::uint32 pixel)
+		{
+			for(int iy = top; iy <= bottom; ++iy)
+			{
+				for(int ix = left; ix <= right; ++ix)
+				{
+					plotOld(canvas,ix,iy,pixel);
+				}
+			}
+		}
+
+		//there was no blending before, this is what a plain per-pixel blend would have looked like.
+		void boxBlendOld(const Canvas& canvas,int left,int top,int right,int bottom,Ogre::uint32 pixel,Ogre::uint32 weight)
+		{
+			for(int iy = top; iy <= bottom; ++iy)
+			{
+				for(int ix = left; ix <= right; ++ix)
+				{
+					plotBlendOld(canvas,ix,iy,pixel,weight);
+				}
+			}
+		}
+
+		void circleOld(const Canvas& canvas,int cx,int cy,int radius,Ogre::uint32 pixel)
+		{
+			int dots = static_cast<int>(radius * (Ogre::Math::TWO_PI*4));
+			float deg2dot = 360 / (dots * 1.0f);
+
+			for(int f = 0; f <= radius; ++f)
+			{
+				for(int d = 0; d <= dots; ++d)
+				{
+					int u = static_cast<int>(sin(d * deg2dot) * (radius - f));
+					int v = static_cast<int>(cos(d * deg2dot) * (radius - f));
+					plotOld(canvas,cx + u,cy + v,pixel);
+				}
+			}
+		}
+
+		//runs the test BENCH_ITERATIONS times and returns the average in microseconds.
+		template<typename Test>
+		double timeIt(Ogre::Timer& timer,Test test)
+		{
+			timer.reset();
+			for(int i = 0; i < BENCH_ITERATIONS; ++i)
+			{
+				test(i);
+			}
+			return static_cast<double>(timer.getMicroseconds()) / BENCH_ITERATIONS;
+		}
+
+		void report(const char* name,double oldTime,double newTime)
+		{
+			std::cout << name << ": old " << oldTime << "us, new " << newTime << "us";
+			if(newTime > 0.0)
+			{
+				std::cout << " (" << oldTime / newTime << "x)";
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	int runBenchmark()
+	{
+		std::vector<Ogre::uint32> pixels(BENCH_CANVAS_WIDTH * BENCH_CANVAS_HEIGHT,0xFF000000);
+		Canvas canvas = { &pixels[0],BENCH_CANVAS_WIDTH,BENCH_CANVAS_HEIGHT };
+		Brush fill(0xFF336699);
+		Brush blend(0xFF336699,0.5f,BLEND);
+		Ogre::Timer timer;
+		double oldTime,newTime;
+
+		std::cout << "EWS raster benchmark, " << BENCH_CANVAS_WIDTH << "x" << BENCH_CANVAS_HEIGHT << " canvas, "
+				  << BENCH_ITERATIONS << " iterations each." << std::endl;
+
+		oldTime = timeIt(timer,[&](int) { std::fill(pixels.begin(),pixels.end(),fill.pixel); });
+		newTime = timeIt(timer,[&](int) { fillRect(canvas,0,0,canvas.width - 1,canvas.height - 1,fill); });
+		report("Fill",oldTime,newTime);
+
+		//odd sizes and offsets, so the scalar tails and unaligned stores get exercised too.
+		oldTime = timeIt(timer,[&](int i) { boxOld(canvas,i % 7,i % 5,canvas.width - 3,canvas.height - 2,fill.pixel); });
+		newTime = timeIt(timer,[&](int i) { fillRect(canvas,i % 7,i % 5,canvas.width - 3,canvas.height - 2,fill); });
+		report("Box",oldTime,newTime);
+
+		oldTime = timeIt(timer,[&](int i) { boxBlendOld(canvas,i % 7,i % 5,canvas.width - 3,canvas.height - 2,blend.pixel,blend.weight); });
+		newTime = timeIt(timer,[&](int i) { fillRect(canvas,i % 7,i % 5,canvas.width - 3,canvas.height - 2,blend); });
+		report("Box(blend)",oldTime,newTime);
+
+		int cx = canvas.width / 2,cy = canvas.height / 2;
+		oldTime = timeIt(timer,[&](int) { circleOld(canvas,cx,cy,BENCH_CIRCLE_RADIUS,fill.pixel); });
+		newTime = timeIt(timer,[&](int) { fillCircle(canvas,cx,cy,BENCH_CIRCLE_RADIUS,fill); });
+		report("Circle",oldTime,newTime);
+
+		std::cout << "Press enter to exit." << std::endl;
+		std::cin.get();
+		return 0;
+	}
+};
+
+#endif
@@ -0,0 +1,15 @@
+#include "StdAfx.h"
+
+#ifndef _EWS_RASTER_BENCHMARK_H_
+#define _EWS_RASTER_BENCHMARK_H_
+
+//Define EWS_RASTER_BENCHMARK to build the game as a benchmark that times the EWS rasterizer and exits.
+#ifdef EWS_RASTER_BENCHMARK
+namespace EWSRaster
+{
+	//! Times the rasterizer against the per-pixel loops it replaced, prints the results to std::cout and returns 0.
+	int runBenchmark();
+};
+#endif
+
+#endif
@@ -85,7 +85,7 @@ namespace GameManager
 				//unless otherwise told
 				if(objectInfo->collisionShape() == "TriangleMesh")
 				{
-					shape = buildTriangleCollisionShape(node,graphicsManager);
+					shape = buildTriangleCollisionShape(node,graphicsManager,phyManager);
 					node->getAttachedObject(0)->setQueryFlags(LEVEL_MASK);
 				}
 				else
@@ -141,7 +141,7 @@ namespace GameManager
 		}
 		else
 		{
-			shape = buildTriangleCollisionShape(node,graphicsManager);
+			shape = buildTriangleCollisionShape(node,graphicsManager,phyManager);
 			node->getAttachedObject(0)->setQueryFlags(LEVEL_MASK);
 		}
 		btTransform init; init.setIdentity();
@@ -255,38 +255,36 @@ namespace GameManager
 	}
 
 	//manually builds triangle mesh collision shape.
-	btBvhTriangleMeshShape* buildTriangleCollisionShape(Ogre::SceneNode* node,GraphicsManager* Graphics)
+	btBvhTriangleMeshShape* buildTriangleCollisionShape(Ogre::SceneNode* node,GraphicsManager* Graphics,PhysicsManager* phyManager)
 	{
-		btBvhTriangleMeshShape* shape;
-		btTriangleMesh* bmesh = new btTriangleMesh();
-
 		Ogre::MeshPtr mesh = ((Ogre::Entity*)node->getAttachedObject(0))->getMesh();
+
+		//every object using this mesh shares the shape.
+		std::string key = "TriangleMesh:" + mesh->getName();
+		btCollisionShape* shared = phyManager->getShapeCache()->acquire(key);
+		if(shared)
+		{
+			return static_cast<btBvhTriangleMeshShape*>(shared);
+		}
+
 		size_t vertCnt,inCnt;
 		Ogre::Vector3* vertices;
 		unsigned long* indices;
 
 		Graphics->getMeshInformation(&mesh,vertCnt,vertices,inCnt,indices);
 
-		btVector3 vert1,vert2,vert3;
-
-		for(unsigned int i=0; i<inCnt; i+=3)
+		std::vector<btVector3> triangles;
+		triangles.reserve(inCnt);
+		for(unsigned int i=0; i<inCnt; ++i)
 		{
-			vert1.setValue(vertices[indices[i]].x,vertices[indices[i]].y,vertices[indices[i]].z);
-			vert2.setValue(vertices[indices[i+1]].x,vertices[indices[i+1]].y,vertices[indices[i+1]].z);
-			vert3.setValue(vertices[indices[i+2]].x,vertices[indices[i+2]].y,vertices[indices[i+2]].z);
-
-			bmesh->addTriangle(vert1,vert2,vert3);
+			triangles.push_back(btVector3(vertices[indices[i]].x,vertices[indices[i]].y,vertices[indices[i]].z));
 		}
 
-		shape = new btBvhTriangleMeshShape(bmesh,true,true);
-
 		delete[] vertices;
 		delete[] indices;
 
-		//delete bmesh;
-		shape->setUserPointer(static_cast<void*>(bmesh));
-
-		return shape;
+		//the BVH is the slow part on the big level meshes, it's kept in the working directory between runs.
+		return phyManager->getShapeCache()->createTriangleMeshShape(key,triangles,mesh->getName() + ".bvh");
 	}
 
 };
\ No newline at end of file
@@ -94,8 +94,9 @@ namespace GameManager
 	bool UpdateManagers(GraphicsManager* graphicsManager,PhysicsManager* phyManager,float deltaTime);
 	
 	//! Utilizes a special GraphicsManager function to create a triangle mesh collision shape.
-	//! \sa GraphicsManager::getMeshInformation()
-	btBvhTriangleMeshShape* buildTriangleCollisionShape(Ogre::SceneNode* node,GraphicsManager* Graphics);
+	//! The shape is shared by every node with the same mesh, and its BVH is cached on disk.
+	//! \sa GraphicsManager::getMeshInformation(), CollisionShapeCache::createTriangleMeshShape()
+	btBvhTriangleMeshShape* buildTriangleCollisionShape(Ogre::SceneNode* node,GraphicsManager* Graphics,PhysicsManager* phyManager);
 };
 
 #endif
\ No newline at end of file
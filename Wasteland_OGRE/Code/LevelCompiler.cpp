@@ -0,0 +1,539 @@
+#include "StdAfx.h"
+
+#include "LevelCompiler.h"
+
+#include <sys\types.h>
+#include <sys\stat.h>
+#include <fstream>
+
+/*
+Compiled level layout, everything little-endian and tightly packed:
+FileHeader
+TriggerBin[triggerCount]
+LightBin[lightCount]
+DoorBin[doorCount]
+WaypointBin[waypointCount]
+char strings[stringBytes]	-- every string referenced by the records, not null terminated
+
+checksum is FNV-1a over everything after the header.
+*/
+namespace
+{
+#pragma pack(push,1)
+	struct StringRef
+	{
+		Ogre::uint32 offset;
+		Ogre::uint32 length;
+	};
+
+	struct FileHeader
+	{
+		char magic[4];
+		Ogre::uint32 version;
+		Ogre::uint64 sourceSize;
+		Ogre::uint64 sourceTime;
+		Ogre::uint32 checksum;
+		Ogre::uint32 triggerCount;
+		Ogre::uint32 lightCount;
+		Ogre::uint32 doorCount;
+		Ogre::uint32 waypointCount;
+		Ogre::uint32 stringBytes;
+	};
+
+	struct TriggerBin
+	{
+		Ogre::int32 triggerType;
+		float center[3];
+		float cornersOffset[3];
+		StringRef script;
+		StringRef target;
+		Ogre::int32 timeDelay;
+		Ogre::uint32 contExec;
+	};
+
+	struct LightBin
+	{
+		Ogre::int32 lightType;
+		float position[3];
+		float direction[3];
+		Ogre::int32 range;
+		float diffColour[4];
+		float specColour[4];
+		float innerAng;
+		float outerAng;
+	};
+
+	struct DoorBin
+	{
+		float position[3];
+		float direction[3];
+		float connectionPoint[3];
+		float axis[3];
+		StringRef name;
+		StringRef baseName;
+		StringRef doorFileName;
+		StringRef scriptName;
+		float minAng;
+		float maxAng;
+	};
+
+	struct WaypointBin
+	{
+		float position[3];
+		Ogre::int32 order;
+	};
+#pragma pack(pop)
+
+	const char LEVEL_MAGIC[4] = { 'W','L','V','L' };
+
+	Ogre::uint32 fnv1a(const char* data,size_t size,Ogre::uint32 hash = 2166136261u)
+	{
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	//Size and last write time of a file, false if it doesn't exist.
+	bool getFileStamp(const std::string& file,Ogre::uint64& size,Ogre::uint64& time)
+	{
+		struct stat info;
+		if(stat(file.c_str(),&info) != 0)
+		{
+			return false;
+		}
+		size = static_cast<Ogre::uint64>(info.st_size);
+		time = static_cast<Ogre::uint64>(info.st_mtime);
+		return true;
+	}
+
+	void writeVector3(float* out,const Ogre::Vector3& v)
+	{
+		out[0] = v.x; out[1] = v.y; out[2] = v.z;
+	}
+
+	Ogre::Vector3 readVector3(const float* in)
+	{
+		return Ogre::Vector3(in[0],in[1],in[2]);
+	}
+
+	void writeColour(float* out,const Ogre::ColourValue& c)
+	{
+		out[0] = c.r; out[1] = c.g; out[2] = c.b; out[3] = c.a;
+	}
+
+	Ogre::ColourValue readColour(const float* in)
+	{
+		return Ogre::ColourValue(in[0],in[1],in[2],in[3]);
+	}
+
+	StringRef addString(std::vector<char>& strings,const std::string& str)
+	{
+		StringRef ref;
+		ref.offset = static_cast<Ogre::uint32>(strings.size());
+		ref.length = static_cast<Ogre::uint32>(str.size());
+		strings.insert(strings.end(),str.begin(),str.end());
+		return ref;
+	}
+
+	template<typename T>
+	void appendRecords(std::vector<char>& payload,const std::vector<T>& records)
+	{
+		if(!records.empty())
+		{
+			const char* data = reinterpret_cast<const char*>(&records[0]);
+			payload.insert(payload.end(),data,data + records.size() * sizeof(T));
+		}
+	}
+
+	//Read-only view of a whole file. Memory-mapped on Windows, read into memory elsewhere.
+	class MappedFile
+	{
+	public:
+		MappedFile() : _data(nullptr),_size(0)
+#if defined(WIN32) || defined(_WIN32)
+			,_file(INVALID_HANDLE_VALUE),_mapping(NULL)
+#endif
+		{}
+
+		~MappedFile() { close(); }
+
+		bool open(const std::string& fileName)
+		{
+			close();
+#if defined(WIN32) || defined(_WIN32)
+			_file = CreateFileA(fileName.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+			if(_file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER size;
+			if(!GetFileSizeEx(_file,&size) || size.QuadPart == 0)
+			{
+				close();
+				return false;
+			}
+
+			_mapping = CreateFileMappingA(_file,NULL,PAGE_READONLY,0,0,NULL);
+			if(_mapping == NULL)
+			{
+				close();
+				return false;
+			}
+
+			_data = static_cast<const char*>(MapViewOfFile(_mapping,FILE_MAP_READ,0,0,0));
+			if(_data == nullptr)
+			{
+				close();
+				return false;
+			}
+			_size = static_cast<size_t>(size.QuadPart);
+#else
+			std::ifstream file(fileName.c_str(),std::ios::in | std::ios::binary);
+			if(!file.is_open())
+			{
+				return false;
+			}
+			file.seekg(0,std::ios::end);
+			std::streamoff size = file.tellg();
+			file.seekg(0,std::ios::beg);
+			if(size <= 0)
+			{
+				return false;
+			}
+			_buffer.resize(static_cast<size_t>(size));
+			file.read(&_buffer[0],size);
+			_data = &_buffer[0];
+			_size = _buffer.size();
+#endif
+			return true;
+		}
+
+		void close()
+		{
+#if defined(WIN32) || defined(_WIN32)
+			if(_data != nullptr)
+			{
+				UnmapViewOfFile(_data);
+			}
+			if(_mapping != NULL)
+			{
+				CloseHandle(_mapping);
+				_mapping = NULL;
+			}
+			if(_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(_file);
+				_file = INVALID_HANDLE_VALUE;
+			}
+#else
+			_buffer.clear();
+#endif
+			_data = nullptr;
+			_size = 0;
+		}
+
+		const char* data() const { return _data; }
+		size_t size() const { return _size; }
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const char* _data;
+		size_t _size;
+#if defined(WIN32) || defined(_WIN32)
+		HANDLE _file;
+		HANDLE _mapping;
+#else
+		std::vector<char> _buffer;
+#endif
+	};
+}
+
+namespace LevelData
+{
+	std::string LevelCompiler::getBinaryName(const std::string& sourceFile)
+	{
+		return sourceFile + "c";
+	}
+
+	bool LevelCompiler::compile(const LevelDescription& level,const std::string& sourceFile,const std::string& binaryFile)
+	{
+		FileHeader header;
+		memcpy(header.magic,LEVEL_MAGIC,sizeof(header.magic));
+		header.version = COMPILED_LEVEL_VERSION;
+		header.sourceSize = 0;
+		header.sourceTime = 0;
+		getFileStamp(sourceFile,header.sourceSize,header.sourceTime);
+		header.triggerCount = static_cast<Ogre::uint32>(level.triggers.size());
+		header.lightCount = static_cast<Ogre::uint32>(level.lights.size());
+		header.doorCount = static_cast<Ogre::uint32>(level.doors.size());
+		header.waypointCount = static_cast<Ogre::uint32>(level.waypoints.size());
+
+		std::vector<char> strings;
+
+		std::vector<TriggerBin> triggers(level.triggers.size());
+		for(size_t i = 0; i < level.triggers.size(); ++i)
+		{
+			const TriggerRecord& rec = level.triggers[i];
+			TriggerBin& bin = triggers[i];
+			bin.triggerType = rec.triggerType;
+			writeVector3(bin.center,rec.center);
+			writeVector3(bin.cornersOffset,rec.cornersOffset);
+			bin.script = addString(strings,rec.script);
+			bin.target = addString(strings,rec.target);
+			bin.timeDelay = rec.timeDelay;
+			bin.contExec = rec.contExec ? 1 : 0;
+		}
+
+		std::vector<LightBin> lights(level.lights.size());
+		for(size_t i = 0; i < level.lights.size(); ++i)
+		{
+			const LightRecord& rec = level.lights[i];
+			LightBin& bin = lights[i];
+			bin.lightType = rec.lightType;
+			writeVector3(bin.position,rec.position);
+			writeVector3(bin.direction,rec.direction);
+			bin.range = rec.range;
+			writeColour(bin.diffColour,rec.diffColour);
+			writeColour(bin.specColour,rec.specColour);
+			bin.innerAng = rec.innerAng;
+			bin.outerAng = rec.outerAng;
+		}
+
+		std::vector<DoorBin> doors(level.doors.size());
+		for(size_t i = 0; i < level.doors.size(); ++i)
+		{
+			const DoorRecord& rec = level.doors[i];
+			DoorBin& bin = doors[i];
+			writeVector3(bin.position,rec.position);
+			writeVector3(bin.direction,rec.direction);
+			writeVector3(bin.connectionPoint,rec.connectionPoint);
+			writeVector3(bin.axis,rec.axis);
+			bin.name = addString(strings,rec.name);
+			bin.baseName = addString(strings,rec.baseName);
+			bin.doorFileName = addString(strings,rec.doorFileName);
+			bin.scriptName = addString(strings,rec.scriptName);
+			bin.minAng = rec.minAng;
+			bin.maxAng = rec.maxAng;
+		}
+
+		std::vector<WaypointBin> waypoints(level.waypoints.size());
+		for(size_t i = 0; i < level.waypoints.size(); ++i)
+		{
+			writeVector3(waypoints[i].position,level.waypoints[i].position);
+			waypoints[i].order = level.waypoints[i].order;
+		}
+
+		std::vector<char> payload;
+		payload.reserve(triggers.size() * sizeof(TriggerBin) + lights.size() * sizeof(LightBin) +
+						doors.size() * sizeof(DoorBin) + waypoints.size() * sizeof(WaypointBin) + strings.size());
+		appendRecords(payload,triggers);
+		appendRecords(payload,lights);
+		appendRecords(payload,doors);
+		appendRecords(payload,waypoints);
+		payload.insert(payload.end(),strings.begin(),strings.end());
+
+		header.stringBytes = static_cast<Ogre::uint32>(strings.size());
+		header.checksum = payload.empty() ? fnv1a(nullptr,0) : fnv1a(&payload[0],payload.size());
+
+		std::ofstream out(binaryFile.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!out.is_open())
+		{
+			std::cout << "Error! Unable to write compiled level " << binaryFile << std::endl;
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header),sizeof(header));
+		if(!payload.empty())
+		{
+			out.write(&payload[0],payload.size());
+		}
+
+		return out.good();
+	}
+
+	bool LevelCompiler::compileFile(const std::string& sourceFile,const std::string& binaryFile)
+	{
+		LevelParser parser;
+		parser.setFile(sourceFile.c_str());
+
+		LevelDescription level;
+		if(!parser.parseDescription(&level))
+		{
+			//don't bake a broken level, the errors would be hidden on the next load.
+			return false;
+		}
+
+		return compile(level,sourceFile,binaryFile);
+	}
+
+	bool LevelCompiler::load(const std::string& binaryFile,const std::string& sourceFile,LevelDescription* level)
+	{
+		MappedFile file;
+		if(!file.open(binaryFile))
+		{
+			return false;
+		}
+
+		if(file.size() < sizeof(FileHeader))
+		{
+			std::cout << "Compiled level " << binaryFile << " is truncated, ignoring it." << std::endl;
+			return false;
+		}
+
+		FileHeader header;
+		memcpy(&header,file.data(),sizeof(header));
+		if(memcmp(header.magic,LEVEL_MAGIC,sizeof(header.magic)) != 0 || header.version != COMPILED_LEVEL_VERSION)
+		{
+			std::cout << "Compiled level " << binaryFile << " is from another version, ignoring it." << std::endl;
+			return false;
+		}
+
+		//if the source is around, it has to be the one this was compiled from.
+		Ogre::uint64 sourceSize = 0,sourceTime = 0;
+		if(!sourceFile.empty() && getFileStamp(sourceFile,sourceSize,sourceTime))
+		{
+			if(sourceSize != header.sourceSize || sourceTime != header.sourceTime)
+			{
+				std::cout << "Compiled level " << binaryFile << " is out of date." << std::endl;
+				return false;
+			}
+		}
+
+		Ogre::uint64 expectedSize = static_cast<Ogre::uint64>(header.triggerCount) * sizeof(TriggerBin) +
+									static_cast<Ogre::uint64>(header.lightCount) * sizeof(LightBin) +
+									static_cast<Ogre::uint64>(header.doorCount) * sizeof(DoorBin) +
+									static_cast<Ogre::uint64>(header.waypointCount) * sizeof(WaypointBin) +
+									header.stringBytes;
+		size_t payloadSize = file.size() - sizeof(FileHeader);
+		const char* payload = file.data() + sizeof(FileHeader);
+		if(expectedSize != payloadSize || fnv1a(payload,payloadSize) != header.checksum)
+		{
+			std::cout << "Compiled level " << binaryFile << " is corrupt, ignoring it." << std::endl;
+			return false;
+		}
+
+		//records are packed, so they're copied out instead of being used in place.
+		const char* cursor = payload;
+		const char* strings = payload + payloadSize - header.stringBytes;
+		bool stringsValid = true;
+		auto getString = [&] (const StringRef& ref) -> std::string
+		{
+			if(static_cast<Ogre::uint64>(ref.offset) + ref.length > header.stringBytes)
+			{
+				stringsValid = false;
+				return std::string();
+			}
+			return std::string(strings + ref.offset,ref.length);
+		};
+
+		LevelDescription result;
+		result.triggers.resize(header.triggerCount);
+		for(Ogre::uint32 i = 0; i < header.triggerCount; ++i,cursor += sizeof(TriggerBin))
+		{
+			TriggerBin bin;
+			memcpy(&bin,cursor,sizeof(bin));
+			TriggerRecord& rec = result.triggers[i];
+			rec.triggerType = bin.triggerType;
+			rec.center = readVector3(bin.center);
+			rec.cornersOffset = readVector3(bin.cornersOffset);
+			rec.script = getString(bin.script);
+			rec.target = getString(bin.target);
+			rec.timeDelay = bin.timeDelay;
+			rec.contExec = (bin.contExec != 0);
+		}
+
+		result.lights.resize(header.lightCount);
+		for(Ogre::uint32 i = 0; i < header.lightCount; ++i,cursor += sizeof(LightBin))
+		{
+			LightBin bin;
+			memcpy(&bin,cursor,sizeof(bin));
+			LightRecord& rec = result.lights[i];
+			rec.lightType = bin.lightType;
+			rec.position = readVector3(bin.position);
+			rec.direction = readVector3(bin.direction);
+			rec.range = bin.range;
+			rec.diffColour = readColour(bin.diffColour);
+			rec.specColour = readColour(bin.specColour);
+			rec.innerAng = bin.innerAng;
+			rec.outerAng = bin.outerAng;
+		}
+
+		result.doors.resize(header.doorCount);
+		for(Ogre::uint32 i = 0; i < header.doorCount; ++i,cursor += sizeof(DoorBin))
+		{
+			DoorBin bin;
+			memcpy(&bin,cursor,sizeof(bin));
+			DoorRecord& rec = result.doors[i];
+			rec.position = readVector3(bin.position);
+			rec.direction = readVector3(bin.direction);
+			rec.connectionPoint = readVector3(bin.connectionPoint);
+			rec.axis = readVector3(bin.axis);
+			rec.name = getString(bin.name);
+			rec.baseName = getString(bin.baseName);
+			rec.doorFileName = getString(bin.doorFileName);
+			rec.scriptName = getString(bin.scriptName);
+			rec.minAng = bin.minAng;
+			rec.maxAng = bin.maxAng;
+		}
+
+		result.waypoints.resize(header.waypointCount);
+		for(Ogre::uint32 i = 0; i < header.waypointCount; ++i,cursor += sizeof(WaypointBin))
+		{
+			WaypointBin bin;
+			memcpy(&bin,cursor,sizeof(bin));
+			result.waypoints[i].position = readVector3(bin.position);
+			result.waypoints[i].order = bin.order;
+		}
+
+		if(!stringsValid)
+		{
+			std::cout << "Compiled level " << binaryFile << " is corrupt, ignoring it." << std::endl;
+			return false;
+		}
+
+		std::swap(*level,result);
+		return true;
+	}
+
+	bool loadLevel(const std::string& sourceFile,
+				   std::vector<std::unique_ptr<TriggerZone>>* triggers,
+				   std::vector<std::unique_ptr<LightData>>* lights,
+				   std::vector<std::unique_ptr<DoorData>>* doors,
+				   WaypointSet* waypoints,
+				   Ogre::SceneNode* rootNode)
+	{
+		std::string binaryFile = LevelCompiler::getBinaryName(sourceFile);
+
+		LevelDescription level;
+		bool success = true;
+		if(!LevelCompiler::load(binaryFile,sourceFile,&level))
+		{
+			LevelParser parser;
+			parser.setFile(sourceFile.c_str());
+			success = parser.parseDescription(&level);
+			if(success)
+			{
+				LevelCompiler::compile(level,sourceFile,binaryFile);
+			}
+		}
+
+		std::vector<Waypoint> waypointList;
+		LevelParser::buildEntities(level,triggers,lights,doors,waypoints ? &waypointList : nullptr,rootNode);
+
+		if(waypoints)
+		{
+			for(auto itr = waypointList.begin(); itr != waypointList.end(); ++itr)
+			{
+				waypoints->addWaypoint(*itr);
+			}
+			waypoints->finalizeSet();
+		}
+
+		return success;
+	}
+};
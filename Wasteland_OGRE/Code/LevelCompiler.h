@@ -0,0 +1,45 @@
+#include "StdAfx.h"
+
+#ifndef _LEVELCOMPILER_H_
+#define _LEVELCOMPILER_H_
+
+#include "LevelData.h"
+
+//Compiled(binary) form of the .ent level files.
+//The text file stays the source of truth, the binary is written next to it the first time it's parsed
+//and used on every load after that as long as it's still up to date.
+namespace LevelData
+{
+	//Bump whenever the layout of the compiled records changes, old binaries are rebuilt automatically.
+	const Ogre::uint32 COMPILED_LEVEL_VERSION = 1;
+
+	class LevelCompiler
+	{
+	public:
+		//Writes level to binaryFile. sourceFile is the .ent file it came from, its size and time are stored
+		//so that edits to it can be detected.
+		static bool compile(const LevelDescription& level,const std::string& sourceFile,const std::string& binaryFile);
+
+		//Parses sourceFile as text and writes the compiled version of it.
+		static bool compileFile(const std::string& sourceFile,const std::string& binaryFile);
+
+		//Memory-maps binaryFile and fills level from it.
+		//Returns false if the file is missing, from another version, corrupt, or older than sourceFile.
+		//sourceFile may be empty, in which case the staleness check is skipped.
+		static bool load(const std::string& binaryFile,const std::string& sourceFile,LevelDescription* level);
+
+		//The file the compiled version of sourceFile is kept in.
+		static std::string getBinaryName(const std::string& sourceFile);
+	};
+
+	//Loads a level, preferring the compiled file and falling back to LevelParser(which then recompiles it).
+	//Any output pointer may be null, see LevelParser::parse.
+	bool loadLevel(const std::string& sourceFile,
+				   std::vector<std::unique_ptr<TriggerZone>>* triggers,
+				   std::vector<std::unique_ptr<LightData>>* lights,
+				   std::vector<std::unique_ptr<DoorData>>* doors,
+				   WaypointSet* waypoints,
+				   Ogre::SceneNode* rootNode);
+};
+
+#endif
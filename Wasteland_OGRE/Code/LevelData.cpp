@@ -3,37 +3,153 @@
 #include "LevelData.h"
 #include "LuaManager.h"
 #include "Utility.h"
+#include "DetourInterface.h"
 
-#include <boost\lexical_cast.hpp>
-#include <boost\tokenizer.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
-typedef boost::token_iterator_generator<boost::char_separator<char>>::type TknItr_Str;
-
-TknItr_Str getTknItrStart(const std::string& str,boost::char_separator<char> &sep)
+//Helpers for the level file tokenizer.
+//Everything here works directly on the file buffer, nothing is allocated while scanning.
+namespace
 {
-	return boost::make_token_iterator<std::string>(str.begin(),str.end(),sep);
-}
+	//Non-owning view of a run of characters inside the level file buffer.
+	struct TextSpan
+	{
+		TextSpan() : begin(nullptr),end(nullptr) {}
+		TextSpan(const char* b,const char* e) : begin(b),end(e) {}
 
-TknItr_Str getTknItrEnd(const std::string& str,boost::char_separator<char> &sep)
-{
-	return boost::make_token_iterator<std::string>(str.end(),str.end(),sep);
-}
+		size_t size() const { return static_cast<size_t>(end - begin); }
 
-void getVector3FromTknItr(Ogre::Vector3& vector,TknItr_Str start,TknItr_Str end)
-{
-	int i = 0;
-	for(auto itr = start; itr != end && i < 3; ++itr,++i)
+		bool equals(const char* str) const
+		{
+			size_t len = strlen(str);
+			return (len == size() && strncmp(begin,str,len) == 0);
+		}
+
+		bool contains(const char* str) const
+		{
+			size_t len = strlen(str);
+			for(const char* p = begin; p + len <= end; ++p)
+			{
+				if(strncmp(p,str,len) == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::string str() const { return std::string(begin,end); }
+
+		const char* begin;
+		const char* end;
+	};
+
+	enum RECORD_KIND
+	{
+		RK_NONE = 0,
+		RK_TRIGGER,
+		RK_LIGHT,
+		RK_DOOR,
+		RK_WAYPOINT
+	};
+
+	const char* findChar(const char* start,const char* end,char c)
+	{
+		return static_cast<const char*>(memchr(start,c,end - start));
+	}
+
+	//Reads a number at the start of [p,end). Returns the position after it, or nullptr if there isn't one.
+	const char* readFloat(const char* p,const char* end,float& out)
+	{
+		while(p < end && (*p == ' ' || *p == '\t'))
+		{
+			++p;
+		}
+		if(p >= end)
+		{
+			return nullptr;
+		}
+
+		char* stop = nullptr;
+		double value = strtod(p,&stop);
+		if(stop == p || stop > end)
+		{
+			return nullptr;
+		}
+
+		out = static_cast<float>(value);
+		return stop;
+	}
+
+	bool readFloat(const TextSpan& value,float& out)
+	{
+		return readFloat(value.begin,value.end,out) != nullptr;
+	}
+
+	bool readInt(const TextSpan& value,int& out)
 	{
-		try
+		float f = 0.0f;
+		if(!readFloat(value,f))
+		{
+			return false;
+		}
+		out = static_cast<int>(f);
+		return true;
+	}
+
+	bool readBool(const TextSpan& value,bool& out)
+	{
+		if(value.equals("true")) { out = true; return true; }
+		if(value.equals("false")) { out = false; return true; }
+
+		int i = 0;
+		if(!readInt(value,i))
 		{
-			vector[i] = boost::lexical_cast<Ogre::Real,std::string>(*itr);
+			return false;
 		}
-		catch(boost::bad_lexical_cast& e)
+		out = (i != 0);
+		return true;
+	}
+
+	//Comma-separated triple. Missing components are left at zero and reported.
+	bool readVector3(const TextSpan& value,Ogre::Vector3& out)
+	{
+		out = Ogre::Vector3::ZERO;
+		const char* p = value.begin;
+		for(int i = 0; i < 3; ++i)
 		{
-			//these errors are way too common to ignore.
-			OutputDebugStringA(e.what());
-			vector[i] = static_cast<Ogre::Real>(0.0f);
+			p = readFloat(p,value.end,out[i]);
+			if(p == nullptr)
+			{
+				return false;
+			}
+
+			while(p < value.end && (*p == ' ' || *p == '\t'))
+			{
+				++p;
+			}
+			if(i < 2)
+			{
+				if(p >= value.end || *p != ',')
+				{
+					return false;
+				}
+				++p;
+			}
 		}
+		return true;
+	}
+
+	bool readColour(const TextSpan& value,Ogre::ColourValue& out)
+	{
+		Ogre::Vector3 t;
+		bool ok = readVector3(value,t);
+		out.r = t.x;
+		out.g = t.y;
+		out.b = t.z;
+		return ok;
 	}
 }
 
@@ -42,6 +158,15 @@ namespace LevelData
 	//=================================
 	//Base Entity class
 	//=================================
+	BaseEntity::~BaseEntity()
+	{
+		LuaManager* lua = LuaManager::getSingletonPtr();
+		if(lua != nullptr && _handle != INVALID_ENTITY_HANDLE)
+		{
+			lua->removeEntity(_handle);
+		}
+	}
+
 	void BaseEntity::setName(const std::string& name)
 	{
 		_name = name;
@@ -57,9 +182,33 @@ namespace LevelData
 	void BaseEntity::setScriptFunction(const std::string& scriptFunc)
 	{
 		_scriptName = scriptFunc;
+		rebindScriptFunction();
 	}
 	std::string BaseEntity::getScriptFunction() { return _scriptName;}
 
+	bool BaseEntity::pushScriptFunction()
+	{
+		LuaManager* lua = LuaManager::getSingletonPtr();
+		if(_scriptRefGeneration != lua->getFunctionRefGeneration())
+		{
+			_scriptRef = lua->getFunctionRef(_scriptName);
+			_scriptRefGeneration = lua->getFunctionRefGeneration();
+		}
+
+		return lua->prepFunction(_scriptRef);
+	}
+
+	bool BaseEntity::callScriptFunction(int expectedNumReturn)
+	{
+		if(!pushScriptFunction())
+		{
+			return false;
+		}
+
+		LuaManager::getSingleton().callFunction(0,expectedNumReturn);
+		return true;
+	}
+
 	void BaseEntity::activate(bool active)
 	{
 		_activated = active;
@@ -69,6 +218,29 @@ namespace LevelData
 	//TriggerZone, base of all other triggers
 	//============================
 
+	TriggerZone::~TriggerZone()
+	{
+		if(_physics && _volume)
+		{
+			_physics->removeTriggerVolume(_volume);
+		}
+	}
+
+	void TriggerZone::_createBoxVolume(PhysicsManager* physics,const Ogre::AxisAlignedBox& boundaries,TriggerListener* listener,short mask)
+	{
+		if(physics == nullptr || _volume != nullptr || !boundaries.isFinite())
+		{
+			return;
+		}
+
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(Utility::convert_OgreVector3(boundaries.getCenter()));
+
+		_physics = physics;
+		_volume = physics->addTriggerVolume(Utility::convert_OgreVector3(boundaries.getHalfSize()),transform,listener,mask);
+	}
+
 	void TriggerZone::setTriggerType(TRIGGER_TYPE type)
 	{
 		_triggerType = type;
@@ -94,7 +266,7 @@ namespace LevelData
 
 		if(_triggered)
 		{
-			LuaManager::getSingleton().callFunction(_scriptName);
+			callScriptFunction();
 			//handle whatever return values I want it to do(none?)
 		}
 	}
@@ -104,11 +276,22 @@ namespace LevelData
 	//============================
 	void PlayerTrigger::update(OgreTransform& playerTransform, int deltaTimeInMs)
 	{
+		if(_volume)
+		{
+			//entering is handled by onTriggerEnter, only scripted activation is left.
+			if(_activated)
+			{
+				callScriptFunction();
+				_activated = false;
+			}
+			return;
+		}
+
 		_triggered = check(playerTransform);
 		if((_triggered && !_triggerInZone) || _activated)
 		{
 			//callback to lua or other function
-			LuaManager::getSingleton().callFunction(_scriptName);
+			callScriptFunction();
 			//This function must handle lua return values
 
 			//most scripts called by this type of triggerzone are activation scripts.
@@ -145,6 +328,40 @@ namespace LevelData
 		_boundaries = zoneBoundaries;
 	}
 
+	void PlayerTrigger::createVolume(PhysicsManager* physics)
+	{
+		_createBoxVolume(physics,_boundaries,this,btBroadphaseProxy::CharacterFilter);
+	}
+
+	void PlayerTrigger::onTriggerEnter(const TriggerOverlap& other)
+	{
+		if(!(other.collisionFlags & btCollisionObject::CF_CHARACTER_OBJECT))
+		{
+			return;
+		}
+
+		if(_overlapCount++ == 0)
+		{
+			_triggered = true;
+			_triggerInZone = true;
+			callScriptFunction();
+		}
+	}
+
+	void PlayerTrigger::onTriggerExit(const TriggerOverlap& other)
+	{
+		if(!(other.collisionFlags & btCollisionObject::CF_CHARACTER_OBJECT) || _overlapCount == 0)
+		{
+			return;
+		}
+
+		if(--_overlapCount == 0)
+		{
+			_triggered = false;
+			_triggerInZone = false;
+		}
+	}
+
 	//============================
 	//EntityTrigger, derived from TriggerZone
 	//============================
@@ -158,12 +375,24 @@ namespace LevelData
 	}
 	void EntityTrigger::update(OgreTransform& playerTransform,int deltaTimeInMs)
 	{
+		if(_volume)
+		{
+			//entering is handled by onTriggerEnter, only scripted activation is left.
+			if(_activated)
+			{
+				callScriptFunction();
+				_triggerInZone = true;
+				_activated = false;
+			}
+			return;
+		}
+
 		_triggered = check(_targetNode->getPosition());
 
 		if((_triggered && !_triggerInZone) || _activated)
 		{
 			//call the callback
-			LuaManager::getSingleton().callFunction(_scriptName);
+			callScriptFunction();
 			//handle return values from lua
 
 			//most scripts will be activating other entities.
@@ -198,6 +427,41 @@ namespace LevelData
 		_boundaries = zoneBoundaries;
 	}
 
+	void EntityTrigger::createVolume(PhysicsManager* physics)
+	{
+		_createBoxVolume(physics,_boundaries,this,btBroadphaseProxy::DefaultFilter | btBroadphaseProxy::KinematicFilter);
+	}
+
+	void EntityTrigger::onTriggerEnter(const TriggerOverlap& other)
+	{
+		//rigid bodies carry their scene node as user pointer, no name lookups needed.
+		if(_targetNode == nullptr || other.userPointer != _targetNode)
+		{
+			return;
+		}
+
+		if(_overlapCount++ == 0)
+		{
+			_triggered = true;
+			_triggerInZone = true;
+			callScriptFunction();
+		}
+	}
+
+	void EntityTrigger::onTriggerExit(const TriggerOverlap& other)
+	{
+		if(other.userPointer != _targetNode || _overlapCount == 0)
+		{
+			return;
+		}
+
+		if(--_overlapCount == 0)
+		{
+			_triggered = false;
+			_triggerInZone = false;
+		}
+	}
+
 	//===============================
 	//TimeTrigger, derived from TriggerZone
 	//===============================
@@ -228,7 +492,7 @@ namespace LevelData
 		if(_triggered)
 		{
 			//call the callback
-			LuaManager::getSingleton().callFunction(_scriptName);
+			callScriptFunction();
 			//handle lua return values
 
 			//these are one-time triggers, unless manually reset
@@ -266,7 +530,7 @@ namespace LevelData
 			3 integers for diffuse color
 			3 integers for specular color
 			*/
-			LuaManager::getSingleton().callFunction(0,7);
+			callScriptFunction(7);
 			int d1 = 0,d2 = 0,d3 = 0;
 			int s1 = 0,s2 = 0,s3 = 0;
 			bool vis = true;
@@ -462,6 +726,12 @@ namespace LevelData
 		btVector3 pos = Utility::convert_OgreVector3(_position);
 		trans.setOrigin(pos);
 		_door.btBody->setWorldTransform(trans);
+		_door.btBody->setInterpolationWorldTransform(trans);
+		//the motion state still has the spawn pose, it would interpolate the node from there.
+		OgreMotionState* motionState = static_cast<OgreMotionState*>(_door.btBody->getMotionState());
+		motionState->setWorldTransform(trans);
+		motionState->saveState();
+		motionState->interpolate(1);
 
 		//assumes levelPair is valid pointer
 		_door.btBody->setActivationState(DISABLE_DEACTIVATION);
@@ -585,7 +855,7 @@ namespace LevelData
 		//check for activation and act upon it
 		if(_activated)
 		{
-			LuaManager::getSingleton().callFunction(_scriptName,5);
+			callScriptFunction(5);
 			//handle lua return values
 			bool motor = false;
 			float motorTop = 0.0f;
@@ -629,7 +899,7 @@ namespace LevelData
 			//act on return values
 			if(nScript != "NULL" && nScript != "" && nScript != "nil" && nScript != "null")
 			{
-				_scriptName = nScript;
+				setScriptFunction(nScript);
 			}
 			if(ent != "NULL" && ent != "" && ent != "nil" && ent != "null")
 			{
@@ -642,6 +912,53 @@ namespace LevelData
 			}
 			
 		}
+
+		//swinging moves the door's center, keeps it findable by the spatial queries.
+		LuaManager::getSingleton().updateEntityPosition(_handle,_door.ogreNode->_getDerivedPosition());
+	}
+
+	void DoorData::updateNavObstacle(DetourInterface* detour)
+	{
+		if(detour == nullptr || !detour->hasTileCache())
+		{
+			return;
+		}
+
+		//the tile cache is full or busy, give it some frames instead of asking(and failing) every frame.
+		if(_navRetryDelay > 0)
+		{
+			--_navRetryDelay;
+			return;
+		}
+
+		Ogre::Vector3 position = _door.ogreNode->_getDerivedPosition();
+		Ogre::Quaternion orientation = _door.ogreNode->_getDerivedOrientation();
+		Ogre::Radian yaw = orientation.getYaw();
+		//wrapped into [-pi,pi), so a door swinging past +-180 degrees doesn't look like a full turn.
+		Ogre::Radian yawDelta = yaw - _navYaw;
+		yawDelta = Ogre::Radian(yawDelta.valueRadians() - Ogre::Math::TWO_PI * floor((yawDelta.valueRadians() + Ogre::Math::PI) / Ogre::Math::TWO_PI));
+		if(_navObstacle != 0 &&
+		   position.squaredDistance(_navPosition) < 0.01f &&
+		   Ogre::Math::Abs(yawDelta) < Ogre::Degree(5))
+		{
+			return;
+		}
+
+		if(_navObstacle != 0)
+		{
+			detour->removeObstacle(_navObstacle);
+		}
+
+		Ogre::AxisAlignedBox box = _door.ogreNode->getAttachedObject(0)->getBoundingBox();
+		Ogre::Vector3 center = _door.ogreNode->_getFullTransform() * box.getCenter();
+		Ogre::Vector3 halfExtents = box.getHalfSize() * _door.ogreNode->_getDerivedScale();
+		_navObstacle = detour->addBoxObstacle(center,halfExtents,yaw);
+		_navPosition = position;
+		_navYaw = yaw;
+		if(_navObstacle == 0)
+		{
+			_navRetryDelay = DOOR_NAV_RETRY_DELAY;
+		}
 	}
 
 	//only some physics properties are changeable after hinge creation.
@@ -651,7 +968,7 @@ namespace LevelData
 
 	void DoorData::setScriptName(const std::string& scriptName)
 	{
-		_scriptName = scriptName;
+		setScriptFunction(scriptName);
 	}
 	std::string DoorData::getScriptName(){ return _scriptName;}
 
@@ -805,472 +1122,400 @@ namespace LevelData
 		_file = fileName;
 	}
 
-	void LevelParser::parseTriggers(std::vector<std::unique_ptr<TriggerZone>>* triggers,Ogre::SceneNode* rootNode)
+	void LevelParser::_error(int line,int column,const std::string& message)
+	{
+		_errors.push_back(ParseError(line,column,message));
+		std::cout << "LevelParser error - " << _file << "(" << line << "," << column << "): " << message << std::endl;
+	}
+
+	bool LevelParser::_readFile(std::vector<char>& buffer)
+	{
+		std::ifstream dataFile(_file.c_str(),std::ios::in | std::ios::binary);
+		if(!dataFile.is_open())
+		{
+			_error(0,0,"could not open file");
+			return false;
+		}
+
+		dataFile.seekg(0,std::ios::end);
+		std::streamoff size = dataFile.tellg();
+		dataFile.seekg(0,std::ios::beg);
+		if(size < 0)
+		{
+			_error(0,0,"could not read file");
+			return false;
+		}
+
+		//null terminated so strtod can never run off the end of the buffer
+		buffer.resize(static_cast<size_t>(size) + 1);
+		if(size > 0)
+		{
+			dataFile.read(&buffer[0],size);
+		}
+		buffer[static_cast<size_t>(size)] = '\0';
+
+		return true;
+	}
+
+	bool LevelParser::parse(std::vector<std::unique_ptr<TriggerZone>>* triggers,
+							std::vector<std::unique_ptr<LightData>>* lights,
+							std::vector<std::unique_ptr<DoorData>>* doors,
+							std::vector<Waypoint>* waypoints,
+							Ogre::SceneNode* rootNode)
 	{
-		std::ifstream dataFile(_file);
-		std::string data;
-		std::string type;
-		std::string substr;
-		std::string dataType;
-		std::string values;
+		LevelDescription level;
+		bool success = parseDescription(&level);
 
-		//corners for boundaries = center (+/-) cornersOffset
-		Ogre::Vector3 center,cornersOffset;
-		std::string script;
-		std::string target;
-		std::string name;
-		int timeDelay = 0;
-		bool contExec = false;
+		//whatever was read correctly is still created.
+		buildEntities(level,triggers,lights,doors,waypoints,rootNode);
 
-		bool startObject = false;
-		bool finishedObject = false;
+		return success;
+	}
 
-		boost::char_separator<char> fieldSeparator(":;");
-		boost::char_separator<char> dataSeparator(",");
+	/*
+	File layout, one statement per line:
+	<type>_<Kind><anything>;   starts a record, Kind is TriggerZone, Light, Door or Waypoint
+	<Field>:<value>;           belongs to the current record
+	};                         ends the current record
+	*/
+	bool LevelParser::parseDescription(LevelDescription* level)
+	{
+		_errors.clear();
 
-		while(!dataFile.eof() && dataFile.good() && dataFile.is_open())
+		std::vector<char> buffer;
+		if(!_readFile(buffer))
 		{
-			std::getline(dataFile,data);
+			return false;
+		}
 
-			if(data == "")
+		RECORD_KIND kind = RK_NONE;
+		int recordLine = 0;
+		TriggerRecord trigger;
+		LightRecord light;
+		DoorRecord door;
+		WaypointRecord waypoint;
+
+		const char* cursor = &buffer[0];
+		const char* fileEnd = cursor + buffer.size() - 1;
+		int lineNumber = 0;
+		while(cursor < fileEnd)
+		{
+			++lineNumber;
+			const char* lineStart = cursor;
+			const char* lineEnd = findChar(cursor,fileEnd,'\n');
+			if(lineEnd == nullptr)
+			{
+				lineEnd = fileEnd;
+			}
+			cursor = lineEnd + 1;
+
+			//trim surrounding whitespace(and the '\r' of windows line endings)
+			const char* b = lineStart;
+			const char* e = lineEnd;
+			while(b < e && isspace(static_cast<unsigned char>(*b))) { ++b; }
+			while(e > b && isspace(static_cast<unsigned char>(e[-1]))) { --e; }
+			if(b == e)
 			{
 				continue;
 			}
 
-			if(!startObject && !finishedObject)
+			const char* colon = findChar(b,e,':');
+			const char* semicolon = findChar(b,e,';');
+			if(colon != nullptr && semicolon != nullptr && semicolon < colon)
 			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if(boost::next(fieldS) == fieldE && (*fieldS).find("TriggerZone") != std::string::npos)
-				{
-					type = data.substr(0,data.find("_"));
-					startObject = true;
-				}
+				colon = nullptr;
 			}
 
-			if(startObject)
+			TextSpan key(b,colon ? colon : (semicolon ? semicolon : e));
+			TextSpan value;
+			int valueColumn = 0;
+			if(colon)
 			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if( *fieldS == "Position" )
-				{
-					values = *(boost::next(fieldS));
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					getVector3FromTknItr(center,dataS,dataE);
-				}
-				if( *fieldS == "ZoneScale" )
-				{
-					values = *(boost::next(fieldS));
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					getVector3FromTknItr(cornersOffset,dataS,dataE);
-				}
-				if( *fieldS == "TargetName" )
-				{
-					target = *boost::next(fieldS);
-				}
-				if( *fieldS == "TimeDelay" )
-				{
-					timeDelay = boost::lexical_cast<int,std::string>(*boost::next(fieldS));
-				}
-				if( *fieldS == "Callback" )
-				{
-					script = *boost::next(fieldS);
-				}
-				if( *fieldS == "ContExec" )
-				{
-					contExec = boost::lexical_cast<bool,std::string>(*boost::next(fieldS));
-				}
-				if( *fieldS == "}")
-				{
-					startObject = false;
-					finishedObject = true;
-				}
+				const char* valueEnd = findChar(colon + 1,e,';');
+				value = TextSpan(colon + 1,valueEnd ? valueEnd : e);
+				valueColumn = static_cast<int>(value.begin - lineStart) + 1;
 			}
+			int column = static_cast<int>(b - lineStart) + 1;
 
-			if(finishedObject)
+			//end of the current record
+			if(*b == '}')
 			{
-				std::unique_ptr<TriggerZone> tZone;
-				Ogre::AxisAlignedBox boundaries(center - cornersOffset,center + cornersOffset);
-				if(type == "plr")
+				switch(kind)
 				{
-					//PlayerTrigger* playerTrig = new PlayerTrigger();
-					PlayerTrigger* playerTrig = new PlayerTrigger(script,boundaries,false);
-					//playerTrig->setBoundaries(boundaries);
-					//playerTrig->setTriggerType(PLAYER);
-					//playerTrig->setScriptFunction(script);
-					//playerTrig->activate(false);
-					tZone.reset(playerTrig);
+				case RK_TRIGGER:
+					if(trigger.triggerType != 0) { level->triggers.push_back(trigger); }
+					break;
+				case RK_LIGHT:
+					if(light.lightType != -1) { level->lights.push_back(light); }
+					break;
+				case RK_DOOR:
+					level->doors.push_back(door);
+					break;
+				case RK_WAYPOINT:
+					level->waypoints.push_back(waypoint);
+					break;
+				default:
+					break;
 				}
+				kind = RK_NONE;
+				continue;
+			}
 
-				if(type == "ent")
+			//start of a new record
+			if(colon == nullptr)
+			{
+				RECORD_KIND newKind = RK_NONE;
+				if(key.contains("TriggerZone")) { newKind = RK_TRIGGER; }
+				else if(key.contains("Light")) { newKind = RK_LIGHT; }
+				else if(key.contains("Door")) { newKind = RK_DOOR; }
+				else if(key.contains("Waypoint")) { newKind = RK_WAYPOINT; }
+
+				//anything else('{', unknown records) is skipped.
+				if(newKind == RK_NONE)
 				{
-					//EntityTrigger* entTrig = new EntityTrigger();
-					EntityTrigger* entTrig = new EntityTrigger(script,target,boundaries,rootNode,false);
-					//entTrig->setBoundaries(boundaries);
-					//entTrig->setTriggerTarget(target);
-					//entTrig->setScriptFunction(script);
-					//entTrig->setTriggerType(ENTITY);
-					//entTrig->activate(false);
-					tZone.reset(entTrig);
+					continue;
 				}
 
-				if(type == "time")
+				if(kind != RK_NONE)
 				{
-					//TimeTrigger* timeTrig = new TimeTrigger();
-					TimeTrigger* timeTrig = new TimeTrigger(script,timeDelay,false);
-					//timeTrig->setTimeDelay(timeDelay);
-					//timeTrig->setTriggerType(TIME);
-					//timeTrig->setScriptFunction(script);
-					//timeTrig->activate(false);
-					tZone.reset(timeTrig);
+					_error(recordLine,1,"record is missing its closing '};'");
 				}
 
-				if(type == "global")
+				const char* underscore = findChar(key.begin,key.end,'_');
+				TextSpan prefix(key.begin,underscore ? underscore : key.end);
+
+				kind = newKind;
+				recordLine = lineNumber;
+				switch(kind)
 				{
-					//GlobalTrigger* globTrig = new GlobalTrigger();
-					GlobalTrigger* globTrig = new GlobalTrigger(script,true,false);
-					//globTrig->setContinuousExecution(true);
-					//globTrig->setTriggerType(GLOBAL);
-					//globTrig->setScriptFunction(script);
-					//globTrig->activate(false);
-					tZone.reset(globTrig);
+				case RK_TRIGGER:
+					trigger = TriggerRecord();
+					if(prefix.equals("plr")) { trigger.triggerType = PLAYER; }
+					else if(prefix.equals("ent")) { trigger.triggerType = ENTITY; }
+					else if(prefix.equals("time")) { trigger.triggerType = TIME; }
+					else if(prefix.equals("global")) { trigger.triggerType = GLOBAL; }
+					else { _error(lineNumber,column,"unknown trigger type '" + prefix.str() + "'"); }
+					break;
+				case RK_LIGHT:
+					light = LightRecord();
+					if(prefix.equals("spot")) { light.lightType = Ogre::Light::LT_SPOTLIGHT; }
+					else if(prefix.equals("point")) { light.lightType = Ogre::Light::LT_POINT; }
+					else if(prefix.equals("directional")) { light.lightType = Ogre::Light::LT_DIRECTIONAL; }
+					else { _error(lineNumber,column,"unknown light type '" + prefix.str() + "'"); }
+					break;
+				case RK_DOOR:
+					door = DoorRecord();
+					break;
+				case RK_WAYPOINT:
+					waypoint = WaypointRecord();
+					break;
+				default:
+					break;
 				}
-
-				triggers->push_back(std::move(tZone));
-				finishedObject = false;
+				continue;
 			}
-		}
-	}
 
-	void LevelParser::parseLights(std::vector<std::unique_ptr<LightData>>* lights)
-	{
-		std::ifstream dataFile(_file);
-		std::string data;
-		std::string type;
-		std::string substr;
-		std::string dataType;
-		std::string values;
+			//field of the current record, fields outside of a record are ignored.
+			bool valid = true;
+			switch(kind)
+			{
+			case RK_TRIGGER:
+				if(key.equals("Position")) { valid = readVector3(value,trigger.center); }
+				else if(key.equals("ZoneScale")) { valid = readVector3(value,trigger.cornersOffset); }
+				else if(key.equals("TargetName")) { trigger.target = value.str(); }
+				else if(key.equals("TimeDelay")) { valid = readInt(value,trigger.timeDelay); }
+				else if(key.equals("Callback")) { trigger.script = value.str(); }
+				else if(key.equals("ContExec")) { valid = readBool(value,trigger.contExec); }
+				break;
+			case RK_LIGHT:
+				if(key.equals("Position")) { valid = readVector3(value,light.position); }
+				else if(key.equals("Direction")) { valid = readVector3(value,light.direction); }
+				else if(key.equals("InnerAng")) { valid = readFloat(value,light.innerAng); }
+				else if(key.equals("OuterAng")) { valid = readFloat(value,light.outerAng); }
+				else if(key.equals("Range")) { valid = readInt(value,light.range); }
+				else if(key.equals("Color")) { valid = readColour(value,light.diffColour); }
+				else if(key.equals("SpecColor")) { valid = readColour(value,light.specColour); }
+				break;
+			case RK_DOOR:
+				if(key.equals("Position")) { valid = readVector3(value,door.position); }
+				else if(key.equals("Direction")) { valid = readVector3(value,door.direction); }
+				else if(key.equals("MinAngle")) { valid = readFloat(value,door.minAng); }
+				else if(key.equals("MaxAngle")) { valid = readFloat(value,door.maxAng); }
+				else if(key.equals("Name")) { door.name = value.str(); }
+				else if(key.equals("BaseName")) { door.baseName = value.str(); }
+				else if(key.equals("Script")) { door.scriptName = value.str(); }
+				else if(key.equals("DoorObject")) { door.doorFileName = value.str(); }
+				else if(key.equals("Axis")) { valid = readVector3(value,door.axis); }
+				else if(key.equals("DoorConnectionPoint")) { valid = readVector3(value,door.connectionPoint); }
+				break;
+			case RK_WAYPOINT:
+				if(key.equals("Position")) { valid = readVector3(value,waypoint.position); }
+				else if(key.equals("Order")) { valid = readInt(value,waypoint.order); }
+				break;
+			default:
+				break;
+			}
 
-		Ogre::Vector3 position,direction;
-		int range = 0;
-		Ogre::ColourValue diffColour;
-		Ogre::ColourValue specColour;
-		float innerAng = 0.0f,outerAng = 0.0f;
+			if(!valid)
+			{
+				_error(lineNumber,valueColumn,"malformed value '" + value.str() + "' for field '" + key.str() + "'");
+			}
+		}
 
-		bool startObject = false;
-		bool finishedObject = false;
+		if(kind != RK_NONE)
+		{
+			_error(recordLine,1,"record is missing its closing '};'");
+		}
 
-		boost::char_separator<char> fieldSeparator(":;");
-		boost::char_separator<char> dataSeparator(",");
+		return _errors.empty();
+	}
 
-		while(!dataFile.eof() && dataFile.good() && dataFile.is_open())
+	void LevelParser::buildEntities(const LevelDescription& level,
+									std::vector<std::unique_ptr<TriggerZone>>* triggers,
+									std::vector<std::unique_ptr<LightData>>* lights,
+									std::vector<std::unique_ptr<DoorData>>* doors,
+									std::vector<Waypoint>* waypoints,
+									Ogre::SceneNode* rootNode)
+	{
+		if(triggers)
 		{
-			std::getline(dataFile,data);
-			
-			if(data == "") { continue; }
-
-			if(!startObject && !finishedObject)
+			triggers->reserve(triggers->size() + level.triggers.size());
+			for(auto itr = level.triggers.begin(); itr != level.triggers.end(); ++itr)
 			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if(boost::next(fieldS) == fieldE && (*fieldS).find("Light") != std::string::npos)
+				const TriggerRecord& rec = *itr;
+				std::unique_ptr<TriggerZone> tZone;
+				//corners for boundaries = center (+/-) cornersOffset
+				Ogre::AxisAlignedBox boundaries(rec.center - rec.cornersOffset,rec.center + rec.cornersOffset);
+				std::string target = rec.target;
+				switch(rec.triggerType)
 				{
-					type = data.substr(0,data.find("_"));
-					startObject = true;
+				case PLAYER:
+					tZone.reset(new PlayerTrigger(rec.script,boundaries,false));
+					break;
+				case ENTITY:
+					if(rootNode == nullptr)
+					{
+						std::cout << "LevelParser - entity trigger '" << rec.script << "' skipped, no root node given." << std::endl;
+						continue;
+					}
+					tZone.reset(new EntityTrigger(rec.script,target,boundaries,rootNode,false));
+					break;
+				case TIME:
+					tZone.reset(new TimeTrigger(rec.script,rec.timeDelay,false));
+					break;
+				case GLOBAL:
+					tZone.reset(new GlobalTrigger(rec.script,true,false));
+					break;
+				default:
+					continue;
 				}
-			}
 
-			if(startObject)
-			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if( *fieldS == "Position" )
-				{
-					values = *boost::next(fieldS);
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					getVector3FromTknItr(position,dataS,dataE);
-				}
-				if( *fieldS == "Direction" )
-				{
-					values = *boost::next(fieldS);
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrStart(values,dataSeparator);
-					getVector3FromTknItr(direction,dataS,dataE);
-				}
-				if( *fieldS == "InnerAng" )
-				{
-					innerAng = boost::lexical_cast<float,std::string>(*boost::next(fieldS));
-				}
-				if( *fieldS == "OuterAng" )
-				{
-					outerAng = boost::lexical_cast<float,std::string>(*boost::next(fieldS));
-				}
-				if( *fieldS == "Range" )
-				{
-					range = boost::lexical_cast<int,std::string>(*boost::next(fieldS));
-				}
-				if( *fieldS == "Color" )
-				{
-					values = *boost::next(fieldS);
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					Ogre::Vector3 t;
-					getVector3FromTknItr(t,dataS,dataE);
-					diffColour.r = t.x;
-					diffColour.g = t.y;
-					diffColour.b = t.z;
-				}
-				if( *fieldS == "SpecColor" )
-				{
-					values = *boost::next(fieldS);
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					Ogre::Vector3 t;
-					getVector3FromTknItr(t,dataS,dataE);
-					specColour.r = t.x;
-					specColour.g = t.y;
-					specColour.b = t.z;
-				}
-				if( *fieldS == "}" )
-				{
-					finishedObject = true;
-					startObject = false;
-				}
+				triggers->push_back(std::move(tZone));
 			}
+		}
 
-			if(finishedObject)
+		if(lights)
+		{
+			lights->reserve(lights->size() + level.lights.size());
+			for(auto itr = level.lights.begin(); itr != level.lights.end(); ++itr)
 			{
+				const LightRecord& rec = *itr;
 				std::unique_ptr<LightData> lData;
-				if(type == "spot" && finishedObject)
+				switch(rec.lightType)
 				{
-					SpotLightData* sLight = new SpotLightData();
-					sLight->setLightType(Ogre::Light::LT_SPOTLIGHT);
-					sLight->setDirection(direction);
-					sLight->setDiffuseColour(diffColour);
-					sLight->setSpecularColour(specColour);
-					sLight->setAngles(innerAng,outerAng);
-					sLight->setRange(static_cast<float>(range));
-					sLight->setPosition(position);
-					lData.reset(sLight);
-				}
-
-				if(type == "point" && finishedObject)
-				{
-					PointLightData* pLight = new PointLightData();
-					pLight->setLightType(Ogre::Light::LT_POINT);
-					pLight->setDiffuseColour(diffColour);
-					pLight->setSpecularColour(specColour);
-					pLight->setRange(static_cast<float>(range));
-					pLight->setPosition(position);
-					lData.reset(pLight);
-				}
-
-				if(type == "directional" && finishedObject)
-				{
-					DirectionalLightData* dLight = new DirectionalLightData();
-					dLight->setLightType(Ogre::Light::LT_DIRECTIONAL);
-					dLight->setDirection(direction);
-					dLight->setDiffuseColour(diffColour);
-					dLight->setSpecularColour(specColour);
-					lData.reset(dLight);
+				case Ogre::Light::LT_SPOTLIGHT:
+					{
+						SpotLightData* sLight = new SpotLightData();
+						sLight->setLightType(Ogre::Light::LT_SPOTLIGHT);
+						sLight->setDirection(rec.direction);
+						sLight->setDiffuseColour(rec.diffColour);
+						sLight->setSpecularColour(rec.specColour);
+						sLight->setAngles(rec.innerAng,rec.outerAng);
+						sLight->setRange(static_cast<float>(rec.range));
+						sLight->setPosition(rec.position);
+						lData.reset(sLight);
+					}
+					break;
+				case Ogre::Light::LT_POINT:
+					{
+						PointLightData* pLight = new PointLightData();
+						pLight->setLightType(Ogre::Light::LT_POINT);
+						pLight->setDiffuseColour(rec.diffColour);
+						pLight->setSpecularColour(rec.specColour);
+						pLight->setRange(static_cast<float>(rec.range));
+						pLight->setPosition(rec.position);
+						lData.reset(pLight);
+					}
+					break;
+				case Ogre::Light::LT_DIRECTIONAL:
+					{
+						DirectionalLightData* dLight = new DirectionalLightData();
+						dLight->setLightType(Ogre::Light::LT_DIRECTIONAL);
+						dLight->setDirection(rec.direction);
+						dLight->setDiffuseColour(rec.diffColour);
+						dLight->setSpecularColour(rec.specColour);
+						lData.reset(dLight);
+					}
+					break;
+				default:
+					continue;
 				}
 
 				lData->setType(LIGHT);
 				lights->push_back(std::move(lData));
-				finishedObject = false;
 			}
 		}
-	}
-
-	void LevelParser::parseDoors(std::vector<std::unique_ptr<DoorData>>* doors)
-	{
-		std::ifstream dataFile(_file);
-		std::string data;
-		std::string type;
-		std::string substr;
-		std::string dataType;
-		std::string values;
-
-		//different data to be collected
-		Ogre::Vector3 position,direction,connectionPoint,axis;
-		std::string name;
-		std::string doorFileName,scriptName,baseName;
-		float minAng = 0.0f,maxAng = 0.0f;
-
-		bool startObject = false;
-		bool finishedObject = false;
 
-		//go through the file and load data into containers.
-		while(!dataFile.eof() && dataFile.good() && dataFile.is_open())
+		if(doors)
 		{
-			std::getline(dataFile,data);
-
-			if(data == "")
-			{
-				continue;
-			}
-
-			if(!startObject)
+			doors->reserve(doors->size() + level.doors.size());
+			for(auto itr = level.doors.begin(); itr != level.doors.end(); ++itr)
 			{
-				//get the type of the object first(if applicable)
-				type = data.substr(0,data.find(';'));
-				if(type.find("Door") != type.npos)
-				{
-					//data being read-in is a door
-					//get door type, but there aren't any door types
-					//type = type.substr(0,type.find('_'));
-					startObject = true;
-				}
-			}
-
-			if(startObject)
-			{
-				//determine what type of data this is.
-				dataType = data.substr(0,data.find(':'));
-				if(dataType == "Position")
-				{	
-					values = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-					values = Ogre::StringUtil::replaceAll(values,","," ");
-					position = Ogre::StringConverter::parseVector3(values);
-				}
-				if(dataType == "Direction")
-				{
-					values = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-					values = Ogre::StringUtil::replaceAll(values,","," ");
-					direction = Ogre::StringConverter::parseVector3(values);
-				}
-				if(dataType == "MinAngle")
-				{
-					minAng = boost::lexical_cast<float,std::string>(data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1)));
-				}
-				if(dataType == "MaxAngle")
-				{
-					maxAng = boost::lexical_cast<float,std::string>(data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1)));
-				}
-				if(dataType == "Name")
-				{
-					name = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-				}
-				if(dataType == "BaseName")
-				{
-					baseName = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-				}
-				if(dataType == "Script")
-				{
-					scriptName = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-				}
-				if(dataType == "DoorObject")
-				{
-					doorFileName = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-				}
-				if(dataType == "Axis")
-				{
-					values = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-					values = Ogre::StringUtil::replaceAll(values,","," ");
-					axis = Ogre::StringConverter::parseVector3(values);
-				}
-
-				if(dataType == "DoorConnectionPoint")
-				{
-					values = data.substr(data.find(':')+1,data.find(';') - (data.find(':')+1));
-					values = Ogre::StringUtil::replaceAll(values,","," ");
-					connectionPoint = Ogre::StringConverter::parseVector3(values);
-				}
-
-				if(data == "};")
-				{
-					//marks end of door data.
-					startObject = false;
-					finishedObject = true;
-				}
-			}
-
-			if(finishedObject)
-			{	
+				const DoorRecord& rec = *itr;
 				std::unique_ptr<DoorData> dData(new DoorData());
-				dData->setPosition(position);
-				dData->setDirection(direction);
-				dData->setAxis(axis);
-				dData->setObjectFile(doorFileName);
-				dData->setConnectionPoint(connectionPoint);
-				dData->setMaxAngle(maxAng);
-				dData->setMinAngle(minAng);
-				dData->setName(name);
-				dData->setScriptName(scriptName);
+				dData->setPosition(rec.position);
+				dData->setDirection(rec.direction);
+				dData->setAxis(rec.axis);
+				dData->setObjectFile(rec.doorFileName);
+				dData->setConnectionPoint(rec.connectionPoint);
+				dData->setMaxAngle(rec.maxAng);
+				dData->setMinAngle(rec.minAng);
+				dData->setName(rec.name);
+				dData->setScriptName(rec.scriptName);
 				doors->push_back(std::move(dData));
-				finishedObject = false;
 			}
 		}
-	} //end of LevelParser::parseDoors()
-
-	void LevelParser::parseWaypoints(std::vector<Waypoint>* waypoints)
-	{
-		std::ifstream dataFile(_file);
-		std::string data,type,dataType,values;
-
-		Ogre::Vector3 position;
-		int order = 0;
 
-		bool startObject = false;
-		bool finishedObject = false;
-
-		boost::char_separator<char> fieldSeparator(":;");
-		boost::char_separator<char> dataSeparator(",");
-
-		while(!dataFile.eof() && dataFile.good() && dataFile.is_open())
+		if(waypoints)
 		{
-			std::getline(dataFile,data);
-
-			if(data == "")
-			{
-				continue;
-			}
-
-			if(!startObject)
-			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if(boost::next(fieldS) == fieldE && (*fieldS).find("Waypoint") != std::string::npos)
-				{
-					type = data.substr(0,data.find("_"));
-					startObject = true;
-				}
-			}
-
-			if(startObject)
-			{
-				TknItr_Str fieldS = getTknItrStart(data,fieldSeparator);
-				TknItr_Str fieldE = getTknItrEnd(data,fieldSeparator);
-				if(*fieldS == "Position")
-				{
-					values = *boost::next(fieldS);
-					TknItr_Str dataS = getTknItrStart(values,dataSeparator);
-					TknItr_Str dataE = getTknItrEnd(values,dataSeparator);
-					getVector3FromTknItr(position,dataS,dataE);
-				}
-				if(*fieldS == "Order")
-				{
-					order = boost::lexical_cast<int,std::string>(*boost::next(fieldS));
-				}
-				if(*fieldS == "}")
-				{
-					finishedObject = true;
-					startObject = false;
-				}
-			}
-
-			if(finishedObject)
+			waypoints->reserve(waypoints->size() + level.waypoints.size());
+			for(auto itr = level.waypoints.begin(); itr != level.waypoints.end(); ++itr)
 			{
 				Waypoint way;
-				way.setPosition(position);
-				way.setOrder(order);
+				way.setPosition(itr->position);
+				way.setOrder(itr->order);
 				waypoints->push_back(way);
-				finishedObject = false;
-				startObject = false;
 			}
 		}
 	}
+
+	void LevelParser::parseTriggers(std::vector<std::unique_ptr<TriggerZone>>* triggers,Ogre::SceneNode* rootNode)
+	{
+		parse(triggers,nullptr,nullptr,nullptr,rootNode);
+	}
+
+	void LevelParser::parseLights(std::vector<std::unique_ptr<LightData>>* lights)
+	{
+		parse(nullptr,lights,nullptr,nullptr,nullptr);
+	}
+
+	void LevelParser::parseDoors(std::vector<std::unique_ptr<DoorData>>* doors)
+	{
+		parse(nullptr,nullptr,doors,nullptr,nullptr);
+	}
+
+	void LevelParser::parseWaypoints(std::vector<Waypoint>* waypoints)
+	{
+		parse(nullptr,nullptr,nullptr,waypoints,nullptr);
+	}
 };
\ No newline at end of file
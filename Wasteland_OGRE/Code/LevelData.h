@@ -5,9 +5,18 @@
 
 #include "GameManager.h"
 
+class DetourInterface;
+
+//updates a door waits before adding its navmesh obstacle again after a failed add.
+#define DOOR_NAV_RETRY_DELAY 30
+
 //System to hold data for current level such as triggerzones and light positions.
 namespace LevelData
 {
+	//Index into LuaManager's entity table(low 16 bits, plus one) and the generation of that slot(high 16 bits).
+	typedef Ogre::uint32 EntityHandle;
+	const EntityHandle INVALID_ENTITY_HANDLE = 0;
+
 	enum ENTITY_TYPE
 	{
 		NONE = 0,
@@ -22,7 +31,9 @@ namespace LevelData
 	class BaseEntity
 	{
 	public:
-		BaseEntity(bool active,int type) : _activated(active),_type(type) {}
+		BaseEntity(bool active,int type) : _type(type),_activated(active),_scriptRef(0),_scriptRefGeneration(0),_handle(INVALID_ENTITY_HANDLE) {}
+		//Takes the entity out of the LuaManager, so handles to it resolve to null.
+		~BaseEntity();
 
 		void setType(int entType);
 		int getType();
@@ -33,12 +44,30 @@ namespace LevelData
 		void setScriptFunction(const std::string& scriptFunc);
 		std::string getScriptFunction();
 
+		//Pushes the script function onto the Lua stack, returns false(and pushes nothing) if there isn't one.
+		//The function is looked up once and then called through a registry reference.
+		bool pushScriptFunction();
+		//Calls the script function without arguments, the return values are left on the stack.
+		bool callScriptFunction(int expectedNumReturn = 0);
+		//Looks the script function up again on the next call.
+		void rebindScriptFunction() { _scriptRefGeneration = 0; }
+
 		void activate(bool active);
+
+		//Set by LuaManager::addEntity.
+		void setHandle(EntityHandle handle) { _handle = handle; }
+		EntityHandle getHandle() { return _handle; }
 	protected:
 		int _type;
 		bool _activated;
 		std::string _name;
 		std::string _scriptName;
+
+		//registry reference to the script function, valid while the generation matches LuaManager's.
+		int _scriptRef;
+		unsigned int _scriptRefGeneration;
+
+		EntityHandle _handle;
 	};
 
 	//TRIGGER ZONE STRUCTS/CLASSES/STRUCTS/FUNCTIONS
@@ -57,6 +86,8 @@ namespace LevelData
 			_triggered = false;
 			_triggerType = 0;
 			_triggerInZone = false;
+			_physics = nullptr;
+			_volume = nullptr;
 		}
 		TriggerZone(std::string scriptName,bool activated = false) : BaseEntity(activated,TRIGGERZONE)
 		{
@@ -64,17 +95,29 @@ namespace LevelData
 			_triggered = false;
 			_triggerType = 0;
 			_triggerInZone = false;
+			_physics = nullptr;
+			_volume = nullptr;
 		}
+		virtual ~TriggerZone();
 
 		virtual void update(OgreTransform& playerTransform, int deltaTimeInMs) {}
 
+		//Backs the trigger with a ghost object in the physics world, for the types that have boundaries.
+		//After that, entering/leaving is reported by Bullet's broadphase instead of being checked in update().
+		virtual void createVolume(PhysicsManager* physics) {}
+
 		void setTriggerType(TRIGGER_TYPE type);
 		int getTriggerType();
 
 	protected:
+		void _createBoxVolume(PhysicsManager* physics,const Ogre::AxisAlignedBox& boundaries,TriggerListener* listener,short mask);
+
 		bool _triggered;
 		bool _triggerInZone;
 		int _triggerType;
+
+		PhysicsManager* _physics;
+		btGhostObject* _volume;
 	};
 
 	class GlobalTrigger : public TriggerZone
@@ -94,30 +137,38 @@ namespace LevelData
 		bool _continuousExecution;
 	};
 
-	class PlayerTrigger : public TriggerZone
+	class PlayerTrigger : public TriggerZone, public TriggerListener
 	{
 	public:
-		PlayerTrigger() {}
+		PlayerTrigger() : _overlapCount(0) {}
 		PlayerTrigger(std::string scriptName, Ogre::AxisAlignedBox boundaries,bool activated = false)
 			: TriggerZone(scriptName,activated),
-			  _boundaries(boundaries)
+			  _boundaries(boundaries),
+			  _overlapCount(0)
 		{ _triggerType = PLAYER; }
 
 		virtual void update(OgreTransform& playerTransform, int deltaTimeInMs);
 		bool check(const OgreTransform& playerTrans);
 
 		void setBoundaries(const Ogre::AxisAlignedBox& zoneBoundaries);
+
+		virtual void createVolume(PhysicsManager* physics);
+		virtual void onTriggerEnter(const TriggerOverlap& other);
+		virtual void onTriggerExit(const TriggerOverlap& other);
 	private:
 		Ogre::AxisAlignedBox  _boundaries;
+		int _overlapCount;
 	};
 
-	class EntityTrigger : public TriggerZone
+	class EntityTrigger : public TriggerZone, public TriggerListener
 	{
 	public:
-		EntityTrigger() {}
+		EntityTrigger() : _targetNode(nullptr),_overlapCount(0) {}
 		EntityTrigger(std::string scriptName,std::string& targetName, Ogre::AxisAlignedBox boundaries,Ogre::SceneNode* rootNode, bool activated = false)
 			: TriggerZone(scriptName,activated),
-			  _target(targetName)
+			  _target(targetName),
+			  _boundaries(boundaries),
+			  _overlapCount(0)
 		{
 			setTriggerTargetNode(rootNode);
 			_triggerType = ENTITY;
@@ -131,10 +182,16 @@ namespace LevelData
 		bool check(const Ogre::Vector3& position);
 
 		void setBoundaries(const Ogre::AxisAlignedBox& zoneBoundaries);
+
+		//Only targets with a rigid body(made through PhysicsManager::addRigidBody) can be seen by the volume.
+		virtual void createVolume(PhysicsManager* physics);
+		virtual void onTriggerEnter(const TriggerOverlap& other);
+		virtual void onTriggerExit(const TriggerOverlap& other);
 	private:
 		std::string _target;
 		Ogre::SceneNode* _targetNode;
 		Ogre::AxisAlignedBox  _boundaries;
+		int _overlapCount;
 	};
 
 	class TimeTrigger : public TriggerZone
@@ -234,12 +291,17 @@ namespace LevelData
 	class DoorData : public BaseEntity
 	{
 	public:
-		DoorData() : BaseEntity(false,DOOR),_hinge(nullptr) {}
+		DoorData() : BaseEntity(false,DOOR),_hinge(nullptr),_navObstacle(0),_navRetryDelay(0) {}
 
 		void createDoor(Ogre::SceneManager* scene,GraphicsManager* g,PhysicsManager* p,OgreBulletPair* staticLevel);
 
 		void update();
 
+		//Keeps the door's navmesh obstacle where the door is. Only moves it once the door has moved or
+		//turned far enough, since every move has the touched navmesh tiles rebuilt.
+		//Does nothing if the navmesh has no tile cache.
+		void updateNavObstacle(DetourInterface* detour);
+
 		void setScriptName(const std::string& scriptName);
 		std::string getScriptName();
 
@@ -274,6 +336,14 @@ namespace LevelData
 
 		btHingeConstraint* _hinge;
 		OgreBulletPair _door;
+
+		//DetourInterface::ObstacleID, 0 if there's none.
+		unsigned int _navObstacle;
+		//where the door was when the obstacle was placed.
+		Ogre::Vector3 _navPosition;
+		Ogre::Radian _navYaw;
+		//updates to skip before trying again after the obstacle couldn't be added.
+		int _navRetryDelay;
 	};
 
 	//WAYPOINT CLASSES/ENUMS/STRUCTS/ETC
@@ -328,13 +398,97 @@ namespace LevelData
 		int _currentWaypoint;
 	};
 
+	//LEVEL DESCRIPTION RECORDS
+	//Plain data read from a level file, before any entity is created from it.
+	struct TriggerRecord
+	{
+		TriggerRecord() : triggerType(0),center(Ogre::Vector3::ZERO),cornersOffset(Ogre::Vector3::ZERO),timeDelay(0),contExec(false) {}
+		int triggerType;
+		Ogre::Vector3 center,cornersOffset;
+		std::string script;
+		std::string target;
+		int timeDelay;
+		bool contExec;
+	};
+
+	struct LightRecord
+	{
+		LightRecord() : lightType(-1),position(Ogre::Vector3::ZERO),direction(Ogre::Vector3::ZERO),range(0),innerAng(0.0f),outerAng(0.0f) {}
+		int lightType;
+		Ogre::Vector3 position,direction;
+		int range;
+		Ogre::ColourValue diffColour;
+		Ogre::ColourValue specColour;
+		float innerAng,outerAng;
+	};
+
+	struct DoorRecord
+	{
+		DoorRecord() : position(Ogre::Vector3::ZERO),direction(Ogre::Vector3::ZERO),connectionPoint(Ogre::Vector3::ZERO),axis(Ogre::Vector3::ZERO),minAng(0.0f),maxAng(0.0f) {}
+		Ogre::Vector3 position,direction,connectionPoint,axis;
+		std::string name;
+		std::string baseName;
+		std::string doorFileName;
+		std::string scriptName;
+		float minAng,maxAng;
+	};
+
+	struct WaypointRecord
+	{
+		WaypointRecord() : position(Ogre::Vector3::ZERO),order(0) {}
+		Ogre::Vector3 position;
+		int order;
+	};
+
+	//Everything a level file describes, sorted by entity type.
+	struct LevelDescription
+	{
+		std::vector<TriggerRecord> triggers;
+		std::vector<LightRecord> lights;
+		std::vector<DoorRecord> doors;
+		std::vector<WaypointRecord> waypoints;
+
+		void clear() { triggers.clear(); lights.clear(); doors.clear(); waypoints.clear(); }
+	};
+
+	//A problem found while reading a level file. Line and column are 1-based.
+	struct ParseError
+	{
+		ParseError(int l,int c,const std::string& msg) : line(l),column(c),message(msg) {}
+		int line;
+		int column;
+		std::string message;
+	};
+
 	//Actual LevelParser.
 	//Used to parse level data contained in file.
+	//The file is read and tokenized exactly once, every record is sorted into its typed output.
 	class LevelParser
 	{
 	public:
 		void setFile(const char* fileName);
 
+		//Reads the whole file in a single pass and creates every entity it describes.
+		//Any output pointer may be null, in which case records of that type are skipped.
+		//Returns false if the file couldn't be read or contained errors(see getErrors()).
+		bool parse(std::vector<std::unique_ptr<TriggerZone>>* triggers,
+				   std::vector<std::unique_ptr<LightData>>* lights,
+				   std::vector<std::unique_ptr<DoorData>>* doors,
+				   std::vector<Waypoint>* waypoints,
+				   Ogre::SceneNode* rootNode);
+
+		//Reads the whole file in a single pass into plain records, no entities are created.
+		bool parseDescription(LevelDescription* level);
+
+		//Creates the entities described by level.
+		static void buildEntities(const LevelDescription& level,
+								  std::vector<std::unique_ptr<TriggerZone>>* triggers,
+								  std::vector<std::unique_ptr<LightData>>* lights,
+								  std::vector<std::unique_ptr<DoorData>>* doors,
+								  std::vector<Waypoint>* waypoints,
+								  Ogre::SceneNode* rootNode);
+
+		//Single-type conveniences, each one still only reads the file once.
 		void parseTriggers(std::vector<std::unique_ptr<TriggerZone>>* triggers,Ogre::SceneNode* rootNode);
 
 		void parseLights(std::vector<std::unique_ptr<LightData>>* lights);
@@ -342,8 +496,14 @@ namespace LevelData
 		void parseDoors(std::vector<std::unique_ptr<DoorData>>* doors);
 
 		void parseWaypoints(std::vector<Waypoint>* waypoints);
+
+		const std::vector<ParseError>& getErrors() { return _errors; }
 	private:
+		bool _readFile(std::vector<char>& buffer);
+		void _error(int line,int column,const std::string& message);
+
 		std::string _file;
+		std::vector<ParseError> _errors;
 	};
 };
 
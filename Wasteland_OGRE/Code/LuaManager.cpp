@@ -12,6 +12,11 @@ template<> LuaManager* Ogre::Singleton<LuaManager>::ms_Singleton = 0;
 LuaManager::LuaManager()
 {
 	luaState = nullptr;
+	_functionRefGeneration = 1;
+
+	//id 0 is INVALID_ENTITY_NAME_ID, an empty name that never has an entity.
+	_names.push_back(std::string());
+	_handlesByName.push_back(LevelData::INVALID_ENTITY_HANDLE);
 }
 
 lua_State* LuaManager::getLuaState() { return luaState;}
@@ -19,19 +24,29 @@ lua_State* LuaManager::getLuaState() { return luaState;}
 //Forces explicit setup.
 void LuaManager::Setup(std::string luaListFileName)
 {
+	//references only mean something in the state they were made in.
+	_releaseFunctionRefs();
+
 	luaState = luaL_newstate();
 	luaL_openlibs(luaState);
 	luaL_checkversion(luaState);
+
+	LuaVector::registerType(luaState);
 	
 	//register lua-accessible functions
+	//the member function of the same name would hide it.
+	registerFunction("getEntityHandle",::getEntityHandle);
 	registerFunction("activate",activate);
 	registerFunction("changeEntityName",changeEntityName);
+	registerFunction("setEntityScript",setEntityScript);
 	registerFunction("printDebug",printDebug);
 	registerFunction("distanceCheck",distanceCheck);
 	registerFunction("getPlayerPosition",getPlayerPosition);
 	registerFunction("getEntityPosition",getEntityPosition);
 	registerFunction("getEntityHeadPosition",getEntityHeadPosition);
 	registerFunction("getNearestEntity",getNearestEntity);
+	registerFunction("getEntitiesInRadius",getEntitiesInRadius);
+	registerFunction("getEntitiesInBox",getEntitiesInBox);
 	registerFunction("setIntegerData",setIntegerData);
 	registerFunction("setStringData",setStringData);
 	registerFunction("setBooleanData",setBooleanData);
@@ -101,6 +116,69 @@ void LuaManager::callFunction(int paramNum,int retNum)
 }
 //<- Grouped functions
 
+int LuaManager::getFunctionRef(const std::string& funcName)
+{
+	auto itr = _functionRefs.find(funcName);
+	if(itr != _functionRefs.end())
+	{
+		return itr->second;
+	}
+
+	int ref = LUA_NOREF;
+	lua_getglobal(luaState,funcName.c_str());
+	if(lua_isfunction(luaState,-1))
+	{
+		//pops the function.
+		ref = luaL_ref(luaState,LUA_REGISTRYINDEX);
+	}
+	else
+	{
+		lua_pop(luaState,1);
+		std::cout << "Lua can't find function name! (" << funcName << ")" << std::endl;
+	}
+
+	//misses are kept too, so a missing function is only reported once.
+	_functionRefs[funcName] = ref;
+	return ref;
+}
+
+bool LuaManager::prepFunction(int ref)
+{
+	if(ref == LUA_NOREF || ref == LUA_REFNIL)
+	{
+		return false;
+	}
+
+	lua_rawgeti(luaState,LUA_REGISTRYINDEX,ref);
+	return true;
+}
+
+void LuaManager::rebindFunction(const std::string& funcName)
+{
+	auto itr = _functionRefs.find(funcName);
+	if(itr != _functionRefs.end())
+	{
+		luaL_unref(luaState,LUA_REGISTRYINDEX,itr->second);
+		_functionRefs.erase(itr);
+	}
+
+	getFunctionRef(funcName);
+	++_functionRefGeneration;
+}
+
+void LuaManager::_releaseFunctionRefs()
+{
+	if(luaState != nullptr)
+	{
+		for(auto itr = _functionRefs.begin(); itr != _functionRefs.end(); ++itr)
+		{
+			luaL_unref(luaState,LUA_REGISTRYINDEX,itr->second);
+		}
+	}
+	_functionRefs.clear();
+	++_functionRefGeneration;
+}
+
 void LuaManager::pushFunctionArg(boost::variant<int,double,std::string> arg)
 {
 	argVisitor visit;
@@ -117,18 +195,7 @@ void LuaManager::pushFunctionArg(boost::variant<int,double,std::string> arg)
 
 void LuaManager::pushFunctionArgVector(const Ogre::Vector3& vector)
 {
-	lua_newtable(luaState);
-	int top = lua_gettop(luaState);
-
-	//next two lines in psuedo code: table[1] = vector.x;
-	//the next values would then be like: table[2] = vector.y;
-	for(int i = 0; i < 3; ++i)
-	{
-		lua_pushnumber(luaState,i+1);
-		lua_pushnumber(luaState,vector[i]);
-		lua_settable(luaState,top);
-		
-	}
+	LuaVector::push(luaState,vector);
 }
 
 void LuaManager::_printStack()
@@ -160,37 +227,191 @@ void LuaManager::_printStack()
 
 void LuaManager::pushFunctionArgVector(const btVector3& vector)
 {
-	lua_newtable(luaState);
-	int top = lua_gettop(luaState);
+	LuaVector::push(luaState,Ogre::Vector3(vector.x(),vector.y(),vector.z()));
+}
+
+LevelData::EntityHandle LuaManager::addEntity(const std::string& name,LevelData::BaseEntity* entity)
+{
+	if(entity == nullptr)
+	{
+		return LevelData::INVALID_ENTITY_HANDLE;
+	}
+
+	EntityNameID nameID = _internName(name);
+	if(_handlesByName[nameID] != LevelData::INVALID_ENTITY_HANDLE)
+	{
+		//first one keeps the name, same as before.
+		std::cout << "Error! LuaManager - entity name " << name << " is already in use." << std::endl;
+		return LevelData::INVALID_ENTITY_HANDLE;
+	}
+
+	Ogre::uint32 index;
+	if(!_freeEntitySlots.empty())
+	{
+		index = _freeEntitySlots.back();
+		_freeEntitySlots.pop_back();
+	}
+	else
+	{
+		//handles only have 16 bits for the slot.
+		assert(_entitySlots.size() < 0xFFFF && "Too many entities for the handle format!");
+		if(_entitySlots.size() >= 0xFFFF)
+		{
+			std::cout << "Error! LuaManager - too many entities." << std::endl;
+			return LevelData::INVALID_ENTITY_HANDLE;
+		}
+
+		EntitySlot slot;
+		slot.entity = nullptr;
+		slot.generation = 1;
+		index = static_cast<Ogre::uint32>(_entitySlots.size());
+		_entitySlots.push_back(slot);
+	}
 
-	for(int i = 0; i < 3; ++i)
+	EntitySlot& slot = _entitySlots[index];
+	slot.entity = entity;
+	slot.name = nameID;
+
+	LevelData::EntityHandle handle = (slot.generation << 16) | (index + 1);
+	_handlesByName[nameID] = handle;
+	entity->setHandle(handle);
+
+	//lets ray queries get from the Ogre entity back to this one without going through its name.
+	Ogre::MovableObject* movable = nullptr;
+	if(entity->getType() == LevelData::NPC)
+	{
+		movable = static_cast<NPCCharacter*>(entity)->getMovableObject();
+		_spatialIndex.insert(handle,static_cast<NPCCharacter*>(entity)->getPosition(),LevelData::NPC);
+	}
+	if(entity->getType() == LevelData::ENEMY)
+	{
+		movable = static_cast<EnemyCharacter*>(entity)->getMovableObject();
+		_spatialIndex.insert(handle,static_cast<EnemyCharacter*>(entity)->getPosition(),LevelData::ENEMY);
+	}
+	if(movable != nullptr)
 	{
-		lua_pushnumber(luaState,i+1);
-		lua_pushnumber(luaState,vector.m_floats[i]);
-		lua_settable(luaState,top);
+		movable->setUserAny(Ogre::Any(handle));
 	}
+
+	return handle;
 }
 
-void LuaManager::addEntity(const std::string& name,LevelData::BaseEntity* entity)
+void LuaManager::removeEntity(LevelData::EntityHandle handle)
 {
-	std::pair<std::string,LevelData::BaseEntity*> p;
+	if(getEntity(handle) == nullptr)
+	{
+		return;
+	}
 
-	p.first = name;
-	p.second = entity;
+	Ogre::uint32 index = (handle & 0xFFFF) - 1;
+	EntitySlot& slot = _entitySlots[index];
+	_handlesByName[slot.name] = LevelData::INVALID_ENTITY_HANDLE;
+	_spatialIndex.remove(handle);
+	slot.entity->setHandle(LevelData::INVALID_ENTITY_HANDLE);
+	slot.entity = nullptr;
+	slot.name = INVALID_ENTITY_NAME_ID;
+	//16 bits of generation, 0 is skipped so a handle is never 0.
+	slot.generation = (slot.generation & 0xFFFF) == 0xFFFF ? 1 : slot.generation + 1;
+	_freeEntitySlots.push_back(index);
+}
 
-	_entities.insert(p);
+bool LuaManager::renameEntity(LevelData::EntityHandle handle,const std::string& newName)
+{
+	LevelData::BaseEntity* entity = getEntity(handle);
+	if(entity == nullptr || getEntityHandle(newName) != LevelData::INVALID_ENTITY_HANDLE)
+	{
+		return false;
+	}
 
-	return;
+	//handle stays the same, only the name index changes.
+	EntitySlot& slot = _entitySlots[(handle & 0xFFFF) - 1];
+	EntityNameID nameID = _internName(newName);
+	_handlesByName[slot.name] = LevelData::INVALID_ENTITY_HANDLE;
+	slot.name = nameID;
+	_handlesByName[nameID] = handle;
+	entity->setName(newName);
+
+	return true;
+}
+
+LuaManager::EntityNameID LuaManager::_internName(const std::string& name)
+{
+	auto itr = _nameIDs.find(name);
+	if(itr != _nameIDs.end())
+	{
+		return itr->second;
+	}
+
+	EntityNameID id = static_cast<EntityNameID>(_names.size());
+	_nameIDs[name] = id;
+	_names.push_back(name);
+	_handlesByName.push_back(LevelData::INVALID_ENTITY_HANDLE);
+	return id;
 }
 
 void LuaManager::purgeEntities()
 {
-	_entities.clear();
+	for(Ogre::uint32 i = 0; i < _entitySlots.size(); ++i)
+	{
+		if(_entitySlots[i].entity != nullptr)
+		{
+			removeEntity((_entitySlots[i].generation << 16) | (i + 1));
+		}
+	}
 }
 
 void LuaManager::activateEntity(const std::string& name,bool value)
 {
-	_entities[name]->activate(value);
+	activateEntity(getEntityHandle(name),value);
+}
+
+void LuaManager::activateEntity(LevelData::EntityHandle handle,bool value)
+{
+	LevelData::BaseEntity* entity = getEntity(handle);
+	if(entity != nullptr)
+	{
+		entity->activate(value);
+	}
+}
+
+void LuaManager::updateEntityPosition(LevelData::EntityHandle handle,const Ogre::Vector3& position)
+{
+	LevelData::BaseEntity* entity = getEntity(handle);
+	if(entity == nullptr)
+	{
+		return;
+	}
+
+	if(_spatialIndex.contains(handle))
+	{
+		_spatialIndex.update(handle,position);
+	}
+	else
+	{
+		_spatialIndex.insert(handle,position,entity->getType());
+	}
+}
+
+int LuaManager::getEntityTypeFromString(const std::string& type)
+{
+	if(type == "NPC") { return LevelData::NPC; }
+	if(type == "Enemy") { return LevelData::ENEMY; }
+	if(type == "Door") { return LevelData::DOOR; }
+	return LevelData::NONE;
+}
+
+LevelData::BaseEntity* LuaManager::getEntityFromLua(lua_State* lua,int index)
+{
+	//checked first, lua_isstring is true for numbers too.
+	if(lua_type(lua,index) == LUA_TNUMBER)
+	{
+		return LuaManager::getSingleton().getEntity(static_cast<LevelData::EntityHandle>(lua_tonumber(lua,index)));
+	}
+	if(lua_isstring(lua,index))
+	{
+		return LuaManager::getSingleton().getEntity(lua_tostring(lua,index));
+	}
+	return nullptr;
 }
 
 void LuaManager::addDataPointer(const std::string& name,void* dataPtr)
@@ -308,16 +529,7 @@ Ogre::Vector3 LuaManager::getVectorFromLuaTable(lua_State* lua,const std::string
 	lua_pushstring(lua,field.c_str());
 	lua_gettable(lua,1);
 	Ogre::Vector3 ret;
-	if(lua_istable(lua,-1))
-	{
-		for(int i = 0; i < 3; ++i)
-		{
-			lua_pushnumber(lua,i+1);
-			lua_gettable(lua,-2);
-			ret[i] = static_cast<float>(lua_tonumber(lua,-1));
-			lua_pop(lua,1);
-		}
-	}
+	LuaVector::get(lua,-1,ret);
 	lua_pop(lua,1);
 
 	return ret;
@@ -384,104 +596,116 @@ void argVisitor::operator()(const double& d)
 
 Ogre::Vector3 LuaManager::getVectorFromLua(lua_State* lua,int tableIndex)
 {
-	if(lua_istable(lua,tableIndex))
+	Ogre::Vector3 ret;
+	if(LuaVector::get(lua,tableIndex,ret))
 	{
-		Ogre::Vector3 ret;
-		for(int i = 1; i < 4; ++i)
-		{
-			lua_pushnumber(lua,i); 
-			lua_gettable(lua,tableIndex);
-			if(lua_isnumber(lua,-1))
-			{
-				ret[i-1] = static_cast<float>(lua_tonumber(lua,-1));
-			}
-			else
-			{
-				ret[i-1] = 0;
-			}
-			lua_pop(lua,1);
-		}
-
 		return ret;
 	}
 	else
 	{
-		std::cout << "Lua Error: Index provided is not a table." << std::endl;
+		std::cout << "Lua Error: Index provided is not a vector." << std::endl;
 		return Ogre::Vector3::ZERO;
 	}
 }
 
 //==============================
 
-// var = activate(entName,value)
+// handle = getEntityHandle(entName), 0 if there's no such entity
+int getEntityHandle(lua_State* lua)
+{
+	LevelData::EntityHandle handle = LevelData::INVALID_ENTITY_HANDLE;
+	if(lua_gettop(lua) == 1 && lua_isstring(lua,1))
+	{
+		handle = LuaManager::getSingleton().getEntityHandle(lua_tostring(lua,1));
+	}
+
+	lua_pushnumber(lua,handle);
+
+	return 1;
+}
+
+// var = activate(entity,value)
 int activate(lua_State* lua)
 {
 	//number of arguments. NOT ZERO-INDEXED
 	int argNum = lua_gettop(lua);
 
-	std::string entName;
+	LevelData::BaseEntity* entity = nullptr;
 	bool value = true;
 
 	if(argNum == 2)
 	{
 		//assume correct argument order
-		if(lua_isstring(lua,1))
-		{
-			entName = lua_tostring(lua,1);
-		}
+		entity = LuaManager::getEntityFromLua(lua,1);
 		if(lua_isnumber(lua,2))
 		{
 			value = (lua_toboolean(lua,2) != 0);
 		}
 	}
 
-	LuaManager::getSingleton().activateEntity(entName,value);
+	if(entity != nullptr)
+	{
+		entity->activate(value);
+	}
 
 	lua_pushboolean(lua,value);
 
 	return 1;
 }
 
-// var = changeEntityName(oldName,newName)
+// var = changeEntityName(entity,newName)
 int changeEntityName(lua_State* lua)
 {
 	int argNum = lua_gettop(lua);
 
-	std::string oldName,newName;
-
-	if(argNum == 2)
+	if(argNum != 2 || !lua_isstring(lua,2))
 	{
-		if(lua_isstring(lua,1))
-		{
-			oldName = lua_tostring(lua,1);
-		}
-		else
-		{
-			lua_pushboolean(lua,0);
-			return 0;
-		}
+		lua_pushboolean(lua,0);
+		return 1;
+	}
 
-		if(lua_isstring(lua,2))
-		{
-			oldName = lua_tostring(lua,2);
-		}
-		else
-		{
-			lua_pushboolean(lua,0);
-			return 0;
-		}
+	LevelData::BaseEntity* entity = LuaManager::getEntityFromLua(lua,1);
+	if(entity == nullptr || !LuaManager::getSingleton().renameEntity(entity->getHandle(),lua_tostring(lua,2)))
+	{
+		lua_pushboolean(lua,0);
+		return 1;
 	}
 
-	LevelData::BaseEntity* entity = LuaManager::getSingleton().getEntity(oldName);
-	LuaManager::getSingleton().removeEntity(oldName);
-	LuaManager::getSingleton().addEntity(newName,entity);
-	entity->setName(newName);
+	//renamed entities may be bound to a function the script only just defined.
+	entity->rebindScriptFunction();
 
 	lua_pushboolean(lua,1);
 
 	return 1;
 }
 
+// var = setEntityScript(entity,functionName)
+int setEntityScript(lua_State* lua)
+{
+	int argNum = lua_gettop(lua);
+
+	if(argNum != 2 || !lua_isstring(lua,2))
+	{
+		lua_pushboolean(lua,0);
+		return 1;
+	}
+
+	LevelData::BaseEntity* entity = LuaManager::getEntityFromLua(lua,1);
+	if(entity == nullptr)
+	{
+		lua_pushboolean(lua,0);
+		return 1;
+	}
+
+	std::string funcName = lua_tostring(lua,2);
+	//the script may have just (re)defined the function, so look it up again.
+	LuaManager::getSingleton().rebindFunction(funcName);
+	entity->setScriptFunction(funcName);
+
+	lua_pushboolean(lua,1);
+	return 1;
+}
+
 // printDebug(...)
 int printDebug(lua_State* lua)
 {
@@ -566,7 +790,7 @@ int distanceCheck(lua_State* lua)
 	return 1;
 }
 
-// var = getPlayerPosition()
+// var = getPlayerPosition([out])
 int getPlayerPosition(lua_State* lua)
 {
 	Ogre::Vector3 pos;
@@ -583,91 +807,68 @@ int getPlayerPosition(lua_State* lua)
 		pos = Ogre::Vector3::ZERO;
 	}
 
-	lua_newtable(lua);
-	int top = lua_gettop(lua);
-
-	for(int i = 0; i < 3; ++i)
-	{
-		lua_pushinteger(lua,i+1);
-		lua_pushnumber(lua,pos[i]);
-		lua_settable(lua,top);
-	}
+	LuaVector::pushResult(lua,1,pos);
 
 	return 1;
 }
 
-// var = getEntityPosition("entityName","entityType")
+// var = getEntityPosition(entity[,"entityType"][,out])
+//the type is only checked against the entity's own, it's optional.
 int getEntityPosition(lua_State* lua)
 {
-	Ogre::Vector3 ret;
+	Ogre::Vector3 ret = Ogre::Vector3::ZERO;
 
-	if(lua_isstring(lua,1) && lua_isstring(lua,2))
+	LevelData::BaseEntity* ent = LuaManager::getEntityFromLua(lua,1);
+	if(ent != nullptr)
 	{
-		std::string entity = lua_tostring(lua,1);
-		LevelData::BaseEntity* ent = LuaManager::getSingleton().getEntity(entity);
-		std::string type = lua_tostring(lua,2);
-		if(type == "NPC")
+		std::string type = lua_isstring(lua,2) ? lua_tostring(lua,2) : "";
+		if(ent->getType() == LevelData::NPC && (type == "" || type == "NPC"))
 		{
 			ret = static_cast<NPCCharacter*>(ent)->getPosition();
 		}
-		if(type == "Enemy")
+		if(ent->getType() == LevelData::ENEMY && (type == "" || type == "Enemy"))
 		{
 			ret = static_cast<EnemyCharacter*>(ent)->getPosition();
 		}
 		//..other types?
 	}
 
-	lua_createtable(lua,3,0);
-	for(int i = 0; i < 3; i++)
-	{
-		lua_pushnumber(lua,ret[i]);
-		lua_rawseti(lua,-2,i);
-	}
+	LuaVector::pushResult(lua,2,ret);
 
 	return 1;
 }
 
-// var = getEntityHeadPosition("entityName","entityType")
+// var = getEntityHeadPosition(entity[,"entityType"][,out])
 int getEntityHeadPosition(lua_State* lua)
 {
-	Ogre::Vector3 ret;
-	if(lua_isstring(lua,1) && lua_isstring(lua,2))
+	Ogre::Vector3 ret = Ogre::Vector3::ZERO;
+	LevelData::BaseEntity* ent = LuaManager::getEntityFromLua(lua,1);
+	if(ent != nullptr)
 	{
-		std::string entity = lua_tostring(lua,1);
-		LevelData::BaseEntity* ent = LuaManager::getSingleton().getEntity(entity);
-		std::string type = lua_tostring(lua,2);
-		if(type == "NPC")
+		std::string type = lua_isstring(lua,2) ? lua_tostring(lua,2) : "";
+		if(ent->getType() == LevelData::NPC && (type == "" || type == "NPC"))
 		{
-			Ogre::Entity* oent = static_cast<Ogre::Entity*>(static_cast<NPCCharacter*>(ent)->getMovableObject());
-			Ogre::Bone* head = oent->getSkeleton()->getBone("Bip01_Head");
-			ret = head->_getDerivedPosition() * oent->getParentNode()->_getDerivedScale().x + oent->getParentNode()->getPosition();
+			ret = static_cast<NPCCharacter*>(ent)->getHeadPosition();
 		}
 
-		if(type == "Enemy")
+		if(ent->getType() == LevelData::ENEMY)
 		{
 			//not yet.
 		}
 	}
 
-	lua_newtable(lua);
-	int top = lua_gettop(lua);
-
-	for(int i = 0; i < 3; i++)
-	{
-		lua_pushinteger(lua,i+1);
-		lua_pushnumber(lua,ret[i]);
-		lua_settable(lua,top);
-	}
+	LuaVector::pushResult(lua,2,ret);
 
 	return 1;
 }
 
-// var = getNearestEntity(position,type)
+// name,handle = getNearestEntity(position,type[,maxDistance])
+//Entities right at position(usually the caller) are skipped.
 int getNearestEntity(lua_State* lua)
 {
 	Ogre::Vector3 position;
 
-	if(lua_istable(lua,1))
+	if(LuaVector::isVector(lua,1))
 	{
 		position = LuaManager::getVectorFromLua(lua,1);
 	}
@@ -676,7 +877,7 @@ int getNearestEntity(lua_State* lua)
 		position = Ogre::Vector3::ZERO;
 	}
 
-	if(position == Ogre::Vector3::ZERO)
+	if(position == Ogre::Vector3::ZERO || !lua_isstring(lua,2))
 	{
 		lua_pushnil(lua);
 		return 1;
@@ -689,50 +890,70 @@ int getNearestEntity(lua_State* lua)
 		return 1;
 	}
 
-	int ltype = LevelData::NONE;
-	if(type == "NPC") { ltype = LevelData::NPC; }
-	if(type == "Enemy") { ltype = LevelData::ENEMY; }
-	if(type == "Door") { ltype = LevelData::DOOR; }
+	int ltype = LuaManager::getEntityTypeFromString(type);
+	if(ltype == LevelData::NONE)
+	{
+		lua_pushstring(lua,"");
+		return 1;
+	}
+
+	//used to be a squared distance of 500.
+	float maxDistance = lua_isnumber(lua,3) ? static_cast<float>(lua_tonumber(lua,3)) : Ogre::Math::Sqrt(500.0f);
+
+	LuaManager* manager = LuaManager::getSingletonPtr();
+	LevelData::EntityHandle closest = manager->getSpatialIndex().nearest(position,maxDistance,ltype,
+																		  std::numeric_limits<float>::epsilon());
+	LevelData::BaseEntity* ent = manager->getEntity(closest);
 
-	std::string closest = "";
-	Ogre::Vector3 entPos;
-	float closestDist = 500.0f,dist = 500.0f;
-	std::map<std::string,LevelData::BaseEntity*>* ents = LuaManager::getSingleton()._getEntities();
-	auto itr = ents->begin();
-	while(itr != ents->end())
+	lua_pushstring(lua,(ent != nullptr) ? ent->getName().c_str() : "");
+	lua_pushnumber(lua,closest);
+
+	return 2;
+}
+
+//pushes the handles as an array.
+static void pushHandleTable(lua_State* lua,const std::vector<LevelData::EntityHandle>& handles)
+{
+	lua_createtable(lua,static_cast<int>(handles.size()),0);
+	for(size_t i = 0; i < handles.size(); ++i)
 	{
-		if(itr->second->getType() == ltype)
-		{
-			switch(ltype)
-			{
-			case LevelData::NPC:
-				entPos = static_cast<NPCCharacter*>(itr->second)->getPosition();
-				dist = position.squaredDistance(entPos);
-				if(dist < closestDist && fabs(0.0f - dist) > std::numeric_limits<float>::epsilon())
-				{
-					closest = itr->second->getName();
-					closestDist = dist;
-				}
-				break;
-			case LevelData::ENEMY:
-				//dist = position.squardedDistance(static_cast<EnemyCharacter*>(itr->second)->getPosition());
-				if(dist < closestDist && fabs(0.0f - dist) > std::numeric_limits<float>::epsilon())
-				{
-					closest = itr->second->getName();
-					closestDist = dist;
-				}
-				break;
-			case LevelData::DOOR:
-				//do this later.
-				break;
-			}
-		}
+		lua_pushnumber(lua,handles[i]);
+		lua_rawseti(lua,-2,static_cast<int>(i + 1));
+	}
+}
+
+// handles = getEntitiesInRadius(position,radius[,type])
+int getEntitiesInRadius(lua_State* lua)
+{
+	std::vector<LevelData::EntityHandle> handles;
+	if(LuaVector::isVector(lua,1) && lua_isnumber(lua,2))
+	{
+		Ogre::Vector3 position = LuaManager::getVectorFromLua(lua,1);
+		float radius = static_cast<float>(lua_tonumber(lua,2));
+		int type = lua_isstring(lua,3) ? LuaManager::getEntityTypeFromString(lua_tostring(lua,3)) : LevelData::NONE;
 
-		++itr;
+		LuaManager::getSingleton().getSpatialIndex().queryRadius(position,radius,type,handles);
 	}
 
-	lua_pushstring(lua,closest.c_str());
+	pushHandleTable(lua,handles);
+	return 1;
+}
 
+// handles = getEntitiesInBox(min,max[,type])
+int getEntitiesInBox(lua_State* lua)
+{
+	std::vector<LevelData::EntityHandle> handles;
+	if(LuaVector::isVector(lua,1) && LuaVector::isVector(lua,2))
+	{
+		Ogre::Vector3 min = LuaManager::getVectorFromLua(lua,1);
+		Ogre::Vector3 max = LuaManager::getVectorFromLua(lua,2);
+		int type = lua_isstring(lua,3) ? LuaManager::getEntityTypeFromString(lua_tostring(lua,3)) : LevelData::NONE;
+
+		Utility::fixMinMax(min,max);
+		LuaManager::getSingleton().getSpatialIndex().queryBox(min,max,type,handles);
+	}
+
+	pushHandleTable(lua,handles);
 	return 1;
 }
 
@@ -831,7 +1052,6 @@ int playSound(lua_State* lua)
 	int numArg = lua_gettop(lua);
 
 	SoundEvent sndEvent;
-	std::string entName;
 	Ogre::Vector3 v = Ogre::Vector3::ZERO;
 	LevelData::BaseEntity* ent;
 
@@ -867,18 +1087,15 @@ int playSound(lua_State* lua)
 			sndEvent.name = lua_tostring(lua,1);
 		} else { return 1; }
 
-		if(lua_isstring(lua,2))
-		{
-			entName = lua_tostring(lua,2);
-		} else { return 1; }
+		ent = LuaManager::getEntityFromLua(lua,2);
+		if(ent == nullptr || ent->getType() != LevelData::NPC) { return 1; }
 
-		if(lua_istable(lua,3))
+		if(LuaVector::isVector(lua,3))
 		{
 			v = LuaManager::getVectorFromLua(lua,3);
 		} else { return 1; }
 
 		//calculate the absolute position
-		ent = LuaManager::getSingletonPtr()->getEntity(entName);
 		v = static_cast<NPCCharacter*>(ent)->getNode()->_getDerivedPosition() + v;
 		sndEvent.position = Utility::ogreToFMOD(v);
 
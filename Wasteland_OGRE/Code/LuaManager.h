@@ -7,6 +7,10 @@
 #define _LUA_MANAGER_H_
 
 #include "LevelData.h"
+#include "SpatialGrid.h"
+#include "LuaVector.h"
+
+#include <unordered_map>
 
 //Make my life easier
 typedef int (*luaFunction)(lua_State*);
@@ -14,6 +18,9 @@ typedef int (*luaFunction)(lua_State*);
 class LuaManager : public Ogre::Singleton<LuaManager>
 {
 public:
+	typedef Ogre::uint32 EntityNameID;
+	static const EntityNameID INVALID_ENTITY_NAME_ID = 0;
+
 	LuaManager();
 	~LuaManager();
 
@@ -37,6 +44,16 @@ public:
 	void prepFunction(const std::string& funcName);
 	void callFunction(int paramNum,int retNum);
 
+	//Function references, for code that calls the same function over and over(entities, AI).
+	//Looks funcName up once and keeps it in the Lua registry, LUA_NOREF if there's no such function.
+	int getFunctionRef(const std::string& funcName);
+	//Same as prepFunction, but with a reference. Returns false(and pushes nothing) for an invalid reference.
+	bool prepFunction(int ref);
+	//Looks funcName up again, for when a script has (re)defined it. Entities pick up the change on their next call.
+	void rebindFunction(const std::string& funcName);
+	//Changes every time references are dropped or rebound, entities compare it to know when to look theirs up again.
+	unsigned int getFunctionRefGeneration() { return _functionRefGeneration; }
+
 	//Function argument functions
 	void pushFunctionArg(boost::variant<int,double,std::string> arg);
 	void pushFunctionArgVector(const Ogre::Vector3& vector);
@@ -46,22 +63,57 @@ public:
 	void clearLuaStack() { lua_settop(luaState,0); }
 
 	//Entity handling functions.
-	void addEntity(const std::string& name,LevelData::BaseEntity* entity);
-	LevelData::BaseEntity* getEntity(const std::string& name) 
-	{ 
-		if(_entities.find(name) != _entities.end())
+	//Entities live in a flat table and are referred to by handles(see LevelData::EntityHandle).
+	//A handle to a removed entity is detected and resolves to null, even after its slot is reused.
+	LevelData::EntityHandle addEntity(const std::string& name,LevelData::BaseEntity* entity);
+	//Array access, null if the entity is gone.
+	LevelData::BaseEntity* getEntity(LevelData::EntityHandle handle)
+	{
+		Ogre::uint32 index = (handle & 0xFFFF) - 1;
+		if(index < _entitySlots.size() && _entitySlots[index].generation == (handle >> 16))
 		{
-			return _entities[name];
-		}
-		else
-		{
-			return nullptr;
+			return _entitySlots[index].entity;
 		}
+		return nullptr;
+	}
+	//Names are interned: each distinct name gets an id once, and everything past that is keyed on the id.
+	//Ids stay valid for the life of the manager, even after the entity is removed or renamed.
+	//A string lookup still hashes the name, resolve the id or handle once and keep it where possible.
+	EntityNameID getEntityNameID(const std::string& name)
+	{
+		auto itr = _nameIDs.find(name);
+		return (itr != _nameIDs.end()) ? itr->second : INVALID_ENTITY_NAME_ID;
+	}
+	const std::string& getEntityName(EntityNameID id) { return (id < _names.size()) ? _names[id] : _names[INVALID_ENTITY_NAME_ID]; }
+	//Array access.
+	LevelData::EntityHandle getEntityHandle(EntityNameID id)
+	{
+		return (id < _handlesByName.size()) ? _handlesByName[id] : LevelData::INVALID_ENTITY_HANDLE;
 	}
-	void removeEntity(const std::string& name) { _entities.erase(_entities.find(name)); }
+	LevelData::EntityHandle getEntityHandle(const std::string& name) { return getEntityHandle(getEntityNameID(name)); }
+	LevelData::BaseEntity* getEntity(const std::string& name) { return getEntity(getEntityHandle(name)); }
+	void removeEntity(const std::string& name) { removeEntity(getEntityHandle(name)); }
+	void removeEntity(LevelData::EntityHandle handle);
+	bool renameEntity(LevelData::EntityHandle handle,const std::string& newName);
 	void purgeEntities();
 	void activateEntity(const std::string& name, bool value);
-	std::map<std::string,LevelData::BaseEntity*>* _getEntities() { return &_entities; }
+	void activateEntity(LevelData::EntityHandle handle, bool value);
+
+	struct EntitySlot
+	{
+		//null while the slot is free.
+		LevelData::BaseEntity* entity;
+		//bumped every time the slot is freed, so old handles stop matching.
+		Ogre::uint32 generation;
+		EntityNameID name;
+	};
+	//Every slot, free ones included(entity is null for those).
+	const std::vector<EntitySlot>& _getEntitySlots() { return _entitySlots; }
+
+	//Positions of the entities that move(NPCs and enemies), for neighbour queries.
+	//Characters and doors report their position every frame, others can be added with updateEntityPosition too.
+	void updateEntityPosition(LevelData::EntityHandle handle,const Ogre::Vector3& position);
+	SpatialGrid& getSpatialIndex() { return _spatialIndex; }
 
 	//Maintained values handlers
 	void addDataPointer(const std::string& name,void* dataPtr);
@@ -84,6 +136,10 @@ public:
 	void addSoundEvent(std::string& name, FMOD_VECTOR& position);
 
 	//Helper functions
+	//Entity argument that's either a handle(number) or a name(string).
+	static LevelData::BaseEntity* getEntityFromLua(lua_State* lua,int index);
+	//"NPC", "Enemy" or "Door", anything else is LevelData::NONE.
+	static int getEntityTypeFromString(const std::string& type);
 	static int getIntegerFromLuaTable(lua_State* lua,const std::string& field);
 	static std::string getStringFromLuaTable(lua_State* lua,const std::string& field);
 	static Ogre::Vector3 getVectorFromLuaTable(lua_State* lua,const std::string& field);
@@ -98,13 +154,25 @@ public:
 private:
 	lua_State* luaState;
 
-	std::map<std::string,LevelData::BaseEntity*> _entities;
+	std::vector<EntitySlot> _entitySlots;
+	std::vector<Ogre::uint32> _freeEntitySlots;
+	//interned names, _names[id] is the name and _handlesByName[id] the entity that has it(if any).
+	std::unordered_map<std::string,EntityNameID> _nameIDs;
+	std::vector<std::string> _names;
+	std::vector<LevelData::EntityHandle> _handlesByName;
+	EntityNameID _internName(const std::string& name);
+	SpatialGrid _spatialIndex;
 
 	std::map<std::string,void*> _data;
 	std::map<std::string,boost::variant<double,std::string,bool>> _luaData;
 
 	std::vector<SoundEvent> _soundEvents;
 
+	void _releaseFunctionRefs();
+
+	std::map<std::string,int> _functionRefs;
+	unsigned int _functionRefGeneration;
+
 	LuaManager(const LuaManager&);
 	LuaManager& operator=(const LuaManager&);
 };
@@ -132,12 +200,21 @@ private:
 //Functions that will be registered with Lua
 //==========================================
 
+//Entity functions take either an entity handle or an entity name.
+//Scripts that touch the same entity every frame should get its handle once and use that.
+
+//Allows Lua scripts to get an entity's handle from its name.
+int getEntityHandle(lua_State* lua);
+
 //Activation function. Allows interface between LuaManager and Lua without luabind or tolua++ or whatever.
 int activate(lua_State* lua);
 
 //Allows Lua scripts to change in-game entity names.
 int changeEntityName(lua_State* lua);
 
+//Allows Lua scripts to change the function an entity calls.
+int setEntityScript(lua_State* lua);
+
 //Allows Lua scripts to get entity positions.
 int getEntityPosition(lua_State* lua);
 
@@ -147,6 +224,12 @@ int getEntityHeadPosition(lua_State* lua);
 //Allows Lua scripts to find nearest entities
 int getNearestEntity(lua_State* lua);
 
+//Allows Lua scripts to find every entity within a distance
+int getEntitiesInRadius(lua_State* lua);
+
+//Allows Lua scripts to find every entity within a box
+int getEntitiesInBox(lua_State* lua);
+
 //Allows Lua to print through std::cout directly.
 int printDebug(lua_State* lua);
 
@@ -0,0 +1,273 @@
+#include "StdAfx.h"
+
+#include "LuaVector.h"
+
+namespace LuaVector
+{
+	namespace
+	{
+		Ogre::Vector3& check(lua_State* lua,int index)
+		{
+			return *static_cast<Ogre::Vector3*>(luaL_checkudata(lua,index,LUA_VECTOR3_META));
+		}
+
+		//vector or table.
+		Ogre::Vector3 checkAny(lua_State* lua,int index)
+		{
+			Ogre::Vector3 ret;
+			if(!get(lua,index,ret))
+			{
+				luaL_argerror(lua,index,"Vector3 expected");
+			}
+			return ret;
+		}
+
+		//0 for anything that isn't x/y/z or 1/2/3.
+		int componentIndex(lua_State* lua,int index)
+		{
+			if(lua_type(lua,index) == LUA_TNUMBER)
+			{
+				int i = static_cast<int>(lua_tointeger(lua,index));
+				return (i >= 1 && i <= 3) ? i : 0;
+			}
+
+			const char* key = lua_tostring(lua,index);
+			if(key != nullptr && key[0] >= 'x' && key[0] <= 'z' && key[1] == '\0')
+			{
+				return key[0] - 'x' + 1;
+			}
+			return 0;
+		}
+
+		// Vector3(), Vector3(x,y,z), Vector3(v)
+		int construct(lua_State* lua)
+		{
+			Ogre::Vector3 value = Ogre::Vector3::ZERO;
+			if(lua_gettop(lua) == 1)
+			{
+				value = checkAny(lua,1);
+			}
+			else if(lua_gettop(lua) >= 3)
+			{
+				value.x = static_cast<float>(luaL_checknumber(lua,1));
+				value.y = static_cast<float>(luaL_checknumber(lua,2));
+				value.z = static_cast<float>(luaL_checknumber(lua,3));
+			}
+			push(lua,value);
+			return 1;
+		}
+
+		//upvalue 1 is the method table.
+		int index(lua_State* lua)
+		{
+			Ogre::Vector3& v = check(lua,1);
+			int component = componentIndex(lua,2);
+			if(component != 0)
+			{
+				lua_pushnumber(lua,v[component - 1]);
+				return 1;
+			}
+
+			lua_pushvalue(lua,2);
+			lua_rawget(lua,lua_upvalueindex(1));
+			return 1;
+		}
+
+		int newIndex(lua_State* lua)
+		{
+			Ogre::Vector3& v = check(lua,1);
+			int component = componentIndex(lua,2);
+			if(component == 0)
+			{
+				return luaL_error(lua,"Vector3 only has x, y and z");
+			}
+			v[component - 1] = static_cast<float>(luaL_checknumber(lua,3));
+			return 0;
+		}
+
+		int add(lua_State* lua) { push(lua,checkAny(lua,1) + checkAny(lua,2)); return 1; }
+		int sub(lua_State* lua) { push(lua,checkAny(lua,1) - checkAny(lua,2)); return 1; }
+		int unm(lua_State* lua) { push(lua,-check(lua,1)); return 1; }
+
+		int mul(lua_State* lua)
+		{
+			if(lua_type(lua,1) == LUA_TNUMBER)
+			{
+				push(lua,static_cast<float>(lua_tonumber(lua,1)) * check(lua,2));
+			}
+			else if(lua_type(lua,2) == LUA_TNUMBER)
+			{
+				push(lua,check(lua,1) * static_cast<float>(lua_tonumber(lua,2)));
+			}
+			else
+			{
+				push(lua,checkAny(lua,1) * checkAny(lua,2));
+			}
+			return 1;
+		}
+
+		int div(lua_State* lua)
+		{
+			push(lua,check(lua,1) / static_cast<float>(luaL_checknumber(lua,2)));
+			return 1;
+		}
+
+		int eq(lua_State* lua)
+		{
+			lua_pushboolean(lua,check(lua,1) == check(lua,2));
+			return 1;
+		}
+
+		int toString(lua_State* lua)
+		{
+			Ogre::Vector3& v = check(lua,1);
+			lua_pushfstring(lua,"Vector3(%f, %f, %f)",static_cast<double>(v.x),static_cast<double>(v.y),static_cast<double>(v.z));
+			return 1;
+		}
+
+		int length(lua_State* lua) { lua_pushnumber(lua,check(lua,1).length()); return 1; }
+		int squaredLength(lua_State* lua) { lua_pushnumber(lua,check(lua,1).squaredLength()); return 1; }
+		int distance(lua_State* lua) { lua_pushnumber(lua,check(lua,1).distance(checkAny(lua,2))); return 1; }
+		int squaredDistance(lua_State* lua) { lua_pushnumber(lua,check(lua,1).squaredDistance(checkAny(lua,2))); return 1; }
+		int dot(lua_State* lua) { lua_pushnumber(lua,check(lua,1).dotProduct(checkAny(lua,2))); return 1; }
+		int cross(lua_State* lua) { push(lua,check(lua,1).crossProduct(checkAny(lua,2))); return 1; }
+		int normalise(lua_State* lua) { lua_pushnumber(lua,check(lua,1).normalise()); return 1; }
+		int normalisedCopy(lua_State* lua) { push(lua,check(lua,1).normalisedCopy()); return 1; }
+		int copy(lua_State* lua) { push(lua,check(lua,1)); return 1; }
+
+		//in place, these return the vector itself so they can be chained.
+		int set(lua_State* lua)
+		{
+			Ogre::Vector3& v = check(lua,1);
+			if(lua_gettop(lua) >= 4)
+			{
+				v.x = static_cast<float>(luaL_checknumber(lua,2));
+				v.y = static_cast<float>(luaL_checknumber(lua,3));
+				v.z = static_cast<float>(luaL_checknumber(lua,4));
+			}
+			else
+			{
+				v = checkAny(lua,2);
+			}
+			lua_settop(lua,1);
+			return 1;
+		}
+
+		int addInPlace(lua_State* lua) { check(lua,1) += checkAny(lua,2); lua_settop(lua,1); return 1; }
+		int subInPlace(lua_State* lua) { check(lua,1) -= checkAny(lua,2); lua_settop(lua,1); return 1; }
+		int scale(lua_State* lua) { check(lua,1) *= static_cast<float>(luaL_checknumber(lua,2)); lua_settop(lua,1); return 1; }
+
+		const luaL_Reg methods[] =
+		{
+			{ "length",length },
+			{ "squaredLength",squaredLength },
+			{ "distance",distance },
+			{ "squaredDistance",squaredDistance },
+			{ "dot",dot },
+			{ "cross",cross },
+			{ "normalise",normalise },
+			{ "normalisedCopy",normalisedCopy },
+			{ "copy",copy },
+			{ "set",set },
+			{ "add",addInPlace },
+			{ "sub",subInPlace },
+			{ "scale",scale },
+			{ nullptr,nullptr }
+		};
+
+		const luaL_Reg metamethods[] =
+		{
+			{ "__newindex",newIndex },
+			{ "__add",add },
+			{ "__sub",sub },
+			{ "__mul",mul },
+			{ "__div",div },
+			{ "__unm",unm },
+			{ "__eq",eq },
+			{ "__tostring",toString },
+			{ nullptr,nullptr }
+		};
+	}
+
+	void registerType(lua_State* lua)
+	{
+		luaL_newmetatable(lua,LUA_VECTOR3_META);
+		luaL_register(lua,nullptr,metamethods);
+
+		//__index gets the methods as an upvalue, so a method lookup is a single rawget.
+		lua_newtable(lua);
+		luaL_register(lua,nullptr,methods);
+		lua_pushcclosure(lua,index,1);
+		lua_setfield(lua,-2,"__index");
+
+		lua_pop(lua,1);
+
+		lua_register(lua,"Vector3",construct);
+	}
+
+	Ogre::Vector3* push(lua_State* lua,const Ogre::Vector3& value)
+	{
+		Ogre::Vector3* v = static_cast<Ogre::Vector3*>(lua_newuserdata(lua,sizeof(Ogre::Vector3)));
+		*v = value;
+		luaL_getmetatable(lua,LUA_VECTOR3_META);
+		lua_setmetatable(lua,-2);
+		return v;
+	}
+
+	Ogre::Vector3* toVector(lua_State* lua,int index)
+	{
+		//luaL_checkudata without the error, Lua 5.1 has no luaL_testudata.
+		void* data = lua_touserdata(lua,index);
+		if(data == nullptr || !lua_getmetatable(lua,index))
+		{
+			return nullptr;
+		}
+		luaL_getmetatable(lua,LUA_VECTOR3_META);
+		bool isVector = lua_rawequal(lua,-1,-2) != 0;
+		lua_pop(lua,2);
+		return (isVector) ? static_cast<Ogre::Vector3*>(data) : nullptr;
+	}
+
+	bool get(lua_State* lua,int index,Ogre::Vector3& out)
+	{
+		Ogre::Vector3* v = toVector(lua,index);
+		if(v != nullptr)
+		{
+			out = *v;
+			return true;
+		}
+
+		if(lua_istable(lua,index))
+		{
+			if(index < 0 && index > LUA_REGISTRYINDEX)
+			{
+				index = lua_gettop(lua) + index + 1;
+			}
+			for(int i = 0; i < 3; ++i)
+			{
+				lua_rawgeti(lua,index,i + 1);
+				out[i] = static_cast<float>(lua_tonumber(lua,-1));
+				lua_pop(lua,1);
+			}
+			return true;
+		}
+
+		return false;
+	}
+
+	void pushResult(lua_State* lua,int firstOutIndex,const Ogre::Vector3& value)
+	{
+		for(int i = firstOutIndex; i <= lua_gettop(lua); ++i)
+		{
+			Ogre::Vector3* out = toVector(lua,i);
+			if(out != nullptr)
+			{
+				*out = value;
+				lua_pushvalue(lua,i);
+				return;
+			}
+		}
+
+		push(lua,value);
+	}
+};
@@ -0,0 +1,44 @@
+#include "StdAfx.h"
+#include <lua.hpp>
+
+#ifndef _LUA_VECTOR_H_
+#define _LUA_VECTOR_H_
+
+//Name of the metatable in the Lua registry.
+#define LUA_VECTOR3_META "Vector3"
+
+/*
+	Ogre::Vector3 as a Lua userdata, so positions don't have to go through a table every time.
+
+	In Lua:
+		v = Vector3(x,y,z)		-- also Vector3() and Vector3(other)
+		v.x, v.y, v.z			-- v[1], v[2], v[3] work too, like the old {x,y,z} tables
+		v + w, v - w, v * n, n * v, v * w(per component), v / n, -v, v == w, tostring(v)
+		v:length(), v:squaredLength(), v:distance(w), v:squaredDistance(w), v:dot(w), v:cross(w)
+		v:normalise()			-- in place, returns the old length
+		v:normalisedCopy(), v:copy()
+		v:set(x,y,z), v:set(w), v:add(w), v:sub(w), v:scale(n)	-- in place, return v
+
+	The operators create a new vector, the in place methods don't. Bindings that return a position
+	also take an optional vector to write into, so scripts that poll positions every frame create no garbage.
+*/
+namespace LuaVector
+{
+	//Creates the metatable and the global Vector3 constructor.
+	void registerType(lua_State* lua);
+
+	//Pushes a new vector.
+	Ogre::Vector3* push(lua_State* lua,const Ogre::Vector3& value);
+	//The vector at index, null if it isn't one.
+	Ogre::Vector3* toVector(lua_State* lua,int index);
+	//Reads a vector or an {x,y,z} table(older scripts), false if it's neither.
+	bool get(lua_State* lua,int index,Ogre::Vector3& out);
+	//True for anything get() accepts.
+	inline bool isVector(lua_State* lua,int index) { return lua_istable(lua,index) || toVector(lua,index) != nullptr; }
+
+	//Returns a value from a binding. The first vector found from firstOutIndex on is written to and pushed,
+	//otherwise a new one is pushed.
+	void pushResult(lua_State* lua,int firstOutIndex,const Ogre::Vector3& value);
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "debug\print.h"
 #include "debug\console.h"
 #include "LuaManager.h"
+#include "EWSRasterBenchmark.h"
 
 #include <OgreWindowEventUtilities.h>
 
@@ -22,6 +23,11 @@ int main(int argc, char **argv[])
 {
 #endif
 
+#ifdef EWS_RASTER_BENCHMARK
+	//benchmark build, nothing else gets set up.
+	Console benchConsole("EWS Raster Benchmark");
+	return EWSRaster::runBenchmark();
+#else
 	srand(static_cast<int>(time(0)));
 	srand(static_cast<int>((rand() % RAND_MAX) * time(0)));
 
@@ -90,4 +96,5 @@ int main(int argc, char **argv[])
 	wtld->Run();
 
 	return 0;
+#endif
 }
\ No newline at end of file
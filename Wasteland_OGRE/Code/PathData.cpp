@@ -0,0 +1,85 @@
+#include "StdAfx.h"
+
+#include "PathData.h"
+#include "WorkerPool.h"
+
+namespace
+{
+	Mutex poolMutex;
+
+	//idle blocks by size class, class n holds PATH_POOL_MIN_VERTS << n vertices.
+	std::vector<std::vector<PathData*> > freeBlocks;
+
+	int sizeClassOf(int vertexCount)
+	{
+		int sizeClass = 0;
+		while((PATH_POOL_MIN_VERTS << sizeClass) < vertexCount)
+		{
+			++sizeClass;
+		}
+		return sizeClass;
+	}
+}
+
+PathData* PathData::_allocate(int vertexCount)
+{
+	int sizeClass = sizeClassOf(std::max(vertexCount,1));
+
+	PathData* path = nullptr;
+	{
+		ScopedLock lock(poolMutex);
+		if(static_cast<int>(freeBlocks.size()) <= sizeClass)
+		{
+			freeBlocks.resize(sizeClass + 1);
+		}
+		if(!freeBlocks[sizeClass].empty())
+		{
+			path = freeBlocks[sizeClass].back();
+			freeBlocks[sizeClass].pop_back();
+		}
+	}
+
+	if(path == nullptr)
+	{
+		size_t capacity = static_cast<size_t>(PATH_POOL_MIN_VERTS) << sizeClass;
+		void* block = ::operator new(sizeof(PathData) + capacity * 3 * sizeof(float));
+		path = new (block) PathData();
+		path->_vertices = reinterpret_cast<float*>(path + 1);
+		path->_sizeClass = sizeClass;
+	}
+
+	path->_vertexCount = vertexCount;
+	path->_refCount = 1;
+	path->target = -1;
+	return path;
+}
+
+void PathData::_release(PathData* path)
+{
+	{
+		ScopedLock lock(poolMutex);
+		std::vector<PathData*>& blocks = freeBlocks[path->_sizeClass];
+		if(static_cast<int>(blocks.size()) < PATH_POOL_MAX_IDLE)
+		{
+			blocks.push_back(path);
+			return;
+		}
+	}
+
+	path->~PathData();
+	::operator delete(path);
+}
+
+void PathData::releasePooledPaths()
+{
+	ScopedLock lock(poolMutex);
+	for(auto itr = freeBlocks.begin(); itr != freeBlocks.end(); ++itr)
+	{
+		for(auto block = itr->begin(); block != itr->end(); ++block)
+		{
+			(*block)->~PathData();
+			::operator delete(*block);
+		}
+		itr->clear();
+	}
+}
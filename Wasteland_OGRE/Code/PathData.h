@@ -0,0 +1,96 @@
+#include "StdAfx.h"
+
+#ifndef _PATH_DATA_H_
+#define _PATH_DATA_H_
+
+#define PATH_POOL_MIN_VERTS 16 // smallest path block handed out, bigger ones double from there
+#define PATH_POOL_MAX_IDLE 32 // freed blocks kept around per block size
+
+class PathRef;
+
+/*
+	A straight path, as many vertices as it actually has, stored interleaved(x,y,z,x,y,z...).
+
+	Paths come from a pool of blocks sized in powers of two and are shared through PathRef.
+	When the last PathRef lets go the block goes back to the pool for the next path of that size,
+	so only the paths somebody is still holding take up memory(plus a few idle blocks).
+	Paths can be made and shared on any thread(DetourInterface::findPath runs in jobs), a single PathRef
+	shouldn't be changed by two threads at once though.
+*/
+class PathData
+{
+public:
+	int getVertexCount() const { return _vertexCount; }
+	Ogre::Vector3 getVertex(int index) const { return Ogre::Vector3(_vertices + index * 3); }
+	const float* getVertices() const { return _vertices; }
+	float* getVertices() { return _vertices; }
+
+	//ID of whatever the path was found for, passed through from the request.
+	int target;
+
+	//Frees the idle blocks of the pool.
+	static void releasePooledPaths();
+
+private:
+	friend class PathRef;
+
+	PathData() {}
+	PathData(const PathData&);
+	PathData& operator=(const PathData&);
+
+	static PathData* _allocate(int vertexCount);
+	static void _release(PathData* path);
+
+	//right behind the object, in the same block.
+	float* _vertices;
+	int _vertexCount;
+	int _sizeClass;
+	volatile LONG _refCount;
+};
+
+//Reference counted handle to a PathData, null when there's no path.
+class PathRef
+{
+public:
+	PathRef() : _path(nullptr) {}
+	PathRef(const PathRef& other) : _path(other._path) { if(_path) InterlockedIncrement(&_path->_refCount); }
+	~PathRef() { reset(); }
+
+	PathRef& operator=(const PathRef& other)
+	{
+		if(other._path)
+		{
+			InterlockedIncrement(&other._path->_refCount);
+		}
+		reset();
+		_path = other._path;
+		return *this;
+	}
+
+	//A path with room for exactly vertexCount vertices, filled in by the caller.
+	static PathRef create(int vertexCount) { return PathRef(PathData::_allocate(vertexCount)); }
+
+	void reset()
+	{
+		if(_path && InterlockedDecrement(&_path->_refCount) == 0)
+		{
+			PathData::_release(_path);
+		}
+		_path = nullptr;
+	}
+
+	bool isNull() const { return _path == nullptr; }
+	//0 for a null path.
+	int getVertexCount() const { return (_path) ? _path->getVertexCount() : 0; }
+
+	PathData* get() const { return _path; }
+	PathData* operator->() const { return _path; }
+	PathData& operator*() const { return *_path; }
+
+private:
+	explicit PathRef(PathData* path) : _path(path) {}
+
+	PathData* _path;
+};
+
+#endif
@@ -15,6 +15,10 @@ PhysicsManager::PhysicsManager()
 	_Solver = 0;
 	_Gravity = btVector3(0,0,0);
 	_debugDrawer = 0;
+
+	_FixedTimeStep = btScalar(1.0f / 60.0f);
+	_MaxSubSteps = 5;
+	_Accumulator = 0;
 }
 
 PhysicsManager::~PhysicsManager()
@@ -30,6 +34,9 @@ void PhysicsManager::Setup(btVector3& gravitySpeeds)
 	_Solver = new btSequentialImpulseConstraintSolver();
 	_World = new btDiscreteDynamicsWorld(_Dispatch,_OverlapPairCache,_Solver,_Config);
 
+	//handles every ghost object in the world, including trigger volumes.
+	_World->getPairCache()->setInternalGhostPairCallback(&_TriggerCallback);
+
 	setGravity(gravitySpeeds);
 }
 
@@ -40,7 +47,11 @@ void PhysicsManager::setDebugDrawer(CDebugDraw* drawer)
 
 btRigidBody* PhysicsManager::addRigidBody(btCollisionShape* shape,Ogre::SceneNode* node,btScalar &mass,btTransform &initTransform)
 {
-	_Shapes.push_back(shape);
+	//cached shapes are shared, the cache deletes those.
+	if(!_ShapeCache.contains(shape) && _Shapes.findLinearSearch(shape) == _Shapes.size())
+	{
+		_Shapes.push_back(shape);
+	}
 
 	btVector3 inertia(0,0,0);
 	if(mass != 0.0f)
@@ -51,12 +62,35 @@ btRigidBody* PhysicsManager::addRigidBody(btCollisionShape* shape,Ogre::SceneNod
 
 	btRigidBody::btRigidBodyConstructionInfo rbinfo(mass,motState,shape,inertia);
 	btRigidBody* body = new btRigidBody(rbinfo);
+	//lets trigger volumes tell which node entered them.
+	body->setUserPointer(static_cast<void*>(node));
+	_MotionStates.push_back(motState);
 
 	_World->addRigidBody(body);
 
 	return body;
 }
 
+void PhysicsManager::removeRigidBody(btRigidBody* body)
+{
+	if(body == nullptr)
+	{
+		return;
+	}
+
+	_World->removeRigidBody(body);
+
+	OgreMotionState* motState = static_cast<OgreMotionState*>(body->getMotionState());
+	if(motState != nullptr)
+	{
+		_MotionStates.remove(motState);
+		delete motState;
+	}
+
+	_ShapeCache.release(body->getCollisionShape());
+	delete body;
+}
+
 btPoint2PointConstraint* PhysicsManager::createBallSocketConstraint(btRigidBody* bodyA,const btVector3& pivotA,bool disableCollisions)
 {
 	btPoint2PointConstraint* p2p = new btPoint2PointConstraint(*bodyA,pivotA);
@@ -109,22 +143,68 @@ void PhysicsManager::setGravity(btVector3 &gravity)
 	_World->setGravity(_Gravity);
 }
 
+void PhysicsManager::setStepRate(float stepsPerSecond,int maxSteps)
+{
+	if(stepsPerSecond <= 0.0f || maxSteps < 1)
+	{
+		std::cout << "Error! PhysicsManager - invalid step rate(" << stepsPerSecond << " steps, " << maxSteps << " max)." << std::endl;
+		return;
+	}
+
+	_FixedTimeStep = btScalar(1.0f / stepsPerSecond);
+	_MaxSubSteps = maxSteps;
+	_Accumulator = 0;
+}
+
 //deltaTime will be how many seconds have passed(hopefully less than 1).
 void PhysicsManager::Update(float deltaTime)
 {
-	int subSteps = 0;
-	if(deltaTime < (0.03333333333f))
+	_Accumulator += btScalar(deltaTime);
+
+	int steps = 0;
+	while(_Accumulator >= _FixedTimeStep && steps < _MaxSubSteps)
 	{
-		//just an added substep, because it's lower than recommended.
-		subSteps = (int)ceil(deltaTime*60)+1;
+		for(int i = 0; i < _MotionStates.size(); ++i)
+		{
+			_MotionStates[i]->saveState();
+		}
+		for(int i = 0; i < _InterpolatedObjects.size(); ++i)
+		{
+			_InterpolatedObjects[i].previous = _InterpolatedObjects[i].current;
+		}
+
+		//exactly one step.
+		_World->stepSimulation(_FixedTimeStep,1,_FixedTimeStep);
+		_syncMotionStates();
+		for(int i = 0; i < _InterpolatedObjects.size(); ++i)
+		{
+			_InterpolatedObjects[i].current = _InterpolatedObjects[i].object->getWorldTransform().getOrigin();
+		}
+
+		_Accumulator -= _FixedTimeStep;
+		++steps;
 	}
-	else
+
+	if(_Accumulator >= _FixedTimeStep)
 	{
-		//works fine for higher framerates(lower deltaTimes)
-		subSteps = (int)ceil(deltaTime*60);
+		//hit the step limit after a slow frame, catching up would only make the next frame slower.
+		_Accumulator = btFmod(_Accumulator,_FixedTimeStep);
 	}
 
-	_World->stepSimulation(btScalar(deltaTime),subSteps);
+	//render the fraction of a step that hasn't been simulated yet.
+	btScalar alpha = _Accumulator / _FixedTimeStep;
+	for(int i = 0; i < _MotionStates.size(); ++i)
+	{
+		_MotionStates[i]->interpolate(alpha);
+	}
+	for(int i = 0; i < _InterpolatedObjects.size(); ++i)
+	{
+		const InterpolatedObject& obj = _InterpolatedObjects[i];
+		btVector3 pos = obj.previous.lerp(obj.current,alpha);
+		obj.node->setPosition(pos.x(),pos.y(),pos.z());
+	}
+
+	_dispatchTriggerEvents();
 
 	if(_debugDrawer)
 	{
@@ -132,6 +212,49 @@ void PhysicsManager::Update(float deltaTime)
 	}
 }
 
+void PhysicsManager::_syncMotionStates()
+{
+	//Bullet hands motion states a pose interpolated by its own clock, which depending on the Bullet version can be
+	//ahead of the step. The body's own transform is exact, our interpolation works from that instead.
+	btCollisionObjectArray& objects = _World->getCollisionObjectArray();
+	for(int i = 0; i < objects.size(); ++i)
+	{
+		btRigidBody* body = btRigidBody::upcast(objects[i]);
+		if(body != nullptr && body->getMotionState() != nullptr && !body->isStaticObject())
+		{
+			body->getMotionState()->setWorldTransform(body->getWorldTransform());
+		}
+	}
+}
+
+void PhysicsManager::addInterpolatedObject(btCollisionObject* object,Ogre::SceneNode* node)
+{
+	if(object == nullptr || node == nullptr)
+	{
+		return;
+	}
+
+	InterpolatedObject obj;
+	obj.object = object;
+	obj.node = node;
+	obj.current = object->getWorldTransform().getOrigin();
+	obj.previous = obj.current;
+	_InterpolatedObjects.push_back(obj);
+}
+
+void PhysicsManager::removeInterpolatedObject(btCollisionObject* object)
+{
+	for(int i = 0; i < _InterpolatedObjects.size(); ++i)
+	{
+		if(_InterpolatedObjects[i].object == object)
+		{
+			_InterpolatedObjects.swap(i,_InterpolatedObjects.size() - 1);
+			_InterpolatedObjects.pop_back();
+			return;
+		}
+	}
+}
+
 btCollisionShape* PhysicsManager::generateCollisionShape(object_t* objectInfo)
 {
 	btCollisionShape* retVal = NULL;
@@ -139,6 +262,41 @@ btCollisionShape* PhysicsManager::generateCollisionShape(object_t* objectInfo)
 
 	//TriangleMesh isn't this particular function's responsibility.
 
+	//same type and dimensions means the same shape.
+	std::string key;
+	if(type == "Sphere")
+	{
+		key = type + ":" + boost::lexical_cast<std::string>(objectInfo->colSphereRadius());
+	}
+	else if(type == "Box")
+	{
+		key = type + ":" + boost::lexical_cast<std::string>(objectInfo->colBoxWidth()) + "," +
+			  boost::lexical_cast<std::string>(objectInfo->colBoxHeight()) + "," +
+			  boost::lexical_cast<std::string>(objectInfo->colBoxDepth());
+	}
+	else if(type == "Cube")
+	{
+		key = type + ":" + boost::lexical_cast<std::string>(objectInfo->colCubeSize());
+	}
+	else if(type == "Capsule")
+	{
+		key = type + ":" + boost::lexical_cast<std::string>(objectInfo->colCapsuleWidth()) + "," +
+			  boost::lexical_cast<std::string>(objectInfo->colCapsuleHeight());
+	}
+	else if(type == "Custom")
+	{
+		key = type + ":" + std::string(objectInfo->colCustomFile());
+	}
+
+	if(!key.empty())
+	{
+		retVal = _ShapeCache.acquire(key);
+		if(retVal != NULL)
+		{
+			return retVal;
+		}
+	}
+
 	if(type == "Sphere")
 	{
 		retVal = new btSphereShape((btScalar)objectInfo->colSphereRadius());
@@ -162,8 +320,8 @@ btCollisionShape* PhysicsManager::generateCollisionShape(object_t* objectInfo)
 	if(type == "Custom")
 	{
 		//denotes previously serialized shape, need to load it in.
-		//implementation is for another day.
-		retVal = NULL;
+		//already in the cache if it loaded.
+		return _ShapeCache.loadTriangleMeshShape(key,objectInfo->colCustomFile());
 	}
 
 	if(type == "NULL")
@@ -172,9 +330,94 @@ btCollisionShape* PhysicsManager::generateCollisionShape(object_t* objectInfo)
 		retVal = nullptr;
 	}
 
+	if(retVal != NULL)
+	{
+		_ShapeCache.insert(key,retVal);
+	}
+
 	return retVal;
 }
 
+btGhostObject* PhysicsManager::addTriggerVolume(const btVector3& halfExtents,const btTransform& transform,TriggerListener* listener,short mask)
+{
+	btBoxShape* shape = new btBoxShape(halfExtents);
+	_Shapes.push_back(shape);
+
+	btGhostObject* volume = new btGhostObject();
+	volume->setCollisionShape(shape);
+	volume->setWorldTransform(transform);
+	volume->setUserPointer(static_cast<void*>(listener));
+	//never pushes anything around, and never moves so its AABB doesn't need updating every step.
+	volume->setCollisionFlags(volume->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE | btCollisionObject::CF_STATIC_OBJECT);
+
+	_World->addCollisionObject(volume,btBroadphaseProxy::SensorTrigger,mask);
+	volume->setActivationState(ISLAND_SLEEPING);
+
+	_TriggerVolumes.push_back(volume);
+
+	return volume;
+}
+
+void PhysicsManager::removeTriggerVolume(btGhostObject* volume)
+{
+	if(_World == nullptr || _TriggerVolumes.findLinearSearch(volume) == _TriggerVolumes.size())
+	{
+		//already cleaned up by Shutdown().
+		return;
+	}
+
+	_TriggerVolumes.remove(volume);
+	_World->removeCollisionObject(volume);
+
+	//drop whatever the volume still had queued up, including the exits its removal just caused.
+	btAlignedObjectArray<TriggerPairCallback::TriggerEvent>& events = _TriggerCallback.getEvents();
+	for(int i = events.size() - 1; i >= 0; --i)
+	{
+		if(events[i].volume == volume)
+		{
+			events[i] = events[events.size() - 1];
+			events.pop_back();
+		}
+	}
+
+	//shape stays in _Shapes, it's deleted with the rest of them.
+	delete volume;
+}
+
+void PhysicsManager::_dispatchTriggerEvents()
+{
+	btAlignedObjectArray<TriggerPairCallback::TriggerEvent>& events = _TriggerCallback.getEvents();
+	if(events.size() == 0)
+	{
+		return;
+	}
+
+	//listeners may add or remove volumes, so work on a copy.
+	btAlignedObjectArray<TriggerPairCallback::TriggerEvent> pending;
+	pending.copyFromArray(events);
+	events.clear();
+
+	for(int i = 0; i < pending.size(); ++i)
+	{
+		const TriggerPairCallback::TriggerEvent& evt = pending[i];
+		//volume removed by an earlier listener in this batch
+		if(_TriggerVolumes.findLinearSearch(evt.volume) == _TriggerVolumes.size())
+		{
+			continue;
+		}
+
+		TriggerListener* listener = static_cast<TriggerListener*>(evt.volume->getUserPointer());
+		if(evt.entered)
+		{
+			listener->onTriggerEnter(evt.other);
+		}
+		else
+		{
+			listener->onTriggerExit(evt.other);
+		}
+	}
+}
+
 bool PhysicsManager::RaycastWorld_Closest(const btVector3& start,const btVector3& end, btVector3& position, btVector3& normal)
 {
 	//structure that will hold the results
@@ -211,6 +454,12 @@ void PhysicsManager::Shutdown(bool reuse)
 		delete con;
 	}
 
+	//trigger volumes are deleted with the rest of the collision objects, as are the motion states.
+	_TriggerVolumes.clear();
+	_MotionStates.clear();
+	_InterpolatedObjects.clear();
+	_Accumulator = 0;
+
 	//Deletes all rigid bodies and collision shapes, basically cleans out the class.
 	//rigid bodies
 	for(i=_World->getNumCollisionObjects()-1; i>=0; --i)
@@ -236,6 +485,10 @@ void PhysicsManager::Shutdown(bool reuse)
 		delete shape;
 	}
 	_Shapes.clear(); //cleans up the vector.
+	_ShapeCache.clear();
+
+	//removing the objects above queued up exits for volumes that no longer exist.
+	_TriggerCallback.getEvents().clear();
 
 	if(_debugDrawer)
 	{
@@ -255,13 +508,92 @@ void PhysicsManager::Shutdown(bool reuse)
 	}
 }
 
+//====================
+// Trigger Pair Callback
+//====================
+//Solid ghosts(the character controller) don't get objects without contact response, like the trigger volumes,
+//in their overlap list. btKinematicCharacterController sweeps and recovers from penetration against everything
+//in that list, and Bullet before 2.82 doesn't skip them, so the player would be stopped by invisible volumes.
+//The volumes still see the ghost, and the trigger events come from the pair cache, not from these lists.
+static bool keepsOverlap(btCollisionObject* ghost,btCollisionObject* other)
+{
+	return !ghost->hasContactResponse() || other->hasContactResponse();
+}
+
+btBroadphasePair* TriggerPairCallback::addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+{
+	//btGhostPairCallback::addOverlappingPair, filtered.
+	btCollisionObject* colObj0 = static_cast<btCollisionObject*>(proxy0->m_clientObject);
+	btCollisionObject* colObj1 = static_cast<btCollisionObject*>(proxy1->m_clientObject);
+	btGhostObject* ghost0 = btGhostObject::upcast(colObj0);
+	btGhostObject* ghost1 = btGhostObject::upcast(colObj1);
+	if(ghost0 && keepsOverlap(ghost0,colObj1))
+	{
+		ghost0->addOverlappingObjectInternal(proxy1,proxy0);
+	}
+	if(ghost1 && keepsOverlap(ghost1,colObj0))
+	{
+		ghost1->addOverlappingObjectInternal(proxy0,proxy1);
+	}
+
+	_record(proxy0,proxy1,true);
+	return 0;
+}
+
+void* TriggerPairCallback::removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher)
+{
+	btCollisionObject* colObj0 = static_cast<btCollisionObject*>(proxy0->m_clientObject);
+	btCollisionObject* colObj1 = static_cast<btCollisionObject*>(proxy1->m_clientObject);
+	btGhostObject* ghost0 = btGhostObject::upcast(colObj0);
+	btGhostObject* ghost1 = btGhostObject::upcast(colObj1);
+	if(ghost0 && keepsOverlap(ghost0,colObj1))
+	{
+		ghost0->removeOverlappingObjectInternal(proxy1,dispatcher,proxy0);
+	}
+	if(ghost1 && keepsOverlap(ghost1,colObj0))
+	{
+		ghost1->removeOverlappingObjectInternal(proxy0,dispatcher,proxy1);
+	}
+
+	_record(proxy0,proxy1,false);
+	return 0;
+}
+
+void TriggerPairCallback::_record(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,bool entered)
+{
+	//every pair in the world passes through here, only the ones with a trigger volume are interesting.
+	bool trigger0 = (proxy0->m_collisionFilterGroup & btBroadphaseProxy::SensorTrigger) != 0;
+	bool trigger1 = (proxy1->m_collisionFilterGroup & btBroadphaseProxy::SensorTrigger) != 0;
+	if(trigger0 == trigger1)
+	{
+		//neither, or two volumes touching each other.
+		return;
+	}
+
+	btCollisionObject* volumeObj = static_cast<btCollisionObject*>(trigger0 ? proxy0->m_clientObject : proxy1->m_clientObject);
+	btCollisionObject* otherObj = static_cast<btCollisionObject*>(trigger0 ? proxy1->m_clientObject : proxy0->m_clientObject);
+
+	TriggerEvent evt;
+	evt.volume = btGhostObject::upcast(volumeObj);
+	if(evt.volume == nullptr)
+	{
+		return;
+	}
+	evt.other.object = otherObj;
+	evt.other.userPointer = otherObj->getUserPointer();
+	evt.other.collisionFlags = otherObj->getCollisionFlags();
+	evt.entered = entered;
+	_events.push_back(evt);
+}
+
 //====================
 // Ogre MotionState
 //====================
 OgreMotionState::OgreMotionState(const btTransform &initialPosition,Ogre::SceneNode* node)
 {
 	_Object = node;
-	_ObjectTransform = initialPosition;
+	_PreviousTransform = initialPosition;
+	_CurrentTransform = initialPosition;
 }
 
 //No implementation.
@@ -274,17 +606,30 @@ void OgreMotionState::setNode(Ogre::SceneNode* node)
 
 void OgreMotionState::getWorldTransform(btTransform &worldTrans) const 
 {
-	worldTrans = _ObjectTransform;
+	worldTrans = _CurrentTransform;
 }
 
 void OgreMotionState::setWorldTransform(const btTransform &worldTrans)
+{
+	//node is moved in interpolate(), once per frame rather than once per step.
+	_CurrentTransform = worldTrans;
+}
+
+void OgreMotionState::interpolate(btScalar alpha)
 {
 	//Make sure there's a node to apply transform to.
 	if(_Object == 0)
 		return;
 
-	btQuaternion rot = worldTrans.getRotation();
+	btQuaternion from = _PreviousTransform.getRotation();
+	btQuaternion to = _CurrentTransform.getRotation();
+	if(from.dot(to) < 0)
+	{
+		//take the short way around.
+		to = -to;
+	}
+	btQuaternion rot = from.slerp(to,alpha);
 	_Object->setOrientation(rot.w(),rot.x(),rot.y(),rot.z());
-	btVector3 pos = worldTrans.getOrigin();
+	btVector3 pos = _PreviousTransform.getOrigin().lerp(_CurrentTransform.getOrigin(),alpha);
 	_Object->setPosition(pos.x(),pos.y(),pos.z());
 }
\ No newline at end of file
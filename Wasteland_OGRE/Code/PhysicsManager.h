@@ -11,6 +11,63 @@
 
 #include "BulletDebugDraw\DebugDraw.hpp"
 
+#include "CollisionShapeCache.h"
+
+/*! \brief Receives enter/exit events from a trigger volume.
+
+Events are collected while Bullet updates its broadphase and delivered after the simulation step,
+so it's safe to touch the physics world from these callbacks.
+*/
+struct TriggerOverlap
+{
+	//! Only to be used for comparisons, the object may already be deleted when an exit is delivered.
+	const btCollisionObject* object;
+	//! User pointer of the object when the overlap changed(the SceneNode for rigid bodies).
+	void* userPointer;
+	//! Collision flags of the object when the overlap changed.
+	int collisionFlags;
+};
+
+class TriggerListener
+{
+public:
+	virtual ~TriggerListener() {}
+
+	//! Called once when another collision object starts overlapping the volume.
+	virtual void onTriggerEnter(const TriggerOverlap& other) = 0;
+	//! Called once when another collision object stops overlapping the volume(or is removed from the world).
+	virtual void onTriggerExit(const TriggerOverlap& other) = 0;
+};
+
+/*! \brief Ghost pair callback that also records trigger volume overlaps.
+
+Replaces the plain btGhostPairCallback, so pair caching ghosts(e.g. the character controller) keep working.
+Ghosts with contact response don't get objects without it(trigger volumes) in their overlap lists, so the
+character controller doesn't collide with the volumes it has to be in the SensorTrigger mask for.
+*/
+class TriggerPairCallback : public btGhostPairCallback
+{
+public:
+	struct TriggerEvent
+	{
+		btGhostObject* volume;
+		TriggerOverlap other;
+		bool entered;
+	};
+
+	virtual btBroadphasePair* addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+	virtual void* removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher);
+
+	btAlignedObjectArray<TriggerEvent>& getEvents() { return _events; }
+
+private:
+	void _record(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,bool entered);
+
+	btAlignedObjectArray<TriggerEvent> _events;
+};
+
+class OgreMotionState;
+
 /*! \brief This class manages all of Bullet Physics.
 
 Performs various tasks specific to Bullet Physics, is mainly self-contained.
@@ -27,9 +84,27 @@ public:
 	void Setup(btVector3& gravitySpeeds);
 	//! Steps the Bullet Physics simulation.
 	/*! 
+		Runs as many fixed steps as fit into the time accumulated so far(up to the step limit),
+		then places every scene node between its last two simulated poses.
 		\param deltaTime Elapsed time represented in seconds.
 	*/
 	void Update(float deltaTime);
+
+	//! Sets how often the simulation is stepped.
+	/*!
+		\param stepsPerSecond Rate of the fixed simulation steps.
+		\param maxSteps Most steps taken in one Update, time beyond that is dropped instead of catching up.
+	*/
+	void setStepRate(float stepsPerSecond,int maxSteps = 5);
+	//! Length of one simulation step in seconds.
+	btScalar getFixedTimeStep() { return _FixedTimeStep; }
+
+	//! Has the node follow an object that Bullet moves without a motion state(e.g. the character controller's ghost).
+	/*!
+		Its position is interpolated between steps like the rigid bodies', the orientation is left to the owner.
+	*/
+	void addInterpolatedObject(btCollisionObject* object,Ogre::SceneNode* node);
+	void removeInterpolatedObject(btCollisionObject* object);
 	//! Shutsdown Bullet, deleting all collision shapes and rigid bodies.
 	/*!
 		\param reuse If true,tells the function to spare the main Bullet pointers, allowing their reuse in a 'new' simulation.
@@ -50,6 +125,11 @@ public:
 		\param initTrans The initial position/rotation of the rigid body in the simulation.
 	*/
 	btRigidBody* addRigidBody(btCollisionShape* shape,Ogre::SceneNode* node, btScalar &mass, btTransform &initTransform);
+	//! Removes and deletes a rigid body made by addRigidBody, along with its motion state.
+	/*!
+		Its shape is released if it came from the shape cache, other shapes are kept until Shutdown().
+	*/
+	void removeRigidBody(btRigidBody* body);
 
 	btPoint2PointConstraint* createBallSocketConstraint(btRigidBody* bodyA,const btVector3& pivotA,bool disableCollisions = false);
 	btPoint2PointConstraint* createBallSocketConstraint(btRigidBody* bodyA, btRigidBody* bodyB, 
@@ -67,7 +147,27 @@ public:
 											 const btTransform& frameA, const btTransform& frameB, 
 											 bool referenceFrameA = false);
 
+	//! Returns the collision shape described by objectInfo.
+	/*!
+		Shapes are shared through the shape cache, every object described the same way gets the same shape.
+		"Custom" shapes are triangle meshes loaded from the file named by colCustomFile.
+	*/
 	btCollisionShape* generateCollisionShape(object_t* objectInfo);
+
+	//! Shared collision shapes, owned by this class.
+	CollisionShapeCache* getShapeCache() { return &_ShapeCache; }
+
+	//! Creates a box shaped trigger volume, overlaps are reported to listener.
+	/*!
+		\param halfExtents Half the size of the box on each axis.
+		\param transform Position/rotation of the box.
+		\param listener Receives the enter/exit events, must outlive the volume.
+		\param mask Collision groups the volume reacts to. Static geometry is excluded by default.
+	*/
+	btGhostObject* addTriggerVolume(const btVector3& halfExtents,const btTransform& transform,TriggerListener* listener,
+									short mask = btBroadphaseProxy::DefaultFilter | btBroadphaseProxy::KinematicFilter | btBroadphaseProxy::CharacterFilter);
+	//! Removes and deletes a trigger volume, no more events are delivered for it.
+	void removeTriggerVolume(btGhostObject* volume);
 	
 	//! Returns the Bullet Physics world pointer.
 	btDiscreteDynamicsWorld* getWorld(){return _World;}
@@ -89,6 +189,34 @@ private:
 
 	//Holds all the collision shapes we need to get rid of.
 	btAlignedObjectArray<btCollisionShape*> _Shapes;
+	//Shapes shared between bodies, those don't go in _Shapes.
+	CollisionShapeCache _ShapeCache;
+
+	//Trigger volumes and the pair callback that watches them.
+	btAlignedObjectArray<btGhostObject*> _TriggerVolumes;
+	TriggerPairCallback _TriggerCallback;
+
+	//Delivers the trigger events recorded during the last step.
+	void _dispatchTriggerEvents();
+
+	//Motion states of every rigid body, for saving/interpolating their poses.
+	btAlignedObjectArray<OgreMotionState*> _MotionStates;
+	//Hands every moving body's transform to its motion state, as it is at the end of the step.
+	void _syncMotionStates();
+
+	struct InterpolatedObject
+	{
+		btCollisionObject* object;
+		Ogre::SceneNode* node;
+		btVector3 previous;
+		btVector3 current;
+	};
+	btAlignedObjectArray<InterpolatedObject> _InterpolatedObjects;
+
+	//Fixed step length, step limit and the simulated time still owed.
+	btScalar _FixedTimeStep;
+	int _MaxSubSteps;
+	btScalar _Accumulator;
 
 	//Current gravity.
 	btVector3 _Gravity;
@@ -101,6 +229,7 @@ private:
 /*! \brief This class transfers Bullet transformations to Ogre scene nodes.
 
 Is the primary vehicle of interaction between Bullet Physics and Ogre3D.
+Keeps the poses of the last two simulation steps, the node is only moved by interpolate().
 */
 
 class OgreMotionState : public btMotionState
@@ -116,6 +245,8 @@ public:
 
 	//! Sets the node of the MotionState.
 	void setNode(Ogre::SceneNode* node);
+	//! Gets the node of the MotionState.
+	Ogre::SceneNode* getNode() { return _Object; }
 
 	//! Gets the current transformation.
 	virtual void getWorldTransform(btTransform &worldTrans) const ;
@@ -123,9 +254,19 @@ public:
 	//! Sets the current transformation.
 	virtual void setWorldTransform(const btTransform &worldTrans);
 
+	//! Makes the current transformation the previous one, called before every simulation step.
+	void saveState() { _PreviousTransform = _CurrentTransform; }
+
+	//! Applies the pose between the previous and current transformation to the node.
+	/*!
+		\param alpha 0 gives the previous transformation, 1 the current one.
+	*/
+	void interpolate(btScalar alpha);
+
 private:
 	Ogre::SceneNode* _Object;
-	btTransform _ObjectTransform;
+	btTransform _PreviousTransform;
+	btTransform _CurrentTransform;
 };
 
 #endif
\ No newline at end of file
@@ -109,12 +109,14 @@ bool Player::Update(InputManager* input,
 
 				auto shot =  [this,gun] (Ogre::RaySceneQueryResultEntry& entry) 
 				{
-					if(entry.movable != nullptr)
+					//registered characters carry their entity handle, anything else is scenery.
+					if(entry.movable != nullptr && entry.movable->getUserAny().getType() == typeid(LevelData::EntityHandle))
 					{
-						std::string name = entry.movable->getName().substr(3,std::string::npos);
-						LevelData::BaseEntity* ent = LuaManager::getSingleton().getEntity(name);
+						LevelData::EntityHandle handle = Ogre::any_cast<LevelData::EntityHandle>(entry.movable->getUserAny());
+						LevelData::BaseEntity* ent = LuaManager::getSingleton().getEntity(handle);
 						if(ent != nullptr && (ent->getType() == LevelData::NPC || ent->getType() == LevelData::ENEMY))
 						{
+							std::string name = ent->getName();
 							_damageInterface->registerShotAtEnemy(gun->getGunshotData(),name);
 						}
 					}
@@ -3,6 +3,7 @@
 #ifndef _RECAST_DETOUR_UTIL_H_
 #define _RECAST_DETOUR_UTIL_H_
 
+//0 to 1, every thread has its own generator.
 float frand();
 
 class RecastConfiguration;
@@ -34,7 +35,8 @@ public:
 		  _verticesPerPolygon(6),
 		  _detailSampleDistance(6),
 		  _detailSampleMaxError(1),
-		  _keepIntermediateResults(false)
+		  _keepIntermediateResults(false),
+		  _tileSize(0)
 	{
 		eval();
 	}
@@ -53,7 +55,8 @@ public:
 		  _verticesPerPolygon(6),
 		  _detailSampleDistance(6),
 		  _detailSampleMaxError(1),
-		  _keepIntermediateResults(false)
+		  _keepIntermediateResults(false),
+		  _tileSize(0)
 	{
 		eval();
 	}
@@ -100,6 +103,9 @@ public:
 	inline void setKeepIntermediateResults(bool keep = false) { _keepIntermediateResults = keep; }
 	inline bool getKeepIntermediateResults() { return _keepIntermediateResults; }
 
+	inline void setTileSize(int size) { _tileSize = size; }
+	inline int getTileSize() { return _tileSize; }
+
 	inline int _getWalkableHeight() { return _walkableHeight; }
 	inline int _getWalkableClimb() { return _walkableHeight; }
 	inline int _getMaxEdgeLength() { return _maxEdgeLength; }
@@ -217,6 +223,11 @@ private:
 
 	bool _keepIntermediateResults;
 
+	//Width/depth of a navmesh tile in cells. 0 builds one monolithic navmesh.
+	//Tiles are built in parallel and keep big levels under Detour's per-tile vertex/polygon limits.
+	//Limit: 0 or >= 16 [ unit: vx ], 32-128 is a sensible range.
+	int _tileSize;
+
 	//Minimum height in # of cells that the ceiling needs to be. Related to _agentHeight & _cellHeight
 	//Limit: >= 3 [ unit: vx]
 	//Aliases: minTraversableHeight
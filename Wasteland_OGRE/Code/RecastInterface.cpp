@@ -3,6 +3,8 @@
 #include "RecastInterface.h"
 #include "Utility.h"
 #include "GraphicsManager.h"
+#include "DetourInterface.h"
+#include "WorkerPool.h"
 
 RecastInterface::RecastInterface(Ogre::SceneManager* scene,RecastConfiguration config)
 	: _scene(scene),
@@ -47,7 +49,7 @@ void RecastInterface::configure(RecastConfiguration config)
 	_config.detailSampleMaxError = config._getDetailSampleMaxError();
 	_config.maxVertsPerPoly = config.getVerticesPerPolygon();
 	_config.maxSimplificationError = config.getEdgeMaxError();
-	_config.tileSize = 0;
+	_config.tileSize = config.getTileSize();
 
 	_recastParams = config;
 }
@@ -301,6 +303,584 @@ bool RecastInterface::buildNavMesh(InputGeometry* inputGeom)
 	return true;
 }
 
+//Everything Recast allocates for a single tile, freed whichever way the build ends.
+struct TileBuildData
+{
+	TileBuildData()
+		: triangleAreas(nullptr),solid(nullptr),compactHeightfield(nullptr),
+		  contourSet(nullptr),polyMesh(nullptr),detailMesh(nullptr),layerSet(nullptr) {}
+	~TileBuildData()
+	{
+		delete[] triangleAreas;
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(compactHeightfield);
+		rcFreeContourSet(contourSet);
+		rcFreePolyMesh(polyMesh);
+		rcFreePolyMeshDetail(detailMesh);
+		rcFreeHeightfieldLayerSet(layerSet);
+	}
+
+	unsigned char* triangleAreas;
+	rcHeightfield* solid;
+	rcCompactHeightfield* compactHeightfield;
+	rcContourSet* contourSet;
+	rcPolyMesh* polyMesh;
+	rcPolyMeshDetail* detailMesh;
+	rcHeightfieldLayerSet* layerSet;
+};
+
+struct TileBuildResult
+{
+	int x,y;
+	unsigned char* data;
+	int dataSize;
+};
+
+//The compressed tile cache layers of one tile.
+struct TileLayerResult
+{
+	int x,y;
+	std::vector<unsigned char*> data;
+	std::vector<int> dataSize;
+};
+
+//Sorts the triangles into the tiles they touch(plus the border), so each tile only rasterizes its own.
+static void binTriangles(InputGeometry* inputGeom,const float* bmin,int tilesWide,int tilesHigh,float tileWorldSize,float border,
+						 std::vector<std::vector<int>>& tileTriangles)
+{
+	tileTriangles.assign(tilesWide * tilesHigh,std::vector<int>());
+	const float* verts = inputGeom->getVertices();
+	const int* tris = inputGeom->getTriangles();
+	for(int i = 0; i < inputGeom->getTriangleCount(); ++i)
+	{
+		const int* tri = &tris[i * 3];
+		float minX = rcMin(verts[tri[0]*3],rcMin(verts[tri[1]*3],verts[tri[2]*3]));
+		float maxX = rcMax(verts[tri[0]*3],rcMax(verts[tri[1]*3],verts[tri[2]*3]));
+		float minZ = rcMin(verts[tri[0]*3+2],rcMin(verts[tri[1]*3+2],verts[tri[2]*3+2]));
+		float maxZ = rcMax(verts[tri[0]*3+2],rcMax(verts[tri[1]*3+2],verts[tri[2]*3+2]));
+
+		int x0 = rcClamp(static_cast<int>(floorf((minX - border - bmin[0]) / tileWorldSize)),0,tilesWide - 1);
+		int x1 = rcClamp(static_cast<int>(floorf((maxX + border - bmin[0]) / tileWorldSize)),0,tilesWide - 1);
+		int z0 = rcClamp(static_cast<int>(floorf((minZ - border - bmin[2]) / tileWorldSize)),0,tilesHigh - 1);
+		int z1 = rcClamp(static_cast<int>(floorf((maxZ + border - bmin[2]) / tileWorldSize)),0,tilesHigh - 1);
+		for(int z = z0; z <= z1; ++z)
+		{
+			for(int x = x0; x <= x1; ++x)
+			{
+				std::vector<int>& list = tileTriangles[x + z * tilesWide];
+				list.push_back(tri[0]);
+				list.push_back(tri[1]);
+				list.push_back(tri[2]);
+			}
+		}
+	}
+}
+
+//The tile config of a tile inside the whole mesh config, bounds grown by the border.
+static void tileConfigAt(const rcConfig& meshConfig,const rcConfig& tileConfig,int x,int y,float tileWorldSize,rcConfig& cfg)
+{
+	const float border = tileConfig.borderSize * tileConfig.cs;
+	memcpy(&cfg,&tileConfig,sizeof(cfg));
+	cfg.bmin[0] = meshConfig.bmin[0] + x * tileWorldSize - border;
+	cfg.bmin[1] = meshConfig.bmin[1];
+	cfg.bmin[2] = meshConfig.bmin[2] + y * tileWorldSize - border;
+	cfg.bmax[0] = meshConfig.bmin[0] + (x + 1) * tileWorldSize + border;
+	cfg.bmax[1] = meshConfig.bmax[1];
+	cfg.bmax[2] = meshConfig.bmin[2] + (y + 1) * tileWorldSize + border;
+}
+
+//Rasterizes a tile's triangles and filters them down to an eroded compact heightfield, the part of the
+//pipeline solid tiles and tile cache layers have in common.
+static bool buildTileHeightfield(rcContext& context,const rcConfig& cfg,InputGeometry* inputGeom,
+								 const std::vector<int>& triangles,int tileX,int tileY,TileBuildData& build)
+{
+	int numTris = static_cast<int>(triangles.size() / 3);
+	if(numTris == 0)
+	{
+		return false;
+	}
+
+	build.solid = rcAllocHeightfield();
+	if(!build.solid || !rcCreateHeightfield(&context,*build.solid,cfg.width,cfg.height,cfg.bmin,cfg.bmax,cfg.cs,cfg.ch))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not create heightfield." << std::endl;
+		return false;
+	}
+
+	build.triangleAreas = new unsigned char[numTris];
+	memset(build.triangleAreas,0,numTris * sizeof(unsigned char));
+	rcMarkWalkableTriangles(&context,cfg.walkableSlopeAngle,
+							inputGeom->getVertices(),inputGeom->getVertexCount(),
+							&triangles[0],numTris,build.triangleAreas);
+	rcRasterizeTriangles(&context,inputGeom->getVertices(),inputGeom->getVertexCount(),
+						 &triangles[0],build.triangleAreas,numTris,*build.solid,cfg.walkableClimb);
+
+	rcFilterLowHangingWalkableObstacles(&context,cfg.walkableClimb,*build.solid);
+	rcFilterLedgeSpans(&context,cfg.walkableHeight,cfg.walkableClimb,*build.solid);
+	rcFilterWalkableLowHeightSpans(&context,cfg.walkableHeight,*build.solid);
+
+	build.compactHeightfield = rcAllocCompactHeightfield();
+	if(!build.compactHeightfield ||
+	   !rcBuildCompactHeightfield(&context,cfg.walkableHeight,cfg.walkableClimb,*build.solid,*build.compactHeightfield))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not build compact data." << std::endl;
+		return false;
+	}
+
+	if(!rcErodeWalkableArea(&context,cfg.walkableRadius,*build.compactHeightfield))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not erode walkable area." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//Runs the Recast pipeline for one tile and turns it into Detour tile data.
+//Only touches its own allocations, so any number of these can run at once.
+static unsigned char* buildTileData(rcConfig cfg,RecastConfiguration* userConfig,InputGeometry* inputGeom,
+									const std::vector<int>& triangles,int tileX,int tileY,int& dataSize)
+{
+	dataSize = 0;
+
+	rcContext context(false);
+	TileBuildData build;
+	if(!buildTileHeightfield(context,cfg,inputGeom,triangles,tileX,tileY,build))
+	{
+		return nullptr;
+	}
+
+	if(!rcBuildDistanceField(&context,*build.compactHeightfield) ||
+	   !rcBuildRegions(&context,*build.compactHeightfield,cfg.borderSize,cfg.minRegionArea,cfg.mergeRegionArea))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not build regions." << std::endl;
+		return nullptr;
+	}
+
+	build.contourSet = rcAllocContourSet();
+	if(!build.contourSet ||
+	   !rcBuildContours(&context,*build.compactHeightfield,cfg.maxSimplificationError,cfg.maxEdgeLen,*build.contourSet))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not create contours." << std::endl;
+		return nullptr;
+	}
+	if(build.contourSet->nconts == 0)
+	{
+		//nothing walkable in this tile.
+		return nullptr;
+	}
+
+	build.polyMesh = rcAllocPolyMesh();
+	if(!build.polyMesh || !rcBuildPolyMesh(&context,*build.contourSet,cfg.maxVertsPerPoly,*build.polyMesh))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not triangulate contours." << std::endl;
+		return nullptr;
+	}
+
+	build.detailMesh = rcAllocPolyMeshDetail();
+	if(!build.detailMesh ||
+	   !rcBuildPolyMeshDetail(&context,*build.polyMesh,*build.compactHeightfield,
+							  cfg.detailSampleDist,cfg.detailSampleMaxError,*build.detailMesh))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not build detail mesh." << std::endl;
+		return nullptr;
+	}
+
+	if(build.polyMesh->nverts >= 0xffff)
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Too many vertices, use a smaller tile size." << std::endl;
+		return nullptr;
+	}
+
+	DetourInterface::setPolyFlags(build.polyMesh);
+
+	dtNavMeshCreateParams params;
+	memset(&params,0,sizeof(params));
+	params.verts = build.polyMesh->verts;
+	params.vertCount = build.polyMesh->nverts;
+	params.polys = build.polyMesh->polys;
+	params.polyAreas = build.polyMesh->areas;
+	params.polyFlags = build.polyMesh->flags;
+	params.polyCount = build.polyMesh->npolys;
+	params.nvp = build.polyMesh->nvp;
+	params.detailMeshes = build.detailMesh->meshes;
+	params.detailVerts = build.detailMesh->verts;
+	params.detailVertsCount = build.detailMesh->nverts;
+	params.detailTris = build.detailMesh->tris;
+	params.detailTriCount = build.detailMesh->ntris;
+	params.offMeshConCount = 0;
+	params.walkableHeight = userConfig->getAgentHeight();
+	params.walkableRadius = userConfig->getAgentRadius();
+	params.walkableClimb = userConfig->getAgentMaxClimb();
+	params.tileX = tileX;
+	params.tileY = tileY;
+	params.tileLayer = 0;
+	rcVcopy(params.bmin,build.polyMesh->bmin);
+	rcVcopy(params.bmax,build.polyMesh->bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+
+	unsigned char* navData = nullptr;
+	if(!dtCreateNavMeshData(&params,&navData,&dataSize))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not build Detour data." << std::endl;
+		dataSize = 0;
+		return nullptr;
+	}
+
+	return navData;
+}
+
+bool RecastInterface::buildTiledNavMesh(InputGeometry* inputGeom,DetourInterface* detour,int numThreads)
+{
+	if(_config.tileSize <= 0)
+	{
+		std::cout << "Error! BuildTiledNav - no tile size set in the configuration." << std::endl;
+		return false;
+	}
+
+#ifdef _DEBUG
+	std::cout << "Tiled NavMesh build started." << std::endl;
+	unsigned long start = Ogre::Root::getSingleton().getTimer()->getMilliseconds();
+#endif
+
+	rcVcopy(_config.bmin,inputGeom->getMeshBoundsMin());
+	rcVcopy(_config.bmax,inputGeom->getMeshBoundsMax());
+	rcCalcGridSize(_config.bmin,_config.bmax,_config.cs,&_config.width,&_config.height);
+
+	const int tileSize = _config.tileSize;
+	const int tilesWide = (_config.width + tileSize - 1) / tileSize;
+	const int tilesHigh = (_config.height + tileSize - 1) / tileSize;
+	const float tileWorldSize = tileSize * _config.cs;
+
+	//tile and polygon ids share the 22 bits of a dtPolyRef left over after the salt.
+	int tileBits = rcMin(static_cast<int>(dtIlog2(dtNextPow2(tilesWide * tilesHigh))),14);
+	int polyBits = 22 - tileBits;
+	if(!detour->initTiledNavMesh(_config.bmin,tileWorldSize,tileWorldSize,1 << tileBits,1 << polyBits))
+	{
+		return false;
+	}
+
+	//every tile is built with a border, so neighbouring tiles line up along their shared edges.
+	rcConfig tileConfig;
+	memcpy(&tileConfig,&_config,sizeof(tileConfig));
+	tileConfig.borderSize = tileConfig.walkableRadius + 3;
+	tileConfig.width = tileSize + tileConfig.borderSize * 2;
+	tileConfig.height = tileSize + tileConfig.borderSize * 2;
+	const float border = tileConfig.borderSize * tileConfig.cs;
+
+	std::vector<std::vector<int>> tileTriangles;
+	binTriangles(inputGeom,_config.bmin,tilesWide,tilesHigh,tileWorldSize,border,tileTriangles);
+
+	Mutex resultMutex;
+	Condition resultReady;
+	std::vector<TileBuildResult> results;
+	int pending = 0;
+
+	RecastConfiguration* userConfig = &_recastParams;
+	{
+		WorkerPool pool(numThreads);
+		for(int y = 0; y < tilesHigh; ++y)
+		{
+			for(int x = 0; x < tilesWide; ++x)
+			{
+				const std::vector<int>* triangles = &tileTriangles[x + y * tilesWide];
+				if(triangles->empty())
+				{
+					continue;
+				}
+
+				rcConfig cfg;
+				tileConfigAt(_config,tileConfig,x,y,tileWorldSize,cfg);
+
+				++pending;
+				pool.push([=,&resultMutex,&resultReady,&results] () {
+					TileBuildResult result;
+					result.x = x;
+					result.y = y;
+					result.data = buildTileData(cfg,userConfig,inputGeom,*triangles,x,y,result.dataSize);
+
+					ScopedLock lock(resultMutex);
+					results.push_back(result);
+					resultReady.notifyOne();
+				});
+			}
+		}
+
+		//hand tiles to Detour as they come in, dtNavMesh itself isn't thread-safe.
+		int tilesAdded = 0;
+		while(pending > 0)
+		{
+			std::vector<TileBuildResult> finished;
+			{
+				ScopedLock lock(resultMutex);
+				while(results.empty())
+				{
+					resultReady.wait(resultMutex);
+				}
+				finished.swap(results);
+			}
+
+			for(auto itr = finished.begin(); itr != finished.end(); ++itr)
+			{
+				--pending;
+				if(itr->data && detour->addTile(itr->data,itr->dataSize))
+				{
+					++tilesAdded;
+				}
+			}
+		}
+
+#ifdef _DEBUG
+		unsigned long end = Ogre::Root::getSingletonPtr()->getTimer()->getMilliseconds();
+		std::cout << "Tiled navmesh build finished." << std::endl;
+		std::cout << " - " << tilesAdded << " tiles(" << tilesWide << " x " << tilesHigh << ") on " << pool.getThreadCount() << " threads" << std::endl;
+		std::cout << " - Time elapsed:" << end - start << "ms" << std::endl;
+#endif
+	}
+
+	return detour->isMeshBuilt();
+}
+
+//Builds the compressed tile cache layers of one tile, one for every floor Recast finds in it.
+static void buildTileLayers(rcConfig cfg,InputGeometry* inputGeom,const std::vector<int>& triangles,
+							int tileX,int tileY,TileLayerResult& result)
+{
+	rcContext context(false);
+	TileBuildData build;
+	if(!buildTileHeightfield(context,cfg,inputGeom,triangles,tileX,tileY,build))
+	{
+		return;
+	}
+
+	build.layerSet = rcAllocHeightfieldLayerSet();
+	if(!build.layerSet ||
+	   !rcBuildHeightfieldLayers(&context,*build.compactHeightfield,cfg.borderSize,cfg.walkableHeight,*build.layerSet))
+	{
+		std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not build heightfield layers." << std::endl;
+		return;
+	}
+
+	for(int i = 0; i < rcMin(build.layerSet->nlayers,255); ++i)
+	{
+		const rcHeightfieldLayer* layer = &build.layerSet->layers[i];
+
+		dtTileCacheLayerHeader header;
+		header.magic = DT_TILECACHE_MAGIC;
+		header.version = DT_TILECACHE_VERSION;
+		header.tx = tileX;
+		header.ty = tileY;
+		header.tlayer = i;
+		dtVcopy(header.bmin,layer->bmin);
+		dtVcopy(header.bmax,layer->bmax);
+		header.width = static_cast<unsigned char>(layer->width);
+		header.height = static_cast<unsigned char>(layer->height);
+		header.minx = static_cast<unsigned char>(layer->minx);
+		header.maxx = static_cast<unsigned char>(layer->maxx);
+		header.miny = static_cast<unsigned char>(layer->miny);
+		header.maxy = static_cast<unsigned char>(layer->maxy);
+		header.hmin = static_cast<unsigned short>(layer->hmin);
+		header.hmax = static_cast<unsigned short>(layer->hmax);
+
+		unsigned char* data = nullptr;
+		int dataSize = 0;
+		if(dtStatusFailed(dtBuildTileCacheLayer(DetourInterface::getTileCacheCompressor(),&header,
+												layer->heights,layer->areas,layer->cons,&data,&dataSize)))
+		{
+			std::cout << "Error! BuildTile(" << tileX << "," << tileY << ") - Could not compress layer " << i << "." << std::endl;
+			continue;
+		}
+		result.data.push_back(data);
+		result.dataSize.push_back(dataSize);
+	}
+}
+
+bool RecastInterface::buildTileCache(InputGeometry* inputGeom,DetourInterface* detour,int numThreads)
+{
+	if(_config.tileSize <= 0 || _config.tileSize > 255)
+	{
+		std::cout << "Error! BuildTileCache - the tile size needs to be between 1 and 255." << std::endl;
+		return false;
+	}
+
+#ifdef _DEBUG
+	std::cout << "Tile cache build started." << std::endl;
+	unsigned long start = Ogre::Root::getSingleton().getTimer()->getMilliseconds();
+#endif
+
+	rcVcopy(_config.bmin,inputGeom->getMeshBoundsMin());
+	rcVcopy(_config.bmax,inputGeom->getMeshBoundsMax());
+	rcCalcGridSize(_config.bmin,_config.bmax,_config.cs,&_config.width,&_config.height);
+
+	const int tileSize = _config.tileSize;
+	const int tilesWide = (_config.width + tileSize - 1) / tileSize;
+	const int tilesHigh = (_config.height + tileSize - 1) / tileSize;
+	const float tileWorldSize = tileSize * _config.cs;
+
+	//a navmesh tile for every layer, so tile and polygon ids have to leave room for them.
+	int tileBits = rcMin(static_cast<int>(dtIlog2(dtNextPow2(tilesWide * tilesHigh * TILECACHE_LAYERS_PER_TILE))),14);
+	int polyBits = 22 - tileBits;
+
+	dtTileCacheParams params;
+	memset(&params,0,sizeof(params));
+	rcVcopy(params.orig,_config.bmin);
+	params.cs = _config.cs;
+	params.ch = _config.ch;
+	params.width = tileSize;
+	params.height = tileSize;
+	params.walkableHeight = _recastParams.getAgentHeight();
+	params.walkableRadius = _recastParams.getAgentRadius();
+	params.walkableClimb = _recastParams.getAgentMaxClimb();
+	params.maxSimplificationError = _config.maxSimplificationError;
+	params.maxTiles = 1 << tileBits;
+	params.maxObstacles = TILECACHE_MAX_OBSTACLES;
+	if(!detour->initTileCache(params,1 << polyBits))
+	{
+		return false;
+	}
+
+	rcConfig tileConfig;
+	memcpy(&tileConfig,&_config,sizeof(tileConfig));
+	tileConfig.borderSize = tileConfig.walkableRadius + 3;
+	tileConfig.width = tileSize + tileConfig.borderSize * 2;
+	tileConfig.height = tileSize + tileConfig.borderSize * 2;
+	const float border = tileConfig.borderSize * tileConfig.cs;
+
+	std::vector<std::vector<int>> tileTriangles;
+	binTriangles(inputGeom,_config.bmin,tilesWide,tilesHigh,tileWorldSize,border,tileTriangles);
+
+	Mutex resultMutex;
+	Condition resultReady;
+	std::vector<TileLayerResult> results;
+	int pending = 0;
+
+	{
+		WorkerPool pool(numThreads);
+		for(int y = 0; y < tilesHigh; ++y)
+		{
+			for(int x = 0; x < tilesWide; ++x)
+			{
+				const std::vector<int>* triangles = &tileTriangles[x + y * tilesWide];
+				if(triangles->empty())
+				{
+					continue;
+				}
+
+				rcConfig cfg;
+				tileConfigAt(_config,tileConfig,x,y,tileWorldSize,cfg);
+
+				++pending;
+				pool.push([=,&resultMutex,&resultReady,&results] () {
+					TileLayerResult result;
+					result.x = x;
+					result.y = y;
+					buildTileLayers(cfg,inputGeom,*triangles,x,y,result);
+
+					ScopedLock lock(resultMutex);
+					results.push_back(result);
+					resultReady.notifyOne();
+				});
+			}
+		}
+
+		//the tile cache and navmesh aren't thread-safe, so layers are added and built into tiles here.
+		int layersAdded = 0;
+		while(pending > 0)
+		{
+			std::vector<TileLayerResult> finished;
+			{
+				ScopedLock lock(resultMutex);
+				while(results.empty())
+				{
+					resultReady.wait(resultMutex);
+				}
+				finished.swap(results);
+			}
+
+			for(auto itr = finished.begin(); itr != finished.end(); ++itr)
+			{
+				--pending;
+				bool added = false;
+				for(size_t i = 0; i < itr->data.size(); ++i)
+				{
+					if(detour->addTileCacheLayer(itr->data[i],itr->dataSize[i]))
+					{
+						++layersAdded;
+						added = true;
+					}
+				}
+				if(added)
+				{
+					detour->buildTileCacheTile(itr->x,itr->y);
+				}
+			}
+		}
+
+#ifdef _DEBUG
+		unsigned long end = Ogre::Root::getSingletonPtr()->getTimer()->getMilliseconds();
+		std::cout << "Tile cache build finished." << std::endl;
+		std::cout << " - " << layersAdded << " layers(" << tilesWide << " x " << tilesHigh << " tiles) on " << pool.getThreadCount() << " threads" << std::endl;
+		std::cout << " - Time elapsed:" << end - start << "ms" << std::endl;
+#endif
+	}
+
+	return detour->isMeshBuilt();
+}
+
+//64-bit FNV-1a, continued from hash.
+static Ogre::uint64 hashBytes(const void* data,size_t size,Ogre::uint64 hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+template<typename T>
+static Ogre::uint64 hashValue(const T& value,Ogre::uint64 hash)
+{
+	return hashBytes(&value,sizeof(T),hash);
+}
+
+Ogre::uint64 RecastInterface::getCacheKey(InputGeometry* inputGeom)
+{
+	Ogre::uint64 hash = 14695981039346656037ULL;
+
+	int numVerts = inputGeom->getVertexCount();
+	int numTris = inputGeom->getTriangleCount();
+	hash = hashValue(numVerts,hash);
+	hash = hashValue(numTris,hash);
+	hash = hashBytes(inputGeom->getVertices(),numVerts * 3 * sizeof(float),hash);
+	hash = hashBytes(inputGeom->getTriangles(),numTris * 3 * sizeof(int),hash);
+
+	//rcConfig fields one by one, bounds and grid size are derived from the geometry during the build.
+	hash = hashValue(_config.cs,hash);
+	hash = hashValue(_config.ch,hash);
+	hash = hashValue(_config.walkableSlopeAngle,hash);
+	hash = hashValue(_config.walkableHeight,hash);
+	hash = hashValue(_config.walkableClimb,hash);
+	hash = hashValue(_config.walkableRadius,hash);
+	hash = hashValue(_config.maxEdgeLen,hash);
+	hash = hashValue(_config.maxSimplificationError,hash);
+	hash = hashValue(_config.minRegionArea,hash);
+	hash = hashValue(_config.mergeRegionArea,hash);
+	hash = hashValue(_config.maxVertsPerPoly,hash);
+	hash = hashValue(_config.detailSampleDist,hash);
+	hash = hashValue(_config.detailSampleMaxError,hash);
+	hash = hashValue(_config.tileSize,hash);
+	hash = hashValue(_config.borderSize,hash);
+
+	//Detour takes the agent dimensions from the user configuration.
+	hash = hashValue(_recastParams.getAgentHeight(),hash);
+	hash = hashValue(_recastParams.getAgentRadius(),hash);
+	hash = hashValue(_recastParams.getAgentMaxClimb(),hash);
+
+	return hash;
+}
+
 void RecastInterface::exportPolygonMeshToObj(const std::string& filename)
 {
 	/*std::fstream out(filename.c_str(),std::ios::out);
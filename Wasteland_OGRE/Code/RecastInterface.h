@@ -8,6 +8,8 @@
 #ifndef _RECAST_INTERFACE_H_
 #define _RECAST_INTERFACE_H_
 
+class DetourInterface;
+
 //The interface between Recast and Ogre
 //Detour will have its own interface.
 
@@ -34,6 +36,20 @@ public:
 	bool buildNavMesh(std::vector<Ogre::Entity*> sourceMeshes);
 	bool buildNavMesh(InputGeometry* inputGeom);
 
+	//Builds a tiled navmesh straight into detour, which is reset first. Needs a tile size in the configuration.
+	//Every tile goes through the whole Recast pipeline on its own, spread over numThreads workers(0 = one per core),
+	//and is added to detour as soon as it's done. No polygon mesh is kept around afterwards.
+	bool buildTiledNavMesh(InputGeometry* inputGeom,DetourInterface* detour,int numThreads = 0);
+
+	//Like buildTiledNavMesh, but every tile is stopped at its heightfield layers, which are compressed and kept
+	//in the tile cache of detour. Tiles can then be rebuilt from them around obstacles added at runtime.
+	//The tile size can't be more than 255 cells.
+	bool buildTileCache(InputGeometry* inputGeom,DetourInterface* detour,int numThreads = 0);
+
+	//Hash of the input geometry and every build setting, used to tell if a cached navmesh is still valid.
+	//Call after any changes to getRecastConfig(), since those end up in the navmesh too.
+	Ogre::uint64 getCacheKey(InputGeometry* inputGeom);
+
 	//Generates an ogre-drawable mesh from the nav-mesh.
 	void createRecastPolygonMesh(const std::string& name,const unsigned short *vertices,const int numVerts,
 								 const unsigned short *polygons,const int numPolys,const unsigned char *areas,
@@ -0,0 +1,187 @@
+#include "StdAfx.h"
+
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid(float cellSize)
+	: _cellSize(cellSize > 0.0f ? cellSize : 8.0f)
+{
+}
+
+void SpatialGrid::insert(LevelData::EntityHandle handle,const Ogre::Vector3& position,int type)
+{
+	remove(handle);
+
+	Item item;
+	item.position = position;
+	item.type = type;
+	item.cell = _cellKey(_cellCoord(position.x),_cellCoord(position.z));
+	_items[handle] = item;
+	_cells[item.cell].push_back(handle);
+}
+
+void SpatialGrid::update(LevelData::EntityHandle handle,const Ogre::Vector3& position)
+{
+	auto itr = _items.find(handle);
+	if(itr == _items.end())
+	{
+		return;
+	}
+
+	itr->second.position = position;
+	Ogre::uint64 cell = _cellKey(_cellCoord(position.x),_cellCoord(position.z));
+	if(cell != itr->second.cell)
+	{
+		_removeFromCell(itr->second.cell,handle);
+		_cells[cell].push_back(handle);
+		itr->second.cell = cell;
+	}
+}
+
+void SpatialGrid::remove(LevelData::EntityHandle handle)
+{
+	auto itr = _items.find(handle);
+	if(itr == _items.end())
+	{
+		return;
+	}
+
+	_removeFromCell(itr->second.cell,handle);
+	_items.erase(itr);
+}
+
+void SpatialGrid::clear()
+{
+	_items.clear();
+	_cells.clear();
+}
+
+void SpatialGrid::_removeFromCell(Ogre::uint64 cell,LevelData::EntityHandle handle)
+{
+	auto itr = _cells.find(cell);
+	if(itr == _cells.end())
+	{
+		return;
+	}
+
+	Cell& entries = itr->second;
+	auto entry = std::find(entries.begin(),entries.end(),handle);
+	if(entry != entries.end())
+	{
+		//order doesn't matter.
+		*entry = entries.back();
+		entries.pop_back();
+	}
+
+	if(entries.empty())
+	{
+		_cells.erase(itr);
+	}
+}
+
+void SpatialGrid::queryRadius(const Ogre::Vector3& center,float radius,int type,std::vector<LevelData::EntityHandle>& out)
+{
+	float radiusSq = radius * radius;
+	int minX = _cellCoord(center.x - radius),maxX = _cellCoord(center.x + radius);
+	int minZ = _cellCoord(center.z - radius),maxZ = _cellCoord(center.z + radius);
+
+	for(int x = minX; x <= maxX; ++x)
+	{
+		for(int z = minZ; z <= maxZ; ++z)
+		{
+			auto cell = _cells.find(_cellKey(x,z));
+			if(cell == _cells.end())
+			{
+				continue;
+			}
+
+			for(auto itr = cell->second.begin(); itr != cell->second.end(); ++itr)
+			{
+				const Item& item = _items[*itr];
+				if((type == LevelData::NONE || item.type == type) && item.position.squaredDistance(center) <= radiusSq)
+				{
+					out.push_back(*itr);
+				}
+			}
+		}
+	}
+}
+
+void SpatialGrid::queryBox(const Ogre::Vector3& min,const Ogre::Vector3& max,int type,std::vector<LevelData::EntityHandle>& out)
+{
+	Ogre::AxisAlignedBox box(min,max);
+	int minX = _cellCoord(min.x),maxX = _cellCoord(max.x);
+	int minZ = _cellCoord(min.z),maxZ = _cellCoord(max.z);
+
+	for(int x = minX; x <= maxX; ++x)
+	{
+		for(int z = minZ; z <= maxZ; ++z)
+		{
+			auto cell = _cells.find(_cellKey(x,z));
+			if(cell == _cells.end())
+			{
+				continue;
+			}
+
+			for(auto itr = cell->second.begin(); itr != cell->second.end(); ++itr)
+			{
+				const Item& item = _items[*itr];
+				if((type == LevelData::NONE || item.type == type) && box.intersects(item.position))
+				{
+					out.push_back(*itr);
+				}
+			}
+		}
+	}
+}
+
+LevelData::EntityHandle SpatialGrid::nearest(const Ogre::Vector3& center,float maxDistance,int type,float minDistance)
+{
+	LevelData::EntityHandle best = LevelData::INVALID_ENTITY_HANDLE;
+	float bestSq = maxDistance * maxDistance;
+	float minSq = minDistance * minDistance;
+
+	int cx = _cellCoord(center.x),cz = _cellCoord(center.z);
+	int maxRing = static_cast<int>(ceil(maxDistance / _cellSize));
+
+	//rings of cells around the center, anything outside ring r is at least r cells away.
+	for(int ring = 0; ring <= maxRing; ++ring)
+	{
+		float ringDistance = (ring - 1) * _cellSize;
+		if(best != LevelData::INVALID_ENTITY_HANDLE && ringDistance > 0.0f && ringDistance * ringDistance > bestSq)
+		{
+			break;
+		}
+
+		for(int x = cx - ring; x <= cx + ring; ++x)
+		{
+			//only the border of the ring, the inside was done already.
+			int step = (x == cx - ring || x == cx + ring) ? 1 : ring * 2;
+			for(int z = cz - ring; z <= cz + ring; z += (step > 0 ? step : 1))
+			{
+				auto cell = _cells.find(_cellKey(x,z));
+				if(cell == _cells.end())
+				{
+					continue;
+				}
+
+				for(auto itr = cell->second.begin(); itr != cell->second.end(); ++itr)
+				{
+					const Item& item = _items[*itr];
+					if(type != LevelData::NONE && item.type != type)
+					{
+						continue;
+					}
+
+					float distSq = item.position.squaredDistance(center);
+					if(distSq < bestSq && distSq > minSq)
+					{
+						best = *itr;
+						bestSq = distSq;
+					}
+				}
+			}
+		}
+	}
+
+	return best;
+}
@@ -0,0 +1,51 @@
+#include "StdAfx.h"
+
+#ifndef _SPATIAL_GRID_H_
+#define _SPATIAL_GRID_H_
+
+#include "LevelData.h"
+
+#include <unordered_map>
+
+//Uniform grid over the X/Z plane holding entity positions, for neighbour queries that don't touch every entity.
+//Only cells that have something in them exist, so the level size doesn't matter.
+class SpatialGrid
+{
+public:
+	explicit SpatialGrid(float cellSize = 8.0f);
+
+	//type is a LevelData::ENTITY_TYPE, used by the query filters.
+	void insert(LevelData::EntityHandle handle,const Ogre::Vector3& position,int type);
+	//Cheap when the entity stays in its cell, which is most frames.
+	void update(LevelData::EntityHandle handle,const Ogre::Vector3& position);
+	void remove(LevelData::EntityHandle handle);
+	void clear();
+
+	bool contains(LevelData::EntityHandle handle) { return _items.find(handle) != _items.end(); }
+
+	//Queries, type LevelData::NONE matches everything. Results are appended to out.
+	void queryRadius(const Ogre::Vector3& center,float radius,int type,std::vector<LevelData::EntityHandle>& out);
+	void queryBox(const Ogre::Vector3& min,const Ogre::Vector3& max,int type,std::vector<LevelData::EntityHandle>& out);
+	//Closest entity within maxDistance, ignoring entities closer than minDistance(e.g. the caller itself).
+	LevelData::EntityHandle nearest(const Ogre::Vector3& center,float maxDistance,int type,float minDistance = 0.0f);
+
+private:
+	struct Item
+	{
+		Ogre::Vector3 position;
+		int type;
+		Ogre::uint64 cell;
+	};
+
+	typedef std::vector<LevelData::EntityHandle> Cell;
+
+	int _cellCoord(float value) { return static_cast<int>(floor(value / _cellSize)); }
+	Ogre::uint64 _cellKey(int x,int z) { return (static_cast<Ogre::uint64>(static_cast<Ogre::uint32>(x)) << 32) | static_cast<Ogre::uint32>(z); }
+	void _removeFromCell(Ogre::uint64 cell,LevelData::EntityHandle handle);
+
+	float _cellSize;
+	std::unordered_map<LevelData::EntityHandle,Item> _items;
+	std::unordered_map<Ogre::uint64,Cell> _cells;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "StdAfx.h"
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int numThreads)
+	: _activeJobs(0),
+	  _stopping(false)
+{
+	if(numThreads <= 0)
+	{
+		numThreads = getCoreCount();
+	}
+
+	for(int i = 0; i < numThreads; ++i)
+	{
+		HANDLE thread = CreateThread(NULL,0,&WorkerPool::_threadMain,this,0,NULL);
+		if(thread == NULL)
+		{
+			std::cout << "Error! WorkerPool - could not create worker thread." << std::endl;
+			continue;
+		}
+		_threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	wait();
+
+	{
+		ScopedLock lock(_mutex);
+		_stopping = true;
+	}
+	_jobAvailable.notifyAll();
+
+	for(auto itr = _threads.begin(); itr != _threads.end(); ++itr)
+	{
+		WaitForSingleObject(*itr,INFINITE);
+		CloseHandle(*itr);
+	}
+}
+
+void WorkerPool::push(const Job& job)
+{
+	if(_threads.empty())
+	{
+		//no workers, run it right here.
+		job();
+		return;
+	}
+
+	{
+		ScopedLock lock(_mutex);
+		_jobs.push_back(job);
+	}
+	_jobAvailable.notifyOne();
+}
+
+void WorkerPool::wait()
+{
+	ScopedLock lock(_mutex);
+	while(!_jobs.empty() || _activeJobs > 0)
+	{
+		_allDone.wait(_mutex);
+	}
+}
+
+int WorkerPool::getCoreCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? static_cast<int>(info.dwNumberOfProcessors) : 1;
+}
+
+DWORD WINAPI WorkerPool::_threadMain(LPVOID param)
+{
+	static_cast<WorkerPool*>(param)->_run();
+	return 0;
+}
+
+void WorkerPool::_run()
+{
+	for(;;)
+	{
+		Job job;
+		{
+			ScopedLock lock(_mutex);
+			while(_jobs.empty() && !_stopping)
+			{
+				_jobAvailable.wait(_mutex);
+			}
+			if(_jobs.empty())
+			{
+				//stopping, and nothing left to do.
+				return;
+			}
+
+			job = _jobs.front();
+			_jobs.pop_front();
+			++_activeJobs;
+		}
+
+		job();
+
+		{
+			ScopedLock lock(_mutex);
+			--_activeJobs;
+			if(_jobs.empty() && _activeJobs == 0)
+			{
+				_allDone.notifyAll();
+			}
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#include "StdAfx.h"
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <functional>
+#include <deque>
+
+//Thin wrappers around the Win32 threading primitives.
+//The compiler we're on doesn't have <thread>/<mutex> yet.
+
+class Mutex
+{
+public:
+	Mutex() { InitializeCriticalSection(&_section); }
+	~Mutex() { DeleteCriticalSection(&_section); }
+
+	void lock() { EnterCriticalSection(&_section); }
+	void unlock() { LeaveCriticalSection(&_section); }
+
+	CRITICAL_SECTION* getHandle() { return &_section; }
+private:
+	Mutex(const Mutex&);
+	Mutex& operator=(const Mutex&);
+
+	CRITICAL_SECTION _section;
+};
+
+class ScopedLock
+{
+public:
+	explicit ScopedLock(Mutex& mutex) : _mutex(mutex) { _mutex.lock(); }
+	~ScopedLock() { _mutex.unlock(); }
+private:
+	ScopedLock(const ScopedLock&);
+	ScopedLock& operator=(const ScopedLock&);
+
+	Mutex& _mutex;
+};
+
+class Condition
+{
+public:
+	Condition() { InitializeConditionVariable(&_condition); }
+
+	//mutex must be locked by the caller, it's locked again when this returns.
+	void wait(Mutex& mutex) { SleepConditionVariableCS(&_condition,mutex.getHandle(),INFINITE); }
+	void notifyOne() { WakeConditionVariable(&_condition); }
+	void notifyAll() { WakeAllConditionVariable(&_condition); }
+private:
+	Condition(const Condition&);
+	Condition& operator=(const Condition&);
+
+	CONDITION_VARIABLE _condition;
+};
+
+//Fixed set of worker threads pulling jobs off a shared queue.
+class WorkerPool
+{
+public:
+	typedef std::function<void ()> Job;
+
+	//numThreads of 0 uses one thread per core.
+	explicit WorkerPool(int numThreads = 0);
+	//Finishes every queued job before the threads are stopped.
+	~WorkerPool();
+
+	void push(const Job& job);
+
+	//Blocks until the queue is empty and no job is running.
+	void wait();
+
+	int getThreadCount() { return static_cast<int>(_threads.size()); }
+
+	static int getCoreCount();
+
+private:
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+
+	static DWORD WINAPI _threadMain(LPVOID param);
+	void _run();
+
+	std::vector<HANDLE> _threads;
+	std::deque<Job> _jobs;
+	int _activeJobs;
+	bool _stopping;
+
+	Mutex _mutex;
+	Condition _jobAvailable;
+	Condition _allDone;
+};
+
+#endif